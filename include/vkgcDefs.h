@@ -45,7 +45,7 @@
 #define LLPC_INTERFACE_MAJOR_VERSION 40
 
 /// LLPC minor interface version.
-#define LLPC_INTERFACE_MINOR_VERSION 0
+#define LLPC_INTERFACE_MINOR_VERSION 2
 
 #ifndef LLPC_CLIENT_INTERFACE_MAJOR_VERSION
 #if VFX_INSIDE_SPVGEN
@@ -69,6 +69,8 @@
 //* %Version History
 //* | %Version | Change Description                                                                                    |
 //* | -------- | ----------------------------------------------------------------------------------------------------- |
+//* |     40.2 | Added optimizationTier to PipelineOptions                                                             |
+//* |     40.1 | Added BuildGraphicsPipelineAsync and BuildComputePipelineAsync to ICompiler                          |
 //* |     40.0 | Added DescriptorReserved12, which moves DescriptorYCbCrSampler down to 13                             |
 //* |     39.0 | Non-LLPC-specific XGL code should #include vkcgDefs.h instead of llpc.h                               |
 //* |     38.3 | Added shadowDescriptorTableUsage and shadowDescriptorTablePtrHigh to PipelineOptions                  |
@@ -248,6 +250,13 @@ enum class ShadowDescriptorTableUsage : unsigned {
   Disable = 2,
 };
 
+/// Values for optimizationTier pipeline option, trading the quality of the generated code for compile time.
+enum class OptimizationTier : unsigned {
+  Full = 0, ///< Full optimization. Use 0 so null initialized structures default to it.
+  Fast,     ///< Cheap clean-up, small loop unrolling and scalarization only, for a quick first build
+  Minimal,  ///< Only the clean-up needed after SPIR-V translation and patching, for the quickest build
+};
+
 /// Represents per pipeline options.
 struct PipelineOptions {
   bool includeDisassembly;      ///< If set, the disassembly for all compiled shaders will be included in
@@ -261,6 +270,7 @@ struct PipelineOptions {
 
   ShadowDescriptorTableUsage shadowDescriptorTableUsage; ///< Controls shadow descriptor table.
   unsigned shadowDescriptorTablePtrHigh;                 ///< Sets high part of VA ptr for shadow descriptor table.
+  OptimizationTier optimizationTier;                     ///< Optimization tier of the middle-end pass pipeline.
 };
 
 /// Prototype of allocator for output data buffer, used in shader-specific operations.
@@ -304,23 +304,29 @@ void InOutBuilder::markGenericInputOutputUsage(bool isOutput, unsigned location,
     }
   }
 
-  if (!isOutput || m_shaderStage != ShaderStageGeometry) {
-    bool keepAllLocations = false;
-    if (getPipelineState()->isUnlinked()) {
-      if (m_shaderStage == ShaderStageVertex && isOutput)
-        keepAllLocations = true;
-      if (m_shaderStage == ShaderStageFragment && !isOutput)
+  // When building an unlinked shader or half-pipeline, the locations of the outputs of the last vertex-processing
+  // stage and of the fragment shader inputs are kept as they are, so the two halves match without knowing each other.
+  bool keepAllLocations = false;
+  if (getPipelineState()->isUnlinked()) {
+    if (isOutput && m_shaderStage != ShaderStageFragment) {
+      ShaderStage nextStage = getPipelineState()->getNextShaderStage(m_shaderStage);
+      if (nextStage == ShaderStageInvalid || nextStage == ShaderStageFragment)
         keepAllLocations = true;
     }
-    unsigned startLocation = (keepAllLocations ? 0 : location);
+    if (m_shaderStage == ShaderStageFragment && !isOutput)
+      keepAllLocations = true;
+  }
+  unsigned startLocation = (keepAllLocations ? 0 : location);
+
+  if (!isOutput || m_shaderStage != ShaderStageGeometry) {
     // Non-GS-output case.
     for (unsigned i = startLocation; i < location + locationCount; ++i)
       (*inOutLocMap)[i] = InvalidValue;
   } else {
     // GS output. We include the stream ID with the location in the map key.
-    for (unsigned i = 0; i < locationCount; ++i) {
+    for (unsigned i = startLocation; i < location + locationCount; ++i) {
       GsOutLocInfo outLocInfo = {};
-      outLocInfo.location = location + i;
+      outLocInfo.location = i;
       outLocInfo.streamId = inOutInfo.getStreamId();
       (*inOutLocMap)[outLocInfo.u32All] = InvalidValue;
     }
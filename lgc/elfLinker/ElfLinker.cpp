@@ -0,0 +1,645 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  ElfLinker.cpp
+ * @brief LGC source file: Implementation of the ElfLinker interface, for linking unlinked half-pipeline ELFs
+ *        into a pipeline ELF
+ *
+ * @details The unlinked ELFs are relocatable AMDGPU ELFs, each the output of a shader or half-pipeline compile.
+ * Linking them does no LLVM code generation: the code sections are concatenated, the relocs (which refer to
+ * pipeline state such as descriptor offsets) are resolved from the pipeline state, the PAL metadata of the halves
+ * is merged and fixed up, and the result is written out as a single ELF.
+ ***********************************************************************************************************************
+ */
+#include "lgc/ElfLinker.h"
+#include "lgc/state/PalMetadata.h"
+#include "lgc/state/PipelineState.h"
+#include "lgc/state/TargetInfo.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/BinaryFormat/ELF.h"
+#include "llvm/MC/StringTableBuilder.h"
+#include "llvm/Object/ELFObjectFile.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace lgc;
+using namespace llvm;
+
+namespace {
+
+// Name of the note that contains the PAL metadata
+const char PalMetadataNoteName[] = "AMDGPU";
+
+// Alignment of each input code section within the output .text section. Each shader entry-point must be
+// 256-byte aligned.
+const uint64_t CodeSectionAlignment = 0x100;
+
+// =====================================================================================================================
+// An output section, made by concatenating the input sections of the same name, or built by the linker
+struct OutputSection {
+  StringRef name;        // Section name
+  unsigned type;         // ELF section type
+  uint64_t flags;        // ELF section flags
+  uint64_t alignment;    // Section alignment
+  unsigned link;         // ELF sh_link
+  unsigned info;         // ELF sh_info
+  uint64_t entrySize;    // ELF sh_entsize
+  std::string contents;  // Section contents
+  uint64_t fileOffset;   // Offset of the section in the output ELF
+};
+
+// =====================================================================================================================
+// An ELF note
+struct ElfNote {
+  StringRef name; // Note name, without the terminating nul
+  unsigned type;  // Note type
+  StringRef desc; // Note contents
+};
+
+// =====================================================================================================================
+// Implementation of the ElfLinker interface
+class ElfLinkerImpl final : public ElfLinker {
+public:
+  ElfLinkerImpl(PipelineState *pipelineState, ArrayRef<MemoryBufferRef> elfs);
+
+  // -----------------------------------------------------------------------------------------------------------------
+  // Implementations of ElfLinker methods exposed to the front-end
+
+  bool link(raw_pwrite_stream &outStream) override final;
+
+private:
+  bool readInputElfs();
+  void addSections();
+  bool addSymbols();
+  bool applyRelocations();
+  bool readNotes(const object::ObjectFile &elf, SmallVectorImpl<ElfNote> &notes);
+  bool mergePalMetadata(std::string &palMetadataBlob);
+  bool getRelocValue(StringRef name, unsigned &value);
+  bool getDescriptorOffsetRelocValue(StringRef name, unsigned &value);
+  bool getDescriptorStrideRelocValue(StringRef name, unsigned &value);
+  void writeElf(raw_pwrite_stream &outStream, StringRef palMetadataBlob);
+
+  PipelineState *m_pipelineState;                               // PipelineState object
+  SmallVector<MemoryBufferRef, 4> m_elfBuffers;                 // Unlinked shader/half-pipeline ELFs
+  SmallVector<std::unique_ptr<object::ObjectFile>, 4> m_elfs;   // Parsed input ELFs
+  SmallVector<OutputSection, 4> m_outputSections;               // Output sections, in ELF section index order
+  // Map from {input ELF index, input section index} to {output section index, offset in output section}
+  DenseMap<std::pair<unsigned, unsigned>, std::pair<unsigned, uint64_t>> m_inputSectionMap;
+  SmallVector<object::ELF64LE::Sym, 8> m_symbols;               // Output symbols
+  SmallVector<StringRef, 8> m_symbolNames;                      // Output symbol names, parallel to m_symbols
+  StringTableBuilder m_strtab{StringTableBuilder::ELF};         // String table for symbol and section names
+};
+
+} // anonymous namespace
+
+namespace lgc {
+
+// =====================================================================================================================
+// Create an ELF linker object. This is the implementation of PipelineState::createElfLinker.
+//
+// @param pipelineState : PipelineState object
+// @param elfs : Array of unlinked shader/half-pipeline ELFs to link, in shader stage order
+ElfLinker *createElfLinkerImpl(PipelineState *pipelineState, ArrayRef<MemoryBufferRef> elfs) {
+  return new ElfLinkerImpl(pipelineState, elfs);
+}
+
+} // namespace lgc
+
+// =====================================================================================================================
+// Constructor. The ELF buffers are not copied; they must remain valid until the link is complete.
+//
+// @param pipelineState : PipelineState object
+// @param elfs : Array of unlinked shader/half-pipeline ELFs to link, in shader stage order
+ElfLinkerImpl::ElfLinkerImpl(PipelineState *pipelineState, ArrayRef<MemoryBufferRef> elfs)
+    : m_pipelineState(pipelineState), m_elfBuffers(elfs.begin(), elfs.end()) {
+}
+
+// =====================================================================================================================
+// Link the unlinked shader/half-pipeline ELFs into a pipeline ELF.
+//
+// @param [out] outStream : Stream to write linked ELF to
+// @return : True for success, false if the pipeline cannot be linked from the unlinked ELFs, in which case
+//           getLastError() returns a textual description
+bool ElfLinkerImpl::link(raw_pwrite_stream &outStream) {
+  m_pipelineState->setError("");
+
+  if (!readInputElfs())
+    return false;
+  addSections();
+  if (!addSymbols() || !applyRelocations())
+    return false;
+
+  std::string palMetadataBlob;
+  if (!mergePalMetadata(palMetadataBlob))
+    return false;
+
+  writeElf(outStream, palMetadataBlob);
+  return true;
+}
+
+// =====================================================================================================================
+// Parse the input unlinked shader/half-pipeline ELFs.
+//
+// @return : True for success, false if an input is not a 64-bit little-endian ELF
+bool ElfLinkerImpl::readInputElfs() {
+  for (MemoryBufferRef buffer : m_elfBuffers) {
+    Expected<std::unique_ptr<object::ObjectFile>> elf = object::ObjectFile::createELFObjectFile(buffer);
+    if (!elf) {
+      m_pipelineState->setError("Cannot read unlinked ELF: " + toString(elf.takeError()));
+      return false;
+    }
+    if (!isa<object::ELF64LEObjectFile>(**elf)) {
+      m_pipelineState->setError("Unlinked ELF is not a 64-bit little-endian ELF");
+      return false;
+    }
+    m_elfs.push_back(std::move(*elf));
+  }
+  return !m_elfs.empty();
+}
+
+// =====================================================================================================================
+// Create the output sections by concatenating the PROGBITS sections of the input ELFs that have the same name,
+// recording where each input section ends up. Code sections are aligned such that each shader entry-point is
+// suitably aligned.
+void ElfLinkerImpl::addSections() {
+  // Output section 0 is the null section.
+  m_outputSections.push_back({});
+  StringMap<unsigned> outputSectionIndices;
+
+  for (unsigned elfIndex = 0; elfIndex != m_elfs.size(); ++elfIndex) {
+    for (const object::SectionRef &section : m_elfs[elfIndex]->sections()) {
+      object::ELFSectionRef elfSection(section);
+      if (elfSection.getType() != ELF::SHT_PROGBITS)
+        continue;
+      Expected<StringRef> name = section.getName();
+      Expected<StringRef> contents = section.getContents();
+      if (!name || !contents) {
+        consumeError(name.takeError());
+        consumeError(contents.takeError());
+        continue;
+      }
+
+      auto insertResult = outputSectionIndices.insert({*name, m_outputSections.size()});
+      if (insertResult.second) {
+        OutputSection outputSection = {};
+        outputSection.name = *name;
+        outputSection.type = ELF::SHT_PROGBITS;
+        outputSection.flags = elfSection.getFlags();
+        outputSection.alignment = std::max(section.getAlignment(), uint64_t(1));
+        m_outputSections.push_back(outputSection);
+      }
+      OutputSection &outputSection = m_outputSections[insertResult.first->second];
+      uint64_t alignment = std::max(section.getAlignment(), uint64_t(1));
+      if (elfSection.getFlags() & ELF::SHF_EXECINSTR)
+        alignment = std::max(alignment, CodeSectionAlignment);
+      outputSection.alignment = std::max(outputSection.alignment, alignment);
+
+      uint64_t offset = alignTo(outputSection.contents.size(), alignment);
+      outputSection.contents.resize(offset);
+      outputSection.contents.append(contents->begin(), contents->end());
+      m_inputSectionMap[{elfIndex, unsigned(section.getIndex())}] = {insertResult.first->second, offset};
+    }
+  }
+}
+
+// =====================================================================================================================
+// Gather the symbols defined in the output sections, with their values adjusted to their offsets in the output
+// sections. Local labels (such as basic block labels), section symbols and undefined symbols (which are the
+// symbols of relocs resolved in applyRelocations) are dropped.
+//
+// @return : True for success, false if the same global symbol is defined in more than one input ELF
+bool ElfLinkerImpl::addSymbols() {
+  SmallVector<object::ELF64LE::Sym, 8> globalSymbols;
+  SmallVector<StringRef, 8> globalSymbolNames;
+  StringMap<unsigned> globalSymbolIndices;
+
+  // Symbol 0 is the null symbol.
+  m_symbols.push_back({});
+  m_symbolNames.push_back("");
+
+  for (unsigned elfIndex = 0; elfIndex != m_elfs.size(); ++elfIndex) {
+    for (const object::SymbolRef &symbol : m_elfs[elfIndex]->symbols()) {
+      object::ELFSymbolRef elfSymbol(symbol);
+      unsigned char type = elfSymbol.getELFType();
+      unsigned char binding = elfSymbol.getBinding();
+      if (type == ELF::STT_SECTION || type == ELF::STT_FILE || (type == ELF::STT_NOTYPE && binding == ELF::STB_LOCAL))
+        continue;
+      Expected<object::section_iterator> section = symbol.getSection();
+      Expected<StringRef> name = symbol.getName();
+      Expected<uint64_t> value = symbol.getAddress();
+      if (!section || !name || !value) {
+        consumeError(section.takeError());
+        consumeError(name.takeError());
+        consumeError(value.takeError());
+        continue;
+      }
+      if (*section == m_elfs[elfIndex]->section_end())
+        continue;
+      auto mapIt = m_inputSectionMap.find({elfIndex, unsigned((*section)->getIndex())});
+      if (mapIt == m_inputSectionMap.end())
+        continue;
+
+      object::ELF64LE::Sym outSymbol = {};
+      outSymbol.setBindingAndType(binding, type);
+      outSymbol.st_other = elfSymbol.getOther();
+      outSymbol.st_shndx = mapIt->second.first;
+      outSymbol.st_value = *value + mapIt->second.second;
+      outSymbol.st_size = elfSymbol.getSize();
+      if (binding == ELF::STB_LOCAL) {
+        m_symbols.push_back(outSymbol);
+        m_symbolNames.push_back(*name);
+        continue;
+      }
+      if (!globalSymbolIndices.insert({*name, globalSymbols.size()}).second) {
+        m_pipelineState->setError("Duplicate symbol '" + *name + "' in unlinked ELFs");
+        return false;
+      }
+      globalSymbols.push_back(outSymbol);
+      globalSymbolNames.push_back(*name);
+    }
+  }
+
+  // ELF requires the local symbols to come before the global ones.
+  m_symbols.append(globalSymbols.begin(), globalSymbols.end());
+  m_symbolNames.append(globalSymbolNames.begin(), globalSymbolNames.end());
+  return true;
+}
+
+// =====================================================================================================================
+// Apply the relocs of the input ELFs to the output sections. Each reloc is an R_AMDGPU_ABS32 on an undefined
+// symbol whose value comes from the pipeline state.
+//
+// @return : True for success, false if a reloc cannot be resolved
+bool ElfLinkerImpl::applyRelocations() {
+  for (unsigned elfIndex = 0; elfIndex != m_elfs.size(); ++elfIndex) {
+    const object::ObjectFile &elf = *m_elfs[elfIndex];
+    for (const object::SectionRef &relocSection : elf.sections()) {
+      Expected<object::section_iterator> relocatedSection = relocSection.getRelocatedSection();
+      if (!relocatedSection) {
+        consumeError(relocatedSection.takeError());
+        continue;
+      }
+      if (*relocatedSection == elf.section_end())
+        continue;
+      auto mapIt = m_inputSectionMap.find({elfIndex, unsigned((*relocatedSection)->getIndex())});
+      if (mapIt == m_inputSectionMap.end())
+        continue;
+      std::string &contents = m_outputSections[mapIt->second.first].contents;
+      bool explicitAddend = object::ELFSectionRef(relocSection).getType() == ELF::SHT_RELA;
+
+      for (const object::RelocationRef &reloc : relocSection.relocations()) {
+        uint64_t offset = reloc.getOffset() + mapIt->second.second;
+        object::symbol_iterator symbol = reloc.getSymbol();
+        if (symbol == elf.symbol_end()) {
+          m_pipelineState->setError("Unsupported reloc with no symbol");
+          return false;
+        }
+        Expected<StringRef> symbolName = symbol->getName();
+        if (!symbolName) {
+          m_pipelineState->setError("Bad reloc symbol: " + toString(symbolName.takeError()));
+          return false;
+        }
+        if (reloc.getType() != ELF::R_AMDGPU_ABS32 || offset + sizeof(uint32_t) > contents.size()) {
+          m_pipelineState->setError("Unsupported reloc on '" + *symbolName + "'");
+          return false;
+        }
+        unsigned value = 0;
+        if (!getRelocValue(*symbolName, value)) {
+          if (m_pipelineState->getLastError().empty())
+            m_pipelineState->setError("Cannot resolve reloc '" + *symbolName + "'");
+          return false;
+        }
+
+        char *target = &contents[offset];
+        int64_t addend = 0;
+        if (explicitAddend) {
+          Expected<int64_t> relocAddend = object::ELFRelocationRef(reloc).getAddend();
+          if (relocAddend)
+            addend = *relocAddend;
+          else
+            consumeError(relocAddend.takeError());
+        } else
+          addend = support::endian::read32le(target);
+        support::endian::write32le(target, value + addend);
+      }
+    }
+  }
+  return true;
+}
+
+// =====================================================================================================================
+// Read the notes from the note sections of an ELF.
+//
+// @param elf : ELF to read
+// @param [out] notes : Vector to append the notes to
+// @return : True for success, false if a note section is malformed
+bool ElfLinkerImpl::readNotes(const object::ObjectFile &elf, SmallVectorImpl<ElfNote> &notes) {
+  for (const object::SectionRef &section : elf.sections()) {
+    if (object::ELFSectionRef(section).getType() != ELF::SHT_NOTE)
+      continue;
+    Expected<StringRef> contents = section.getContents();
+    if (!contents) {
+      consumeError(contents.takeError());
+      continue;
+    }
+
+    // Each note is a header of {namesz, descsz, type}, then the name, then the desc, each padded to 4 bytes.
+    StringRef remaining = *contents;
+    while (!remaining.empty()) {
+      const uint64_t headerSize = 3 * sizeof(uint32_t);
+      if (remaining.size() < headerSize)
+        break;
+      uint32_t nameSize = support::endian::read32le(remaining.data());
+      uint32_t descSize = support::endian::read32le(remaining.data() + 4);
+      uint32_t type = support::endian::read32le(remaining.data() + 8);
+      uint64_t descOffset = headerSize + alignTo(nameSize, 4);
+      uint64_t noteSize = descOffset + alignTo(descSize, 4);
+      if (noteSize > remaining.size())
+        break;
+      notes.push_back(
+          {remaining.substr(headerSize, nameSize).rtrim('\0'), type, remaining.substr(descOffset, descSize)});
+      remaining = remaining.drop_front(noteSize);
+    }
+    if (!remaining.empty()) {
+      m_pipelineState->setError("Malformed note section in unlinked ELF");
+      return false;
+    }
+  }
+  return true;
+}
+
+// =====================================================================================================================
+// Merge the PAL metadata of the unlinked shader/half-pipeline ELFs, resolve the user data registers that depend on
+// the user data layout, and finalize it for the pipeline.
+//
+// @param [out] palMetadataBlob : MsgPack blob of the merged PAL metadata
+// @return : True for success, false if some user data cannot be resolved
+bool ElfLinkerImpl::mergePalMetadata(std::string &palMetadataBlob) {
+  std::unique_ptr<PalMetadata> palMetadata;
+  for (unsigned elfIndex = 0; elfIndex != m_elfBuffers.size(); ++elfIndex) {
+    SmallVector<ElfNote, 2> notes;
+    if (!readNotes(*m_elfs[elfIndex], notes))
+      return false;
+    for (const ElfNote &note : notes) {
+      if (note.type != ELF::NT_AMDGPU_METADATA || note.name != PalMetadataNoteName)
+        continue;
+      // The first ELF is the base; a following one is the fragment half-pipeline.
+      if (!palMetadata)
+        palMetadata.reset(new PalMetadata(m_pipelineState, note.desc));
+      else
+        palMetadata->mergeFromBlob(note.desc);
+    }
+  }
+  if (!palMetadata) {
+    m_pipelineState->setError("No PAL metadata in unlinked ELFs");
+    return false;
+  }
+
+  if (!palMetadata->fixUpRegisters())
+    return false;
+  palMetadata->finalizePipeline();
+  palMetadata->writeToBlob(palMetadataBlob);
+  return true;
+}
+
+// =====================================================================================================================
+// Get the value of a reloc symbol from the pipeline state. The reloc symbols are generated by BuilderBase::
+// CreateRelocationConstant when compiling an unlinked shader.
+//
+// @param name : Symbol name
+// @param [out] value : Value of the symbol
+// @return : True for success, false if the symbol is unknown or cannot be resolved
+bool ElfLinkerImpl::getRelocValue(StringRef name, unsigned &value) {
+  if (name.startswith("doff_"))
+    return getDescriptorOffsetRelocValue(name, value);
+  if (name.startswith("dstride_"))
+    return getDescriptorStrideRelocValue(name, value);
+  if (name == "$deviceIdx") {
+    value = m_pipelineState->getDeviceIndex();
+    return true;
+  }
+  if (name == "$numSamples") {
+    value = m_pipelineState->getRasterizerState().numSamples;
+    return true;
+  }
+  if (name == "$samplePatternIdx") {
+    value = m_pipelineState->getRasterizerState().samplePatternIdx;
+    return true;
+  }
+  return false;
+}
+
+// =====================================================================================================================
+// Get the value of a descriptor offset reloc "doff_<set>_<binding>_<kind>", the byte offset of the descriptor in its
+// descriptor table, where <kind> is "s" (sampler), "r" (resource), "b" (buffer) or "x" (other).
+//
+// @param name : Symbol name
+// @param [out] value : Value of the symbol
+// @return : True for success, false if the descriptor cannot be found in the user data nodes
+bool ElfLinkerImpl::getDescriptorOffsetRelocValue(StringRef name, unsigned &value) {
+  unsigned descSet = 0;
+  unsigned binding = 0;
+  name = name.drop_front(strlen("doff_"));
+  if (name.consumeInteger(10, descSet) || !name.consume_front("_") || name.consumeInteger(10, binding) ||
+      !name.consume_front("_"))
+    return false;
+
+  ResourceNodeType nodeType = ResourceNodeType::Unknown;
+  if (name == "s")
+    nodeType = ResourceNodeType::DescriptorSampler;
+  else if (name == "r")
+    nodeType = ResourceNodeType::DescriptorResource;
+  else if (name == "b")
+    nodeType = ResourceNodeType::DescriptorBuffer;
+
+  const ResourceNode *topNode = nullptr;
+  const ResourceNode *node = nullptr;
+  std::tie(topNode, node) = m_pipelineState->findResourceNode(nodeType, descSet, binding);
+  if (!node)
+    return false;
+  // The unlinked shader loads the descriptor from the descriptor table for its set, so the descriptor must be in
+  // a table, and must be a full descriptor.
+  if (topNode == node || node->type == ResourceNodeType::DescriptorBufferCompact) {
+    m_pipelineState->setError("Descriptor (" + Twine(descSet) + "," + Twine(binding) +
+                              ") is not in a form that an unlinked shader can use");
+    return false;
+  }
+
+  value = node->offsetInDwords * 4;
+  if (nodeType == ResourceNodeType::DescriptorSampler && (node->type == ResourceNodeType::DescriptorCombinedTexture ||
+                                                          node->type == ResourceNodeType::DescriptorYCbCrSampler))
+    value += m_pipelineState->getTargetInfo().getGpuProperty().descriptorSizeResource;
+  return true;
+}
+
+// =====================================================================================================================
+// Get the value of a descriptor stride reloc "dstride_<set>_<binding>", the byte stride of an array of the
+// descriptor.
+//
+// @param name : Symbol name
+// @param [out] value : Value of the symbol
+// @return : True for success, false if the descriptor cannot be found in the user data nodes
+bool ElfLinkerImpl::getDescriptorStrideRelocValue(StringRef name, unsigned &value) {
+  unsigned descSet = 0;
+  unsigned binding = 0;
+  name = name.drop_front(strlen("dstride_"));
+  if (name.consumeInteger(10, descSet) || !name.consume_front("_") || name.consumeInteger(10, binding))
+    return false;
+
+  const ResourceNode *node = m_pipelineState->findResourceNode(ResourceNodeType::Unknown, descSet, binding).second;
+  if (!node)
+    return false;
+
+  const GpuProperty &gpuProperty = m_pipelineState->getTargetInfo().getGpuProperty();
+  switch (node->type) {
+  case ResourceNodeType::DescriptorSampler:
+    value = gpuProperty.descriptorSizeSampler;
+    return true;
+  case ResourceNodeType::DescriptorResource:
+  case ResourceNodeType::DescriptorFmask:
+    value = gpuProperty.descriptorSizeResource;
+    return true;
+  case ResourceNodeType::DescriptorCombinedTexture:
+    value = gpuProperty.descriptorSizeResource + gpuProperty.descriptorSizeSampler;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// =====================================================================================================================
+// Write the output ELF: the ELF header, based on that of the first input ELF, then the concatenated sections, the
+// note section with the merged PAL metadata, the symbol table and the string table, then the section headers.
+//
+// @param [out] outStream : Stream to write the ELF to
+// @param palMetadataBlob : MsgPack blob of the merged PAL metadata
+void ElfLinkerImpl::writeElf(raw_pwrite_stream &outStream, StringRef palMetadataBlob) {
+  // Build the .note section: the PAL metadata note, then other notes from the first ELF as they are.
+  SmallVector<ElfNote, 2> notes;
+  notes.push_back({PalMetadataNoteName, ELF::NT_AMDGPU_METADATA, palMetadataBlob});
+  readNotes(*m_elfs[0], notes);
+  OutputSection noteSection = {};
+  noteSection.name = ".note";
+  noteSection.type = ELF::SHT_NOTE;
+  noteSection.alignment = 4;
+  for (unsigned noteIndex = 0; noteIndex != notes.size(); ++noteIndex) {
+    const ElfNote &note = notes[noteIndex];
+    if (noteIndex != 0 && note.type == ELF::NT_AMDGPU_METADATA && note.name == PalMetadataNoteName)
+      continue;
+    raw_string_ostream noteStream(noteSection.contents);
+    char header[3 * sizeof(uint32_t)];
+    support::endian::write32le(header, note.name.size() + 1);
+    support::endian::write32le(header + 4, note.desc.size());
+    support::endian::write32le(header + 8, note.type);
+    noteStream.write(header, sizeof(header));
+    noteStream << note.name;
+    noteStream.write_zeros(alignTo(note.name.size() + 1, 4) - note.name.size());
+    noteStream << note.desc;
+    noteStream.write_zeros(alignTo(note.desc.size(), 4) - note.desc.size());
+  }
+  m_outputSections.push_back(noteSection);
+
+  // Add the section and symbol names to the string table, and build the .symtab section.
+  for (const OutputSection &section : m_outputSections)
+    m_strtab.add(section.name);
+  m_strtab.add(".symtab");
+  m_strtab.add(".strtab");
+  for (StringRef symbolName : m_symbolNames)
+    m_strtab.add(symbolName);
+  m_strtab.finalize();
+
+  OutputSection symtabSection = {};
+  symtabSection.name = ".symtab";
+  symtabSection.type = ELF::SHT_SYMTAB;
+  symtabSection.alignment = 8;
+  symtabSection.link = m_outputSections.size() + 1;
+  symtabSection.entrySize = sizeof(object::ELF64LE::Sym);
+  for (unsigned symbolIndex = 0; symbolIndex != m_symbols.size(); ++symbolIndex) {
+    object::ELF64LE::Sym &symbol = m_symbols[symbolIndex];
+    symbol.st_name = m_strtab.getOffset(m_symbolNames[symbolIndex]);
+    if (symbol.getBinding() == ELF::STB_LOCAL)
+      symtabSection.info = symbolIndex + 1;
+    symtabSection.contents.append(reinterpret_cast<const char *>(&symbol), sizeof(symbol));
+  }
+  m_outputSections.push_back(symtabSection);
+
+  OutputSection strtabSection = {};
+  strtabSection.name = ".strtab";
+  strtabSection.type = ELF::SHT_STRTAB;
+  strtabSection.alignment = 1;
+  raw_string_ostream strtabStream(strtabSection.contents);
+  m_strtab.write(strtabStream);
+  strtabStream.flush();
+  m_outputSections.push_back(strtabSection);
+
+  // Lay out the file.
+  uint64_t fileOffset = sizeof(object::ELF64LE::Ehdr);
+  for (OutputSection &section : make_range(m_outputSections.begin() + 1, m_outputSections.end())) {
+    fileOffset = alignTo(fileOffset, section.alignment);
+    section.fileOffset = fileOffset;
+    fileOffset += section.contents.size();
+  }
+  uint64_t sectionHeaderOffset = alignTo(fileOffset, 8);
+
+  // Write the ELF header.
+  object::ELF64LE::Ehdr header;
+  memcpy(&header, m_elfBuffers[0].getBufferStart(), sizeof(header));
+  header.e_phoff = 0;
+  header.e_phnum = 0;
+  header.e_phentsize = 0;
+  header.e_shoff = sectionHeaderOffset;
+  header.e_shentsize = sizeof(object::ELF64LE::Shdr);
+  header.e_shnum = m_outputSections.size();
+  header.e_shstrndx = m_outputSections.size() - 1;
+  outStream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  // Write the sections.
+  fileOffset = sizeof(header);
+  for (const OutputSection &section : make_range(m_outputSections.begin() + 1, m_outputSections.end())) {
+    outStream.write_zeros(section.fileOffset - fileOffset);
+    outStream << section.contents;
+    fileOffset = section.fileOffset + section.contents.size();
+  }
+  outStream.write_zeros(sectionHeaderOffset - fileOffset);
+
+  // Write the section headers.
+  for (const OutputSection &section : m_outputSections) {
+    object::ELF64LE::Shdr sectionHeader = {};
+    if (section.type != ELF::SHT_NULL) {
+      sectionHeader.sh_name = m_strtab.getOffset(section.name);
+      sectionHeader.sh_type = section.type;
+      sectionHeader.sh_flags = section.flags;
+      sectionHeader.sh_offset = section.fileOffset;
+      sectionHeader.sh_size = section.contents.size();
+      sectionHeader.sh_link = section.link;
+      sectionHeader.sh_info = section.info;
+      sectionHeader.sh_addralign = section.alignment;
+      sectionHeader.sh_entsize = section.entrySize;
+    }
+    outStream.write(reinterpret_cast<const char *>(&sectionHeader), sizeof(sectionHeader));
+  }
+}
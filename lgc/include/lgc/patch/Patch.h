@@ -57,6 +57,7 @@ void initializePatchPeepholeOptPass(PassRegistry &);
 void initializePatchPreparePipelineAbiPass(PassRegistry &);
 void initializePatchResourceCollectPass(PassRegistry &);
 void initializePatchSetupTargetFeaturesPass(PassRegistry &);
+void initializePatchWaterfallLoopMergePass(PassRegistry &);
 
 } // namespace llvm
 
@@ -81,6 +82,7 @@ inline static void initializePatchPasses(llvm::PassRegistry &passRegistry) {
   initializePatchPreparePipelineAbiPass(passRegistry);
   initializePatchResourceCollectPass(passRegistry);
   initializePatchSetupTargetFeaturesPass(passRegistry);
+  initializePatchWaterfallLoopMergePass(passRegistry);
 }
 
 llvm::FunctionPass *createPatchBufferOp();
@@ -96,6 +98,7 @@ llvm::FunctionPass *createPatchPeepholeOpt();
 llvm::ModulePass *createPatchPreparePipelineAbi(bool onlySetCallingConvs);
 llvm::ModulePass *createPatchResourceCollect();
 llvm::ModulePass *createPatchSetupTargetFeatures();
+llvm::FunctionPass *createPatchWaterfallLoopMerge();
 
 class PipelineState;
 
@@ -123,7 +126,8 @@ protected:
   llvm::Function *m_entryPoint; // Entry-point
 
 private:
-  static void addOptimizationPasses(llvm::legacy::PassManager &passMgr);
+  static void addOptimizationPasses(llvm::legacy::PassManager &passMgr, OptimizationTier optimizationTier);
+  static void addFastOptimizationPasses(llvm::legacy::PassManager &passMgr, OptimizationTier optimizationTier);
 
   Patch() = delete;
   Patch(const Patch &) = delete;
@@ -54,6 +54,7 @@ public:
   // Constructors
   PalMetadata(PipelineState *pipelineState);
   PalMetadata(PipelineState *pipelineState, llvm::Module *module);
+  PalMetadata(PipelineState *pipelineState, llvm::StringRef blob);
   PalMetadata(const PalMetadata &) = delete;
   PalMetadata &operator=(const PalMetadata &) = delete;
 
@@ -62,6 +63,17 @@ public:
   // Record the PAL metadata into IR metadata in the specified module.
   void record(llvm::Module *module);
 
+  // Write the PAL metadata out into a MsgPack blob, as used in the PAL metadata ELF note.
+  void writeToBlob(std::string &blob);
+
+  // Merge the PAL metadata of an unlinked fragment-shader half-pipeline ELF into this one. Only used by the ELF
+  // linker.
+  void mergeFromBlob(llvm::StringRef blob);
+
+  // Fix up user data registers that were set to a descriptor set or push constant reloc value when compiling an
+  // unlinked shader, using the user data nodes in the pipeline state. Only used by the ELF linker.
+  bool fixUpRegisters();
+
   // Get the MsgPack document for explicit manipulation. Only ConfigBuilder* uses this.
   llvm::msgpack::Document *getDocument() { return m_document; }
 
@@ -94,6 +106,9 @@ private:
   // Set userDataLimit to maximum
   void setUserDataLimit();
 
+  // Deep-copy a MsgPack node from another document into ours
+  llvm::msgpack::DocNode copyNode(llvm::msgpack::DocNode srcNode);
+
   PipelineState *m_pipelineState;           // PipelineState
   llvm::msgpack::Document *m_document;      // The MsgPack document
   llvm::msgpack::MapDocNode m_pipelineNode; // MsgPack map node for amdpal.pipelines[0]
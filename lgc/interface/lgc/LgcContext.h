@@ -52,6 +52,7 @@ namespace lgc {
 
 class Builder;
 class PassManager;
+class PassProfiler;
 class Pipeline;
 class TargetInfo;
 
@@ -109,6 +110,11 @@ public:
   // Utility method to create a start/stop timer pass
   static llvm::ModulePass *createStartStopTimer(llvm::Timer *timer, bool starting);
 
+  // Set and get the profiler to tell about each pass run by Pipeline::generate. This is nullptr (no profiling) unless
+  // set. Codegen passes are not profiled individually; use the codegen timer for them.
+  void setPassProfiler(PassProfiler *profiler) { m_passProfiler = profiler; }
+  PassProfiler *getPassProfiler() const { return m_passProfiler; }
+
   // Set and get a pointer to the stream used for LLPC_OUTS. This is initially nullptr,
   // signifying no output from LLPC_OUTS. Setting this to a stream means that LLPC_OUTS
   // statements in the middle-end output to that stream, giving a dump of LLVM IR at a
@@ -129,6 +135,7 @@ private:
   llvm::TargetMachine *m_targetMachine = nullptr; // Target machine
   TargetInfo *m_targetInfo = nullptr;             // Target info
   unsigned m_palAbiVersion = 0xFFFFFFFF;          // PAL pipeline ABI version to compile for
+  PassProfiler *m_passProfiler = nullptr;         // Profiler for passes run by Pipeline::generate
 };
 
 } // namespace lgc
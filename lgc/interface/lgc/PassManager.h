@@ -30,10 +30,33 @@
  */
 #pragma once
 
+#include "llvm/ADT/StringRef.h"
 #include "llvm/IR/LegacyPassManager.h"
 
 namespace lgc {
 
+// =====================================================================================================================
+// Statistics of one run of a pass, as told to a PassProfiler
+struct PassRunStats {
+  double wallTime;     // Wall-clock time taken by the pass, in seconds
+  double cpuTime;      // User plus system CPU time of the process during the pass, in seconds
+  int instCountDelta;  // Change in the count of IR instructions in the module made by the pass
+  int blockCountDelta; // Change in the count of basic blocks in the module made by the pass
+};
+
+// =====================================================================================================================
+// Interface to be told how long each pass run by a PassManager took, and how it changed the size of the IR
+class PassProfiler {
+public:
+  virtual ~PassProfiler() {}
+
+  // Called after a pass has run
+  //
+  // @param passName : Name of the pass
+  // @param stats : Statistics of the run
+  virtual void passRun(llvm::StringRef passName, const PassRunStats &stats) = 0;
+};
+
 // =====================================================================================================================
 // Public interface of LLPC middle-end's legacy::PassManager override
 class PassManager : public llvm::legacy::PassManager {
@@ -42,6 +65,14 @@ public:
   virtual ~PassManager() {}
   virtual void stop() = 0;
   virtual void setPassIndex(unsigned *passIndex) = 0;
+
+  // Set the profiler to tell about each pass added after this call (nullptr to stop profiling). Each profiled pass
+  // is bracketed by marker module passes, which splits up function pass pipelines, so this is only for profiling.
+  virtual void setPassProfiler(PassProfiler *profiler) = 0;
+
+  // Stop profiling passes added after this call, both for the pass profiler and for -pass-stats. This is used
+  // before adding the codegen passes, as splitting up the machine function pass pipeline would change how codegen runs.
+  virtual void stopProfiling() = 0;
 };
 
 } // namespace lgc
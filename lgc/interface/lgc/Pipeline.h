@@ -91,6 +91,14 @@ enum class WaveBreak : unsigned {
   DrawTime = 0xF, ///< Choose wave break size per draw
 };
 
+// Enumerates the optimization tiers of the middle-end optimization pass pipeline. The lower tiers run fewer and
+// cheaper passes, trading the quality of the generated code for compile time.
+enum class OptimizationTier : unsigned {
+  Full = 0, ///< Full curated optimization set (or LLVM's -O3 set with -use-llvm-opt)
+  Fast,     ///< One round of cheap clean-up, small loop unrolling and scalarization
+  Minimal,  ///< Only the clean-up needed after SPIR-V translation and patching
+};
+
 // Values for shadowDescriptorTable pipeline option.
 enum class ShadowDescriptorTable : unsigned {
   Disable = ~0U // Disable shadow descriptor tables
@@ -117,6 +125,7 @@ struct Options {
   unsigned nggPrimsPerSubgroup;        // How to determine NGG prims per subgroup
   unsigned shadowDescriptorTable;      // High dword of shadow descriptor table address, or
                                        //   ShadowDescriptorTable::Disable to disable shadow descriptor tables
+  OptimizationTier optimizationTier;   // Optimization tier of the optimization pass pipeline
 };
 
 // Middle-end per-shader options to pass to SetShaderOptions.
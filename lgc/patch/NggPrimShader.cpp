@@ -33,6 +33,7 @@
 #include "NggLdsManager.h"
 #include "ShaderMerger.h"
 #include "lgc/PassManager.h"
+#include "lgc/state/IntrinsDefs.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
@@ -2176,6 +2177,9 @@ Value *NggPrimShader::doCulling(Module *module) {
   if (!enableCulling())
     return cullFlag;
 
+  // Registers fetched by a previous culling are not visible here
+  m_cullingRegisters.clear();
+
   Value *vertexId0 = nullptr;
   Value *vertexId1 = nullptr;
   Value *vertexId2 = nullptr;
@@ -3682,6 +3686,17 @@ Value *NggPrimShader::doBackfaceCulling(Module *module, Value *cullFlag, Value *
                                         Value *vertex2) {
   assert(m_nggControl->enableBackfaceCulling);
 
+  // When the cull mode is known at compile time and is CULL_NONE, backface culling never culls anything, so the
+  // culler is not called at all. When it is CULL_FRONT_AND_BACK, the facing of the primitive is irrelevant.
+  bool facingIrrelevant = false;
+  if (!m_nggControl->alwaysUsePrimShaderTable) {
+    PaSuScModeCntl knownPaSuScModeCntl;
+    knownPaSuScModeCntl.u32All = m_nggControl->primShaderTable.pipelineStateCb.paSuScModeCntl;
+    if (!knownPaSuScModeCntl.bits.cullFront && !knownPaSuScModeCntl.bits.cullBack)
+      return cullFlag;
+    facingIrrelevant = knownPaSuScModeCntl.bits.cullFront && knownPaSuScModeCntl.bits.cullBack;
+  }
+
   auto backfaceCuller = module->getFunction(lgcName::NggCullingBackface);
   if (!backfaceCuller)
     backfaceCuller = createBackfaceCuller(module);
@@ -3693,11 +3708,18 @@ Value *NggPrimShader::doBackfaceCulling(Module *module, Value *cullFlag, Value *
   else
     paSuScModeCntl = m_builder->getInt32(m_nggControl->primShaderTable.pipelineStateCb.paSuScModeCntl);
 
-  // Get register PA_CL_VPORT_XSCALE
-  auto paClVportXscale = fetchCullingControlRegister(module, m_cbLayoutTable.vportControls[0].paClVportXscale);
+  // Get register PA_CL_VPORT_XSCALE and PA_CL_VPORT_YSCALE. They only contribute to the facing of the primitive, so
+  // the register fetches are skipped when the facing is irrelevant.
+  Value *paClVportXscale = nullptr;
+  Value *paClVportYscale = nullptr;
 
-  // Get register PA_CL_VPORT_YSCALE
-  auto paClVportYscale = fetchCullingControlRegister(module, m_cbLayoutTable.vportControls[0].paClVportYscale);
+  if (facingIrrelevant) {
+    paClVportXscale = m_builder->getInt32(0);
+    paClVportYscale = m_builder->getInt32(0);
+  } else {
+    paClVportXscale = fetchCullingControlRegister(module, m_cbLayoutTable.vportControls[0].paClVportXscale);
+    paClVportYscale = fetchCullingControlRegister(module, m_cbLayoutTable.vportControls[0].paClVportYscale);
+  }
 
   // Do backface culling
   return m_builder->CreateCall(backfaceCuller, {cullFlag, vertex0, vertex1, vertex2,
@@ -3863,18 +3885,25 @@ Value *NggPrimShader::doCullDistanceCulling(Module *module, Value *cullFlag, Val
 }
 
 // =====================================================================================================================
-// Fetches culling-control register from primitive shader table.
+// Fetches culling-control register from primitive shader table. The fetch is volatile, so a register already fetched
+// by the current culling is reused rather than loaded again.
 //
 // @param module : LLVM module
 // @param regOffset : Register offset in the primitive shader table (in bytes)
 Value *NggPrimShader::fetchCullingControlRegister(Module *module, unsigned regOffset) {
+  auto it = m_cullingRegisters.find(regOffset);
+  if (it != m_cullingRegisters.end())
+    return it->second;
+
   auto fetchCullingRegister = module->getFunction(lgcName::NggCullingFetchReg);
   if (!fetchCullingRegister)
     fetchCullingRegister = createFetchCullingRegister(module);
 
-  return m_builder->CreateCall(
+  auto regValue = m_builder->CreateCall(
       fetchCullingRegister,
       {m_nggFactor.primShaderTableAddrLow, m_nggFactor.primShaderTableAddrHigh, m_builder->getInt32(regOffset)});
+  m_cullingRegisters[regOffset] = regValue;
+  return regValue;
 }
 
 // =====================================================================================================================
@@ -213,6 +213,9 @@ private:
 
   PrimShaderCbLayoutLookupTable m_cbLayoutTable; // Layout lookup table of primitive shader constant buffer
 
+  // Culling-control registers already fetched by the current culling, keyed by register offset
+  std::map<unsigned, llvm::Value *> m_cullingRegisters;
+
   NggLdsManager *m_ldsManager; // NGG LDS manager
 
   // NGG factors used for calculation (different modes use different factors)
@@ -151,7 +151,7 @@ void Patch::addPasses(PipelineState *pipelineState, legacy::PassManager &passMgr
   passMgr.add(createPromoteMemoryToRegisterPass());
 
   if (!cl::DisablePatchOpt)
-    addOptimizationPasses(passMgr);
+    addOptimizationPasses(passMgr, pipelineState->getOptions().optimizationTier);
 
   // Stop timer for optimization passes and restart timer for patching passes.
   if (patchTimer) {
@@ -161,6 +161,9 @@ void Patch::addPasses(PipelineState *pipelineState, legacy::PassManager &passMgr
 
   // Patch buffer operations (must be after optimizations)
   passMgr.add(createPatchBufferOp());
+
+  // Merge adjacent waterfall loops (after optimizations have commoned up their indices)
+  passMgr.add(createPatchWaterfallLoopMerge());
   passMgr.add(createInstructionCombiningPass(2));
 
   // Fully prepare the pipeline ABI (must be after optimizations)
@@ -215,7 +218,14 @@ void Patch::addPasses(PipelineState *pipelineState, legacy::PassManager &passMgr
 // Add optimization passes to pass manager
 //
 // @param [in/out] passMgr : Pass manager to add passes to
-void Patch::addOptimizationPasses(legacy::PassManager &passMgr) {
+// @param optimizationTier : Optimization tier of the pipeline
+void Patch::addOptimizationPasses(legacy::PassManager &passMgr, OptimizationTier optimizationTier) {
+  // The lower tiers have curated sets of their own, used even with -use-llvm-opt.
+  if (optimizationTier != OptimizationTier::Full) {
+    addFastOptimizationPasses(passMgr, optimizationTier);
+    return;
+  }
+
   // Set up standard optimization passes.
   if (!cl::UseLlvmOpt) {
     unsigned optLevel = 3;
@@ -317,6 +327,43 @@ void Patch::addOptimizationPasses(legacy::PassManager &passMgr) {
   }
 }
 
+// =====================================================================================================================
+// Add the optimization passes of a fast-compile tier to pass manager. These are a subset of the full curated set:
+// a single round of the cheap scalar clean-up passes, plus (for OptimizationTier::Fast) full unrolling of small loops
+// and scalarization, which keep private arrays and vectors out of scratch memory and registers. The loop
+// optimizations, GVN and the repeated InstCombine rounds, which take most of the optimization time, are left out.
+//
+// @param [in/out] passMgr : Pass manager to add passes to
+// @param optimizationTier : Optimization tier of the pipeline, other than OptimizationTier::Full
+void Patch::addFastOptimizationPasses(legacy::PassManager &passMgr, OptimizationTier optimizationTier) {
+  if (optimizationTier == OptimizationTier::Minimal) {
+    passMgr.add(createInstructionCombiningPass(1));
+    passMgr.add(createPatchPeepholeOpt());
+    passMgr.add(createCFGSimplificationPass());
+    passMgr.add(createGlobalDCEPass());
+    return;
+  }
+
+  unsigned optLevel = 3;
+  passMgr.add(createInstructionCombiningPass(2));
+  passMgr.add(createPatchPeepholeOpt());
+  passMgr.add(createInstSimplifyLegacyPass());
+  passMgr.add(createCFGSimplificationPass());
+  passMgr.add(createSROAPass());
+  passMgr.add(createEarlyCSEPass(true));
+  passMgr.add(createLoopRotatePass());
+  passMgr.add(createSimpleLoopUnrollPass(optLevel));
+  passMgr.add(createScalarizerPass());
+  passMgr.add(createPatchLoadScalarizer());
+  passMgr.add(createInstSimplifyLegacyPass());
+  passMgr.add(createPatchIntrinsicSimplify());
+  passMgr.add(createInstructionCombiningPass(2));
+  passMgr.add(createPatchPeepholeOpt());
+  passMgr.add(createAggressiveDCEPass());
+  passMgr.add(createCFGSimplificationPass());
+  passMgr.add(createGlobalDCEPass());
+}
+
 // =====================================================================================================================
 // Initializes the pass according to the specified module.
 //
@@ -85,6 +85,7 @@ void PatchInOutImportExport::initPerShader() {
   m_viewportIndex = nullptr;
   m_layer = nullptr;
   m_threadId = nullptr;
+  m_expLocs.clear();
 }
 
 // =====================================================================================================================
@@ -1278,6 +1279,12 @@ void PatchInOutImportExport::visitReturnInst(ReturnInst &retInst) {
       // the export count.
       auto resUsage = m_pipelineState->getShaderResourceUsage(m_shaderStage);
       for (auto locMap : resUsage->inOutUsage.outputLocMap) {
+        if (m_shaderStage == ShaderStageCopyShader) {
+          // The copy shader only exports the geometry shader outputs of the rasterization stream.
+          unsigned outLocInfo = locMap.first;
+          if (reinterpret_cast<GsOutLocInfo *>(&outLocInfo)->streamId != resUsage->inOutUsage.gs.rasterStream)
+            continue;
+        }
         if (m_expLocs.count(locMap.second) != 0)
           continue;
         ++inOutUsage.expCount;
@@ -5161,6 +5168,7 @@ void PatchInOutImportExport::addExportInstForGenericOutput(Value *output, unsign
   (void(useExpInst)); // unused
 
   auto outputTy = output->getType();
+  m_expLocs.insert(location);
 
   auto &inOutUsage = m_pipelineState->getShaderResourceUsage(m_shaderStage)->inOutUsage;
 
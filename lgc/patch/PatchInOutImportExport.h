@@ -235,7 +235,7 @@ private:
   std::vector<llvm::CallInst *> m_exportCalls;                 // List of "call" instructions to export outputs
   PipelineState *m_pipelineState = nullptr;                    // Pipeline state from PipelineStateWrapper pass
 
-  std::set<unsigned> m_expLocs; // The locations that already have an export instruction for the vertex shader.
+  std::set<unsigned> m_expLocs; // The locations that already have an export instruction in the current shader.
 };
 
 } // namespace lgc
@@ -1211,9 +1211,12 @@ void PatchResourceCollect::visitCallInst(CallInst &callInst) {
 // =====================================================================================================================
 // Clears inactive (those actually unused) inputs.
 void PatchResourceCollect::clearInactiveInput() {
-  // Clear those inactive generic inputs, remove them from location mappings
+  // Clear those inactive generic inputs, remove them from location mappings. For an unlinked shader or half-pipeline,
+  // the inputs of its first stage are kept, as they need to match what the other side of the link provides.
+  bool keepUnlinkedInputs = m_pipelineState->isUnlinked() &&
+                            m_pipelineState->getPrevShaderStage(m_shaderStage) == ShaderStageInvalid;
   if (m_pipelineState->isGraphics() && !m_hasDynIndexedInput && m_shaderStage != ShaderStageTessEval &&
-      !m_pipelineState->isUnlinked()) {
+      !keepUnlinkedInputs) {
     // TODO: Here, we keep all generic inputs of tessellation evaluation shader. This is because corresponding
     // generic outputs of tessellation control shader might involve in output import and dynamic indexing, which
     // is easy to cause incorrectness of location mapping.
@@ -1510,8 +1513,9 @@ void PatchResourceCollect::matchGenericInOut() {
   auto &perPatchInLocMap = inOutUsage.perPatchInputLocMap;
   auto &perPatchOutLocMap = inOutUsage.perPatchOutputLocMap;
 
-  // Do input/output matching
-  if (!m_pipelineState->isUnlinked() && m_shaderStage != ShaderStageFragment) {
+  // Do input/output matching. For an unlinked half-pipeline, this matches the stages within the half; the outputs of
+  // its last vertex-processing stage have no next stage, so are all kept.
+  if (m_shaderStage != ShaderStageFragment) {
     const auto nextStage = m_pipelineState->getNextShaderStage(m_shaderStage);
 
     // Do normal input/output matching
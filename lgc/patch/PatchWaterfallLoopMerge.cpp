@@ -0,0 +1,238 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  PatchWaterfallLoopMerge.cpp
+* @brief LLPC source file: contains declaration and implementation of class lgc::PatchWaterfallLoopMerge.
+***********************************************************************************************************************
+*/
+#include "lgc/patch/Patch.h"
+#include "lgc/state/IntrinsDefs.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsAMDGPU.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "lgc-patch-waterfall-loop-merge"
+
+using namespace llvm;
+using namespace lgc;
+
+namespace lgc {
+
+// =====================================================================================================================
+// Pass to merge adjacent waterfall loops that use the same non-uniform index.
+//
+// Builder::createWaterfallLoop() puts each non-uniform image operation into its own waterfall loop, delimited by
+// llvm.amdgcn.waterfall.begin and llvm.amdgcn.waterfall.end (or llvm.amdgcn.waterfall.last.use for an operation
+// with no result). When several of those loops in the same basic block use the same index, the later ones iterate
+// over exactly the same groups of lanes, so they are merged into the first one by making them share its
+// waterfall.begin.
+class PatchWaterfallLoopMerge final : public FunctionPass {
+public:
+  static char ID;
+  PatchWaterfallLoopMerge() : FunctionPass(ID) {}
+
+  void getAnalysisUsage(AnalysisUsage &analysisUsage) const override { analysisUsage.setPreservesCFG(); }
+
+  bool runOnFunction(Function &function) override;
+
+  PatchWaterfallLoopMerge(const PatchWaterfallLoopMerge &) = delete;
+  PatchWaterfallLoopMerge &operator=(const PatchWaterfallLoopMerge &) = delete;
+
+private:
+  bool mergeWaterfallLoops(BasicBlock &block);
+};
+
+char PatchWaterfallLoopMerge::ID = 0;
+
+} // namespace lgc
+
+// =====================================================================================================================
+// Create pass to merge adjacent waterfall loops
+FunctionPass *lgc::createPatchWaterfallLoopMerge() {
+  return new PatchWaterfallLoopMerge();
+}
+
+// =====================================================================================================================
+// Checks whether the specified instruction is a call of the given intrinsic.
+//
+// @param inst : Instruction to check
+// @param intrinsicId : Intrinsic ID
+static bool isIntrinsicCall(const Instruction &inst, Intrinsic::ID intrinsicId) {
+  auto intrinsic = dyn_cast<IntrinsicInst>(&inst);
+  return intrinsic && intrinsic->getIntrinsicID() == intrinsicId;
+}
+
+// =====================================================================================================================
+// Checks whether two waterfall indices are the same. An index made of two values (image resource + sampler) is built
+// with a chain of insertvalue instructions, which is compared element by element.
+//
+// @param index1 : Index of the first waterfall loop
+// @param index2 : Index of the second waterfall loop
+static bool isSameWaterfallIndex(Value *index1, Value *index2) {
+  if (index1 == index2)
+    return true;
+
+  auto insert1 = dyn_cast<InsertValueInst>(index1);
+  auto insert2 = dyn_cast<InsertValueInst>(index2);
+  if (!insert1 || !insert2 || insert1->getIndices() != insert2->getIndices() ||
+      insert1->getInsertedValueOperand() != insert2->getInsertedValueOperand())
+    return false;
+  return isSameWaterfallIndex(insert1->getAggregateOperand(), insert2->getAggregateOperand());
+}
+
+// =====================================================================================================================
+// Checks whether an instruction that lies between two waterfall loops can be moved into the merged loop, where it is
+// executed once per loop iteration with only the lanes of that iteration enabled.
+//
+// @param inst : Instruction to check
+static bool canMoveIntoWaterfallLoop(const Instruction &inst) {
+  if (isa<PHINode>(inst) || inst.isTerminator())
+    return false;
+
+  // Descriptor loads from constant memory are fine to repeat.
+  if (auto load = dyn_cast<LoadInst>(&inst))
+    return !load->isVolatile() && load->getPointerAddressSpace() == ADDR_SPACE_CONST;
+
+  // Cross-lane operations would see a different set of lanes inside the loop.
+  if (auto call = dyn_cast<CallInst>(&inst)) {
+    if (call->isConvergent() || !call->doesNotAccessMemory())
+      return false;
+  }
+
+  return !inst.mayReadOrWriteMemory() && !inst.mayHaveSideEffects();
+}
+
+// =====================================================================================================================
+// Checks whether anything in the waterfall loop started by the specified waterfall.begin depends, directly or through
+// instructions outside the loop, on any of the specified values. Such a loop cannot be merged into the loop that
+// computes those values, as they are only complete once that loop has finished.
+//
+// @param waterfallBegin : waterfall.begin of the loop to check
+// @param values : Values to look for
+static bool waterfallLoopDependsOn(Instruction &waterfallBegin, const SmallPtrSetImpl<Value *> &values) {
+  SmallPtrSet<Value *, 8> loopValues;
+  SmallPtrSet<Value *, 8> dependentValues(values.begin(), values.end());
+  loopValues.insert(&waterfallBegin);
+
+  for (Instruction &inst : make_range(std::next(waterfallBegin.getIterator()), waterfallBegin.getParent()->end())) {
+    bool inLoop = false;
+    bool dependent = false;
+    for (Value *operand : inst.operands()) {
+      inLoop |= loopValues.count(operand) != 0;
+      dependent |= dependentValues.count(operand) != 0;
+    }
+    if (inLoop && dependent)
+      return true;
+    if (inLoop)
+      loopValues.insert(&inst);
+    else if (dependent)
+      dependentValues.insert(&inst);
+  }
+  return false;
+}
+
+// =====================================================================================================================
+// Executes this LLVM pass on the specified LLVM function.
+//
+// @param [in,out] function : Function that will run this optimization.
+bool PatchWaterfallLoopMerge::runOnFunction(Function &function) {
+  LLVM_DEBUG(dbgs() << "Run the pass Patch-Waterfall-Loop-Merge\n");
+
+  bool changed = false;
+  for (BasicBlock &block : function)
+    changed |= mergeWaterfallLoops(block);
+  return changed;
+}
+
+// =====================================================================================================================
+// Merges adjacent waterfall loops with the same index in the specified basic block. Two loops are adjacent if all
+// instructions between them can be moved into the merged loop (see canMoveIntoWaterfallLoop()), and neither those
+// instructions nor the second loop use a result of the first loop, which is only complete once the loop has finished.
+//
+// @param [in,out] block : Basic block to process
+bool PatchWaterfallLoopMerge::mergeWaterfallLoops(BasicBlock &block) {
+  Instruction *waterfallBegin = nullptr; // waterfall.begin of the current (possibly merged) waterfall loop
+  SmallPtrSet<Value *, 8> loopValues;    // Values computed inside the current loop, apart from its results
+  SmallPtrSet<Value *, 8> loopResults;   // Results of the current loop (waterfall.end)
+  bool canMerge = false;                 // Whether a following loop could be merged into the current one
+  unsigned mergedCount = 0;
+
+  for (auto instIt = block.begin(), instEnd = block.end(); instIt != instEnd;) {
+    Instruction &inst = *instIt++;
+
+    if (isIntrinsicCall(inst, Intrinsic::amdgcn_waterfall_begin)) {
+      if (waterfallBegin && canMerge && isSameWaterfallIndex(waterfallBegin->getOperand(0), inst.getOperand(0)) &&
+          !waterfallLoopDependsOn(inst, loopResults)) {
+        // Merge this loop into the current one.
+        inst.replaceAllUsesWith(waterfallBegin);
+        inst.eraseFromParent();
+        ++mergedCount;
+        continue;
+      }
+
+      // Start a new loop.
+      waterfallBegin = &inst;
+      loopValues.clear();
+      loopResults.clear();
+      canMerge = true;
+      continue;
+    }
+
+    if (!waterfallBegin)
+      continue;
+
+    bool inLoop = false;
+    bool usesLoopResult = false;
+    for (Value *operand : inst.operands()) {
+      if (operand == waterfallBegin || loopValues.count(operand) != 0)
+        inLoop = true;
+      else if (loopResults.count(operand) != 0)
+        usesLoopResult = true;
+    }
+
+    if (inLoop) {
+      if (isIntrinsicCall(inst, Intrinsic::amdgcn_waterfall_end))
+        loopResults.insert(&inst);
+      else
+        loopValues.insert(&inst);
+    } else if (usesLoopResult || !canMoveIntoWaterfallLoop(inst))
+      canMerge = false;
+  }
+
+  if (mergedCount == 0)
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Merged " << mergedCount << " waterfall loop(s) in " << block.getParent()->getName() << "\n");
+  return true;
+}
+
+// =====================================================================================================================
+// Initializes the pass
+INITIALIZE_PASS(PatchWaterfallLoopMerge, DEBUG_TYPE, "Patch LLVM to merge adjacent waterfall loops", false, false)
@@ -35,6 +35,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
+#include <algorithm>
 
 #define DEBUG_TYPE "lgc-vertex-fetch"
 
@@ -264,6 +265,8 @@ VertexFetch::VertexFetch(Function *entryPoint, ShaderSystemValues *shaderSysValu
     m_instanceIndex = BinaryOperator::CreateAdd(m_baseInstance, m_instanceId, "", &*insertPos);
   }
 
+  m_entryInsertPos = &*insertPos;
+
   // Initialize default fetch values
   auto zero = ConstantInt::get(Type::getInt32Ty(*m_context), 0);
   auto one = ConstantInt::get(Type::getInt32Ty(*m_context), 1);
@@ -301,51 +304,26 @@ VertexFetch::VertexFetch(Function *entryPoint, ShaderSystemValues *shaderSysValu
   auto doubleOne0 = ConstantInt::get(Type::getInt32Ty(*m_context), doubleOne.u32[0]);
   auto doubleOne1 = ConstantInt::get(Type::getInt32Ty(*m_context), doubleOne.u32[1]);
   m_fetchDefaults.double64 = ConstantVector::get({zero, zero, zero, zero, zero, zero, doubleOne0, doubleOne1});
+
+  buildCoalescedVertexFetches();
 }
 
 // =====================================================================================================================
-// Executes vertex fetch operations based on the specified vertex input type and its location.
+// Does vertex fetch operations for a single vertex attribute. Returns the fetched components as i32 or <n x i32>.
 //
-// @param inputTy : Type of vertex input
-// @param location : Location of vertex input
-// @param compIdx : Index used for vector element indexing
+// @param description : Vertex input description
+// @param is16bitFetch : Whether it is 16-bit vertex fetch
 // @param insertPos : Where to insert vertex fetch instructions
-Value *VertexFetch::run(Type *inputTy, unsigned location, unsigned compIdx, Instruction *insertPos) {
-  Value *vertex = nullptr;
-
-  // Get vertex input description for the given location
-  const VertexInputDescription *description = m_pipelineState->findVertexInputDescription(location);
-
-  // NOTE: If we could not find vertex input info matching this location, just return undefined value.
-  if (!description)
-    return UndefValue::get(inputTy);
-
+Value *VertexFetch::fetchVertex(const VertexInputDescription *description, bool is16bitFetch, Instruction *insertPos) {
   auto vbDesc = loadVertexBufferDescriptor(description->binding, insertPos);
 
-  Value *vbIndex = nullptr;
-  if (description->inputRate == VertexInputRateVertex)
-    vbIndex = getVertexIndex(); // Use vertex index
-  else {
-    if (description->inputRate == VertexInputRateNone)
-      vbIndex = m_baseInstance;
-    else if (description->inputRate == VertexInputRateInstance)
-      vbIndex = getInstanceIndex(); // Use instance index
-    else {
-      // There is a divisor.
-      vbIndex = BinaryOperator::CreateUDiv(
-          m_instanceId, ConstantInt::get(Type::getInt32Ty(*m_context), description->inputRate), "", insertPos);
-      vbIndex = BinaryOperator::CreateAdd(vbIndex, m_baseInstance, "", insertPos);
-    }
-  }
+  Value *vbIndex = getVertexBufferIndex(description, insertPos);
 
   Value *vertexFetches[2] = {}; // Two vertex fetch operations might be required
   Value *vertexFetch = nullptr; // Coalesced vector by combining the results of two vertex fetch operations
 
   VertexFormatInfo formatInfo = getVertexFormatInfo(description);
 
-  const bool is8bitFetch = (inputTy->getScalarSizeInBits() == 8);
-  const bool is16bitFetch = (inputTy->getScalarSizeInBits() == 16);
-
   // Do the first vertex fetch operation
   addVertexFetchInst(vbDesc, formatInfo.numChannels, is16bitFetch, vbIndex, description->offset, description->stride,
                      formatInfo.dfmt, formatInfo.nfmt, insertPos, &vertexFetches[0]);
@@ -478,6 +456,36 @@ Value *VertexFetch::run(Type *inputTy, unsigned location, unsigned compIdx, Inst
   } else
     vertexFetch = vertexFetches[0];
 
+  return vertexFetch;
+}
+
+// =====================================================================================================================
+// Executes vertex fetch operations based on the specified vertex input type and its location.
+//
+// @param inputTy : Type of vertex input
+// @param location : Location of vertex input
+// @param compIdx : Index used for vector element indexing
+// @param insertPos : Where to insert vertex fetch instructions
+Value *VertexFetch::run(Type *inputTy, unsigned location, unsigned compIdx, Instruction *insertPos) {
+  Value *vertex = nullptr;
+
+  // Get vertex input description for the given location
+  const VertexInputDescription *description = m_pipelineState->findVertexInputDescription(location);
+
+  // NOTE: If we could not find vertex input info matching this location, just return undefined value.
+  if (!description)
+    return UndefValue::get(inputTy);
+
+  const bool is8bitFetch = (inputTy->getScalarSizeInBits() == 8);
+  const bool is16bitFetch = (inputTy->getScalarSizeInBits() == 16);
+
+  // NOTE: The coalesced vertex fetch returns 32-bit components, so it is not used for 8-bit and 16-bit vertex inputs.
+  Value *vertexFetch = nullptr;
+  if (!is8bitFetch && !is16bitFetch && m_coalescedFetchLocs.count(location) != 0)
+    vertexFetch = fetchCoalescedVertex(location);
+  else
+    vertexFetch = fetchVertex(description, is16bitFetch, insertPos);
+
   // Finalize vertex fetch
   Type *basicTy = inputTy->isVectorTy() ? cast<VectorType>(inputTy)->getElementType() : inputTy;
   const unsigned bitWidth = basicTy->getScalarSizeInBits();
@@ -589,6 +597,133 @@ Value *VertexFetch::run(Type *inputTy, unsigned location, unsigned compIdx, Inst
   return vertex;
 }
 
+// =====================================================================================================================
+// Gets the index of the vertex in the vertex buffer, according to the input rate of the vertex attribute.
+//
+// @param description : Vertex input description
+// @param insertPos : Where to insert instructions
+Value *VertexFetch::getVertexBufferIndex(const VertexInputDescription *description, Instruction *insertPos) {
+  Value *vbIndex = nullptr;
+  if (description->inputRate == VertexInputRateVertex)
+    vbIndex = getVertexIndex(); // Use vertex index
+  else {
+    if (description->inputRate == VertexInputRateNone)
+      vbIndex = m_baseInstance;
+    else if (description->inputRate == VertexInputRateInstance)
+      vbIndex = getInstanceIndex(); // Use instance index
+    else {
+      // There is a divisor.
+      vbIndex = BinaryOperator::CreateUDiv(
+          m_instanceId, ConstantInt::get(Type::getInt32Ty(*m_context), description->inputRate), "", insertPos);
+      vbIndex = BinaryOperator::CreateAdd(vbIndex, m_baseInstance, "", insertPos);
+    }
+  }
+
+  return vbIndex;
+}
+
+// Data formats of coalesced vertex fetches, indexed by the number of 32-bit channels
+static const BufDataFormat CoalescedFetchDfmts[] = {BufDataFormatInvalid, BufDataFormat32, BufDataFormat32_32,
+                                                    BufDataFormat32_32_32, BufDataFormat32_32_32_32};
+
+// =====================================================================================================================
+// Groups vertex attributes that could share a single vertex fetch. Attributes qualify if they are read by the vertex
+// shader, belong to the same binding, have the same numeric format with 32-bit components and are packed contiguously
+// in the vertex buffer. The widest group (up to four channels) is chosen whose fetch still reads the whole vertex in
+// one operation (see addVertexFetchInst()).
+void VertexFetch::buildCoalescedVertexFetches() {
+  const auto &inputLocMap = m_pipelineState->getShaderResourceUsage(ShaderStageVertex)->inOutUsage.inputLocMap;
+
+  // Collect candidate vertex attributes for each binding
+  std::map<unsigned, std::vector<const VertexInputDescription *>> bindingAttribs;
+  for (const VertexInputDescription &description : m_pipelineState->getVertexInputDescriptions()) {
+    if (inputLocMap.count(description.location) == 0)
+      continue;
+    if (description.dfmt != BufDataFormat32 && description.dfmt != BufDataFormat32_32 &&
+        description.dfmt != BufDataFormat32_32_32 && description.dfmt != BufDataFormat32_32_32_32)
+      continue;
+    bindingAttribs[description.binding].push_back(&description);
+  }
+
+  for (auto &bindingAttrib : bindingAttribs) {
+    auto &attribs = bindingAttrib.second;
+    std::sort(attribs.begin(), attribs.end(),
+              [](const VertexInputDescription *lhs, const VertexInputDescription *rhs) {
+                return lhs->offset < rhs->offset;
+              });
+
+    for (unsigned first = 0; first < attribs.size();) {
+      // Extend the group while the next attribute immediately follows the previous one
+      unsigned end = first + 1;
+      unsigned numChannels = getVertexFormatInfo(attribs[first]).numChannels;
+      for (; end < attribs.size(); ++end) {
+        const VertexInputDescription *prev = attribs[end - 1];
+        const VertexInputDescription *next = attribs[end];
+        const unsigned nextChannels = getVertexFormatInfo(next).numChannels;
+        if (next->offset != prev->offset + getVertexComponentFormatInfo(prev->dfmt)->vertexByteSize ||
+            next->nfmt != prev->nfmt || next->stride != prev->stride || next->inputRate != prev->inputRate ||
+            numChannels + nextChannels > 4)
+          break;
+        numChannels += nextChannels;
+      }
+
+      // Shrink the group until its offset and stride are aligned on the data format boundary of the coalesced fetch;
+      // otherwise the fetch would be split into per-component fetches.
+      for (; end - first > 1; --end) {
+        const unsigned vertexByteSize = getVertexComponentFormatInfo(CoalescedFetchDfmts[numChannels])->vertexByteSize;
+        if (attribs[first]->offset % vertexByteSize == 0 && attribs[first]->stride % vertexByteSize == 0)
+          break;
+        numChannels -= getVertexFormatInfo(attribs[end - 1]).numChannels;
+      }
+
+      if (end - first > 1) {
+        unsigned channel = 0;
+        for (unsigned i = first; i < end; ++i) {
+          m_coalescedFetchLocs[attribs[i]->location] = {static_cast<unsigned>(m_coalescedFetches.size()), channel};
+          channel += getVertexFormatInfo(attribs[i]).numChannels;
+        }
+        m_coalescedFetches.push_back({attribs[first], numChannels, nullptr});
+      }
+      first = end;
+    }
+  }
+}
+
+// =====================================================================================================================
+// Gets the components of a vertex attribute from its coalesced vertex fetch, doing the fetch on first use. Returns the
+// components as i32 or <n x i32>.
+//
+// @param location : Location of vertex input
+Value *VertexFetch::fetchCoalescedVertex(unsigned location) {
+  const auto &fetchLoc = m_coalescedFetchLocs[location];
+  CoalescedVertexFetch &coalescedFetch = m_coalescedFetches[fetchLoc.first];
+
+  if (!coalescedFetch.fetch) {
+    // NOTE: The coalesced vertex fetch is shared by vertex inputs that might be imported at different places, so it
+    // is placed in the entry block, where the vertex and instance indices are calculated.
+    const VertexInputDescription *description = coalescedFetch.description;
+    auto vbDesc = loadVertexBufferDescriptor(description->binding, m_entryInsertPos);
+    Value *vbIndex = getVertexBufferIndex(description, m_entryInsertPos);
+    addVertexFetchInst(vbDesc, coalescedFetch.numChannels, false, vbIndex, description->offset, description->stride,
+                       CoalescedFetchDfmts[coalescedFetch.numChannels], description->nfmt, m_entryInsertPos,
+                       &coalescedFetch.fetch);
+  }
+
+  // Extract the components of this vertex attribute
+  const unsigned numChannels = getVertexFormatInfo(m_pipelineState->findVertexInputDescription(location)).numChannels;
+  if (numChannels == 1) {
+    return ExtractElementInst::Create(coalescedFetch.fetch,
+                                      ConstantInt::get(Type::getInt32Ty(*m_context), fetchLoc.second), "",
+                                      m_entryInsertPos);
+  }
+
+  std::vector<Constant *> shuffleMask;
+  for (unsigned i = 0; i < numChannels; ++i)
+    shuffleMask.push_back(ConstantInt::get(Type::getInt32Ty(*m_context), fetchLoc.second + i));
+  return new ShuffleVectorInst(coalescedFetch.fetch, coalescedFetch.fetch, ConstantVector::get(shuffleMask), "",
+                               m_entryInsertPos);
+}
+
 // =====================================================================================================================
 // Gets info from table according to vertex attribute format.
 //
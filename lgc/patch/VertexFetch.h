@@ -34,6 +34,7 @@
 #include "lgc/Pipeline.h"
 #include "lgc/state/IntrinsDefs.h"
 #include "lgc/util/Internal.h"
+#include <map>
 
 namespace lgc {
 
@@ -59,6 +60,14 @@ struct VertexCompFormatInfo {
   BufDataFmt compDfmt;     // Equivalent data format of each component
 };
 
+// Represents a vertex fetch shared by several vertex attributes of the same binding whose 32-bit components are packed
+// contiguously in the vertex buffer.
+struct CoalescedVertexFetch {
+  const VertexInputDescription *description; // Vertex input description of the attribute with the lowest offset
+  unsigned numChannels;                       // Total number of channels of the coalesced attributes
+  llvm::Value *fetch;                         // Result of the coalesced vertex fetch (created on first use)
+};
+
 // =====================================================================================================================
 // Represents the manager of vertex fetch operations.
 class VertexFetch {
@@ -86,6 +95,14 @@ private:
 
   llvm::Value *loadVertexBufferDescriptor(unsigned binding, llvm::Instruction *insertPos) const;
 
+  llvm::Value *getVertexBufferIndex(const VertexInputDescription *description, llvm::Instruction *insertPos);
+
+  llvm::Value *fetchVertex(const VertexInputDescription *description, bool is16bitFetch, llvm::Instruction *insertPos);
+
+  void buildCoalescedVertexFetches();
+
+  llvm::Value *fetchCoalescedVertex(unsigned location);
+
   void addVertexFetchInst(llvm::Value *vbDesc, unsigned numChannels, bool is16bitFetch, llvm::Value *vbIndex,
                           unsigned offset, unsigned stride, unsigned dfmt, unsigned nfmt, llvm::Instruction *insertPos,
                           llvm::Value **ppFetch) const;
@@ -106,6 +123,12 @@ private:
   llvm::Value *m_baseInstance;  // Base instance
   llvm::Value *m_instanceId;    // Instance ID
 
+  llvm::Instruction *m_entryInsertPos; // Insert position in the entry block, after vertex/instance index calculation
+
+  std::vector<CoalescedVertexFetch> m_coalescedFetches; // Vertex fetches shared by several vertex attributes
+  // Map from vertex attribute location to the index of its coalesced vertex fetch and its first channel in that fetch
+  std::map<unsigned, std::pair<unsigned, unsigned>> m_coalescedFetchLocs;
+
   static const VertexCompFormatInfo MVertexCompFormatInfo[]; // Info table of vertex component format
   static const BufFormat MVertexFormatMap[];                 // Info table of vertex format mapping
 
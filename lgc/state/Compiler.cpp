@@ -47,6 +47,8 @@ using namespace llvm;
 namespace lgc {
 // Create BuilderReplayer pass
 ModulePass *createBuilderReplayer(Pipeline *pipeline);
+// Create ElfLinker object
+ElfLinker *createElfLinkerImpl(PipelineState *pipelineState, ArrayRef<MemoryBufferRef> elfs);
 } // namespace lgc
 
 // =====================================================================================================================
@@ -163,6 +165,7 @@ bool PipelineState::generate(std::unique_ptr<Module> pipelineModule, raw_pwrite_
   // Set up "whole pipeline" passes, where we have a single module representing the whole pipeline.
   std::unique_ptr<PassManager> passMgr(PassManager::Create());
   passMgr->setPassIndex(&passIndex);
+  passMgr->setPassProfiler(getLgcContext()->getPassProfiler());
   passMgr->add(createTargetTransformInfoWrapperPass(getLgcContext()->getTargetMachine()->getTargetIRAnalysis()));
 
   // Manually add a target-aware TLI pass, so optimizations do not think that we have library functions.
@@ -194,7 +197,8 @@ bool PipelineState::generate(std::unique_ptr<Module> pipelineModule, raw_pwrite_
   // Add pass to clear pipeline state from IR
   passMgr->add(createPipelineStateClearer());
 
-  // Code generation.
+  // Code generation. The codegen passes are not profiled individually.
+  passMgr->stopProfiling();
   getLgcContext()->addTargetPasses(*passMgr, codeGenTimer, outStream);
 
   // Run the "whole pipeline" passes.
@@ -206,9 +210,26 @@ bool PipelineState::generate(std::unique_ptr<Module> pipelineModule, raw_pwrite_
 // =====================================================================================================================
 // Create an ELF linker object for linking unlinked half-pipeline ELFs into a pipeline ELF using the pipeline state.
 // This needs to be deleted after use.
+//
+// @param elfs : Array of unlinked shader/half-pipeline ELFs to link, in shader stage order
 ElfLinker *PipelineState::createElfLinker(llvm::ArrayRef<llvm::MemoryBufferRef> elfs) {
-  llvm_unreachable("Not implemented yet");
-  return nullptr;
+  return createElfLinkerImpl(this, elfs);
+}
+
+// =====================================================================================================================
+// Returns true if the given user data nodes (or the nodes in their descriptor tables) contain a compact buffer
+// descriptor. An unlinked shader assumes that each buffer descriptor is a full descriptor in a descriptor table.
+//
+// @param nodes : User data nodes to check
+static bool hasCompactBufferDescriptor(ArrayRef<ResourceNode> nodes) {
+  for (const ResourceNode &node : nodes) {
+    if (node.type == ResourceNodeType::DescriptorTableVaPtr) {
+      if (hasCompactBufferDescriptor(node.innerTable))
+        return true;
+    } else if (node.type == ResourceNodeType::DescriptorBufferCompact)
+      return true;
+  }
+  return false;
 }
 
 // =====================================================================================================================
@@ -222,6 +243,15 @@ ElfLinker *PipelineState::createElfLinker(llvm::ArrayRef<llvm::MemoryBufferRef>
 // @return : True for success, false if some reason for failure found, in which case getLastError()
 //           returns a textual description
 bool PipelineState::checkElfLinkable() {
+  m_lastError.clear();
+  if (isGraphics() && (!hasShaderStage(ShaderStageVertex) || !hasShaderStage(ShaderStageFragment))) {
+    setError("ELF linking requires both a vertex shader and a fragment shader in a graphics pipeline");
+    return false;
+  }
+  if (hasCompactBufferDescriptor(getUserDataNodes())) {
+    setError("ELF linking does not support compact buffer descriptors");
+    return false;
+  }
   return true;
 }
 
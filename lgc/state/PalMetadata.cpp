@@ -44,6 +44,17 @@
 using namespace lgc;
 using namespace llvm;
 
+namespace {
+
+// =====================================================================================================================
+// A workaround to support erase in llvm::msgpack::MapDocNode.
+class MapDocNode : public msgpack::MapDocNode {
+public:
+  MapTy::iterator erase(MapTy::iterator where) { return Map->erase(where); }
+};
+
+} // anonymous namespace
+
 // =====================================================================================================================
 // Construct empty object
 PalMetadata::PalMetadata(PipelineState *pipelineState) : m_pipelineState(pipelineState) {
@@ -72,6 +83,19 @@ PalMetadata::PalMetadata(PipelineState *pipelineState, Module *module) : m_pipel
   initialize();
 }
 
+// =====================================================================================================================
+// Constructor given a PAL metadata blob from an unlinked half-pipeline ELF. This is used by the ELF linker.
+//
+// @param pipelineState : PipelineState
+// @param blob : MsgPack PAL metadata blob
+PalMetadata::PalMetadata(PipelineState *pipelineState, StringRef blob) : m_pipelineState(pipelineState) {
+  m_document = new msgpack::Document;
+  bool success = m_document->readFromBlob(blob, /*multi=*/false);
+  assert(success && "Bad PAL metadata format");
+  ((void)success);
+  initialize();
+}
+
 // =====================================================================================================================
 // Destructor
 PalMetadata::~PalMetadata() {
@@ -99,21 +123,196 @@ void PalMetadata::initialize() {
 //
 // @param module : Pipeline IR module
 void PalMetadata::record(Module *module) {
-  // Add the metadata version number.
-  auto versionNode = m_document->getRoot().getMap(true)[Util::Abi::PalCodeObjectMetadataKey::Version].getArray(true);
-  versionNode[0] = m_document->getNode(Util::Abi::PipelineMetadataMajorVersion);
-  versionNode[1] = m_document->getNode(Util::Abi::PipelineMetadataMinorVersion);
-
   // Write the MsgPack document into an IR metadata node.
   // The IR named metadata node contains an MDTuple containing an MDString containing the msgpack data.
   std::string blob;
-  m_document->writeToBlob(blob);
+  writeToBlob(blob);
   MDString *abiMetaString = MDString::get(module->getContext(), blob);
   MDNode *abiMetaNode = MDNode::get(module->getContext(), abiMetaString);
   NamedMDNode *namedMeta = module->getOrInsertNamedMetadata(PalMetadataName);
   namedMeta->addOperand(abiMetaNode);
 }
 
+// =====================================================================================================================
+// Write the PAL metadata out into a MsgPack blob. This adds the metadata version number.
+//
+// @param [out] blob : String to write the blob into
+void PalMetadata::writeToBlob(std::string &blob) {
+  auto versionNode = m_document->getRoot().getMap(true)[Util::Abi::PalCodeObjectMetadataKey::Version].getArray(true);
+  versionNode[0] = m_document->getNode(Util::Abi::PipelineMetadataMajorVersion);
+  versionNode[1] = m_document->getNode(Util::Abi::PipelineMetadataMinorVersion);
+  m_document->writeToBlob(blob);
+}
+
+// =====================================================================================================================
+// Merge the PAL metadata of an unlinked fragment-shader half-pipeline ELF into this one, which is the PAL metadata
+// of the other half-pipeline. The PS hardware stage, the pixel shader and the fragment-shader-related registers are
+// taken from the fragment half; the user data limit and spill threshold are combined.
+//
+// @param blob : MsgPack PAL metadata blob of the fragment half-pipeline
+void PalMetadata::mergeFromBlob(StringRef blob) {
+  msgpack::Document srcDocument;
+  bool success = srcDocument.readFromBlob(blob, /*multi=*/false);
+  assert(success && "Bad PAL metadata format");
+  ((void)success);
+  auto srcPipeline =
+      srcDocument.getRoot().getMap(true)[Util::Abi::PalCodeObjectMetadataKey::Pipelines].getArray(true)[0].getMap(
+          true);
+
+  // Take .num_interpolants from the fragment half.
+  auto srcNumInterpIt = srcPipeline.find(StringRef(Util::Abi::PipelineMetadataKey::NumInterpolants));
+  if (srcNumInterpIt != srcPipeline.end())
+    m_pipelineNode[Util::Abi::PipelineMetadataKey::NumInterpolants] = copyNode(srcNumInterpIt->second);
+
+  // Combine .user_data_limit and .spill_threshold.
+  msgpack::DocNode &srcUserDataLimit = srcPipeline[Util::Abi::PipelineMetadataKey::UserDataLimit];
+  if (srcUserDataLimit.getKind() == msgpack::Type::UInt && srcUserDataLimit.getUInt() > m_userDataLimit->getUInt())
+    *m_userDataLimit = m_document->getNode(srcUserDataLimit.getUInt());
+  msgpack::DocNode &srcSpillThreshold = srcPipeline[Util::Abi::PipelineMetadataKey::SpillThreshold];
+  if (srcSpillThreshold.getKind() == msgpack::Type::UInt)
+    setUserDataSpillUsage(srcSpillThreshold.getUInt());
+
+  // Take the whole .ps hardware stage and .pixel shader.
+  auto hwPsStageName = HwStageNames[static_cast<unsigned>(Util::Abi::HardwareStage::Ps)];
+  m_pipelineNode[Util::Abi::PipelineMetadataKey::HardwareStages].getMap(true)[hwPsStageName] =
+      copyNode(srcPipeline[Util::Abi::PipelineMetadataKey::HardwareStages].getMap(true)[hwPsStageName]);
+  m_pipelineNode[Util::Abi::PipelineMetadataKey::Shaders].getMap(true)[ApiStageNames[ShaderStageFragment]] =
+      copyNode(srcPipeline[Util::Abi::PipelineMetadataKey::Shaders].getMap(true)[ApiStageNames[ShaderStageFragment]]);
+
+  // Fragment-shader-related registers, other than SPI_PS_INPUT_CNTL_* and the PS user data registers.
+  static const unsigned PsRegNumbers[] = {
+      0x2C0A, // mmSPI_SHADER_PGM_RSRC1_PS
+      0x2C0B, // mmSPI_SHADER_PGM_RSRC2_PS
+      0xA1C4, // mmSPI_SHADER_Z_FORMAT
+      0xA1C5, // mmSPI_SHADER_COL_FORMAT
+      0xA1B8, // mmSPI_BARYC_CNTL
+      0xA1B6, // mmSPI_PS_IN_CONTROL
+      0xA1B3, // mmSPI_PS_INPUT_ENA
+      0xA1B4, // mmSPI_PS_INPUT_ADDR
+      0xA1B5, // mmSPI_INTERP_CONTROL_0
+      0xA293, // mmPA_SC_MODE_CNTL_1
+      0xA203, // mmDB_SHADER_CONTROL
+      0xA08F, // mmCB_SHADER_MASK
+      0xA2F8, // mmPA_SC_AA_CONFIG
+      // The following ones are GFX9+ only, but we don't need to handle them specially as those register
+      // numbers are not used at all on earlier chips.
+      0xA310, // mmPA_SC_SHADER_CONTROL
+      0xA210, // mmPA_STEREO_CNTL
+      0xC25F, // mmGE_STEREO_CNTL
+      0xC262, // mmGE_USER_VGPR_EN
+      0x2C06, // mmSPI_SHADER_PGM_CHKSUM_PS
+      0x2C32, // mmSPI_SHADER_USER_ACCUM_PS_0
+      0x2C33, // mmSPI_SHADER_USER_ACCUM_PS_1
+      0x2C34, // mmSPI_SHADER_USER_ACCUM_PS_2
+      0x2C35, // mmSPI_SHADER_USER_ACCUM_PS_3
+  };
+  const unsigned mmSpiPsInputCntl0 = 0xA191;
+  const unsigned mmSpiPsInputCntl31 = 0xA1B0;
+  unsigned psUserDataCount = m_pipelineState->getTargetInfo().getGfxIpVersion().major < 9 ? 16 : 32;
+
+  SmallVector<unsigned, 96> regNumbers(std::begin(PsRegNumbers), std::end(PsRegNumbers));
+  for (unsigned regNumber = mmSpiPsInputCntl0; regNumber != mmSpiPsInputCntl31 + 1; ++regNumber)
+    regNumbers.push_back(regNumber);
+  for (unsigned regNumber = mmSPI_SHADER_USER_DATA_PS_0; regNumber != mmSPI_SHADER_USER_DATA_PS_0 + psUserDataCount;
+       ++regNumber)
+    regNumbers.push_back(regNumber);
+
+  // For each of those registers, take the value from the fragment half, or clear it if the fragment half does
+  // not set it.
+  auto srcRegisters = srcPipeline[Util::Abi::PipelineMetadataKey::Registers].getMap(true);
+  for (unsigned regNumber : regNumbers) {
+    auto srcIt = srcRegisters.find(srcDocument.getNode(regNumber));
+    if (srcIt != srcRegisters.end()) {
+      m_registers[m_document->getNode(regNumber)] = copyNode(srcIt->second);
+    } else {
+      auto destIt = m_registers.find(m_document->getNode(regNumber));
+      if (destIt != m_registers.end())
+        static_cast<MapDocNode &>(m_registers).erase(destIt);
+    }
+  }
+}
+
+// =====================================================================================================================
+// Fix up user data registers that were set to a descriptor set or push constant reloc value when compiling an
+// unlinked shader (see PatchEntryPointMutate::addUserDataArgs), using the user data nodes in the pipeline state.
+//
+// @return : True for success, false if a descriptor set or the push constant is missing from the user data nodes,
+//           in which case the error has been set in the PipelineState
+bool PalMetadata::fixUpRegisters() {
+  unsigned gfxIpMajor = m_pipelineState->getTargetInfo().getGfxIpVersion().major;
+  for (unsigned stage = 0; stage != ShaderStageNativeStageCount; ++stage) {
+    if (!m_pipelineState->hasShaderStage(static_cast<ShaderStage>(stage)))
+      continue;
+    unsigned userDataReg0 = getUserDataReg0(static_cast<ShaderStage>(stage));
+    unsigned userDataCount = gfxIpMajor < 9 || stage == ShaderStageCompute ? 16 : 32;
+    for (unsigned regNumber = userDataReg0; regNumber != userDataReg0 + userDataCount; ++regNumber) {
+      auto it = m_registers.find(m_document->getNode(regNumber));
+      if (it == m_registers.end() || it->second.getKind() != msgpack::Type::UInt)
+        continue;
+      unsigned userDataValue = it->second.getUInt();
+      const ResourceNode *node = nullptr;
+      if ((userDataValue & DescRelocMagicMask) == DescRelocMagic) {
+        // Descriptor set: the value is the root user data offset of the descriptor table pointer for the set.
+        unsigned descSet = userDataValue & DescSetMask;
+        node = m_pipelineState->findResourceNode(ResourceNodeType::DescriptorTableVaPtr, descSet, 0).first;
+        if (!node) {
+          m_pipelineState->setError("Descriptor set " + Twine(descSet) + " not found in user data nodes");
+          return false;
+        }
+        userDataValue = node->offsetInDwords;
+      } else if ((userDataValue & DescRelocMagicMask) == DescRelocPushConst) {
+        // Dword within the push constant: add its offset to the root user data offset of the push constant.
+        node = m_pipelineState->findSingleRootResourceNode(ResourceNodeType::PushConst);
+        if (!node) {
+          m_pipelineState->setError("Push constant not found in user data nodes");
+          return false;
+        }
+        userDataValue = node->offsetInDwords + (userDataValue & ~DescRelocMagicMask);
+      } else
+        continue;
+
+      it->second = m_document->getNode(userDataValue);
+      if (userDataValue + 1 > m_userDataLimit->getUInt())
+        *m_userDataLimit = m_document->getNode(userDataValue + 1);
+    }
+  }
+  return true;
+}
+
+// =====================================================================================================================
+// Deep-copy a MsgPack node from another document into ours. Simply assigning the node would leave it referring to
+// the other document's storage.
+//
+// @param srcNode : Node in the other document
+msgpack::DocNode PalMetadata::copyNode(msgpack::DocNode srcNode) {
+  switch (srcNode.getKind()) {
+  case msgpack::Type::Map: {
+    msgpack::MapDocNode destMap = m_document->getMapNode();
+    for (auto &entry : srcNode.getMap())
+      destMap[copyNode(entry.first)] = copyNode(entry.second);
+    return destMap;
+  }
+  case msgpack::Type::Array: {
+    msgpack::ArrayDocNode destArray = m_document->getArrayNode();
+    for (auto &element : srcNode.getArray())
+      destArray.push_back(copyNode(element));
+    return destArray;
+  }
+  case msgpack::Type::String:
+    return m_document->getNode(srcNode.getString(), /*copy=*/true);
+  case msgpack::Type::UInt:
+    return m_document->getNode(srcNode.getUInt());
+  case msgpack::Type::Int:
+    return m_document->getNode(srcNode.getInt());
+  case msgpack::Type::Boolean:
+    return m_document->getNode(srcNode.getBool());
+  case msgpack::Type::Float:
+    return m_document->getNode(srcNode.getFloat());
+  default:
+    return m_document->getNode();
+  }
+}
+
 // =====================================================================================================================
 // Get the first user data register number for the given shader stage, taking into account what shader
 // stages are present in the pipeline, and whether NGG is enabled. The first time this is called must be
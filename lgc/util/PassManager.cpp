@@ -31,8 +31,15 @@
 #include "lgc/PassManager.h"
 #include "lgc/util/Debug.h"
 #include "llvm/Analysis/CFGPrinter.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Timer.h"
+#include <algorithm>
 
 namespace llvm {
 namespace cl {
@@ -51,6 +58,12 @@ static cl::opt<bool> DumpPassName("dump-pass-name", cl::desc("Dump executed pass
 static cl::list<unsigned> DisablePassIndices("disable-pass-indices", cl::ZeroOrMore,
                                              cl::desc("Indices of passes to be disabled"));
 
+// -pass-stats: time each pass and measure how it changes the IR size, and report the totals per pass at exit
+static cl::opt<bool> PassStats("pass-stats",
+                               cl::desc("Time each pass and measure how it changes the IR size, and report the totals "
+                                        "per pass name over all compiles at exit"),
+                               cl::init(false));
+
 } // namespace cl
 
 } // namespace llvm
@@ -69,6 +82,8 @@ public:
   ~PassManagerImpl() override {}
 
   void setPassIndex(unsigned *passIndex) override { m_passIndex = passIndex; }
+  void setPassProfiler(PassProfiler *profiler) override { m_profiler = profiler; }
+  void stopProfiling() override { m_profilingStopped = true; }
   void add(Pass *pass) override;
   void stop() override;
 
@@ -77,9 +92,72 @@ private:
   AnalysisID m_dumpCfgAfter = nullptr;        // -dump-cfg-after pass id
   AnalysisID m_printModule = nullptr;         // Pass id of dump pass "Print Module IR"
   AnalysisID m_jumpThreading = nullptr;       // Pass id of opt pass "Jump Threading"
+  AnalysisID m_startStopTimer = nullptr;      // Pass id of timer pass "Start or stop timer"
   unsigned *m_passIndex = nullptr;            // Pass Index
+  PassProfiler *m_profiler = nullptr;         // Profiler to tell about each pass, nullptr if not profiling
+  bool m_profilingStopped = false;            // Whether we have stopped profiling new passes
 };
 
+// =====================================================================================================================
+// Pass profiler that totals the statistics of each pass over all the compiles in the process, for -pass-stats. The
+// totals are reported to the info output file (as for -time-passes) when it is destroyed by llvm_shutdown.
+//
+// This is thread-safe.
+class PassStatistics final : public PassProfiler {
+public:
+  ~PassStatistics() override;
+
+  void passRun(StringRef passName, const PassRunStats &stats) override;
+
+private:
+  // Represents the totals for one pass name
+  struct PassTotals {
+    unsigned runCount = 0;        // Count of runs of the pass
+    double wallTime = 0;          // Total wall-clock time, in seconds
+    double cpuTime = 0;           // Total user plus system CPU time, in seconds
+    int64_t instCountDelta = 0;   // Total change in the count of IR instructions
+    int64_t blockCountDelta = 0;  // Total change in the count of basic blocks
+  };
+
+  sys::Mutex m_mutex;             // Mutex guarding m_totals
+  StringMap<PassTotals> m_totals; // Totals for each pass name
+};
+
+static ManagedStatic<PassStatistics> SPassStatistics;
+
+// =====================================================================================================================
+// Pass that marks the start or the end of a profiled pass. The end marker tells the profiler (and the -pass-stats
+// totals) the time taken and the change in IR size since the start marker ran.
+class PassProfileMarker final : public ModulePass {
+public:
+  static char ID;
+
+  // Constructor for a start marker
+  PassProfileMarker(PassProfiler *profiler, StringRef passName)
+      : ModulePass(ID), m_profiler(profiler), m_passName(passName) {}
+
+  // Constructor for an end marker
+  PassProfileMarker(const PassProfileMarker *startMarker)
+      : ModulePass(ID), m_profiler(startMarker->m_profiler), m_startMarker(startMarker) {}
+
+  void getAnalysisUsage(AnalysisUsage &analysisUsage) const override { analysisUsage.setPreservesAll(); }
+  StringRef getPassName() const override { return "Pass profile marker"; }
+  bool runOnModule(Module &module) override;
+
+private:
+  PassProfileMarker(const PassProfileMarker &) = delete;
+  PassProfileMarker &operator=(const PassProfileMarker &) = delete;
+
+  PassProfiler *m_profiler;                          // Profiler to tell about the pass, nullptr if none
+  std::string m_passName;                            // Name of the profiled pass (start marker only)
+  const PassProfileMarker *m_startMarker = nullptr;  // Start marker of the profiled pass (end marker only)
+  TimeRecord m_startTime;                            // Time the start marker ran (start marker only)
+  unsigned m_startInstCount = 0;                     // IR instruction count when the start marker ran
+  unsigned m_startBlockCount = 0;                    // Basic block count when the start marker ran
+};
+
+char PassProfileMarker::ID = 0;
+
 } // namespace
 
 // =====================================================================================================================
@@ -120,6 +198,7 @@ PassManagerImpl::PassManagerImpl() : PassManager() {
 
   m_jumpThreading = getPassIdFromName("jump-threading");
   m_printModule = getPassIdFromName("print-module");
+  m_startStopTimer = getPassIdFromName("lgc-start-stop-timer");
 }
 
 // =====================================================================================================================
@@ -151,9 +230,21 @@ void PassManagerImpl::add(Pass *pass) {
       LLPC_OUTS("Pass[" << passIndex << "] = " << pass->getPassName() << "\n");
   }
 
+  // If profiling, bracket the pass with markers that measure it. Immutable passes are never run, and dump and timer
+  // passes are not of interest, so they are not measured.
+  PassProfileMarker *startMarker = nullptr;
+  if ((m_profiler || cl::PassStats) && !m_profilingStopped && !pass->getAsImmutablePass() &&
+      passId != m_printModule && passId != m_startStopTimer) {
+    startMarker = new PassProfileMarker(m_profiler, pass->getPassName());
+    legacy::PassManager::add(startMarker);
+  }
+
   // Add the pass to the superclass pass manager.
   legacy::PassManager::add(pass);
 
+  if (startMarker)
+    legacy::PassManager::add(new PassProfileMarker(startMarker));
+
   if (cl::VerifyIr) {
     // Add a verify pass after it.
     legacy::PassManager::add(createVerifierPass(true)); // FatalErrors=true
@@ -170,3 +261,100 @@ void PassManagerImpl::add(Pass *pass) {
 void PassManagerImpl::stop() {
   m_stopped = true;
 }
+
+// =====================================================================================================================
+// Get the count of IR instructions and basic blocks in a module
+//
+// @param module : LLVM module
+// @param [out] instCount : Count of IR instructions
+// @param [out] blockCount : Count of basic blocks
+static void getIrSize(const Module &module, unsigned &instCount, unsigned &blockCount) {
+  instCount = 0;
+  blockCount = 0;
+  for (const Function &func : module) {
+    instCount += func.getInstructionCount();
+    blockCount += func.size();
+  }
+}
+
+// =====================================================================================================================
+// Run the pass on the specified LLVM module.
+//
+// @param [in,out] module : LLVM module to be run on
+bool PassProfileMarker::runOnModule(Module &module) {
+  if (!m_startMarker) {
+    // Measure the IR before starting the clock, so the profiled pass is not charged for it.
+    getIrSize(module, m_startInstCount, m_startBlockCount);
+    m_startTime = TimeRecord::getCurrentTime(true);
+    return false;
+  }
+
+  TimeRecord endTime = TimeRecord::getCurrentTime(false);
+  const TimeRecord &startTime = m_startMarker->m_startTime;
+  unsigned instCount = 0;
+  unsigned blockCount = 0;
+  getIrSize(module, instCount, blockCount);
+
+  PassRunStats stats = {};
+  stats.wallTime = endTime.getWallTime() - startTime.getWallTime();
+  stats.cpuTime = (endTime.getUserTime() - startTime.getUserTime()) +
+                  (endTime.getSystemTime() - startTime.getSystemTime());
+  stats.instCountDelta = static_cast<int>(instCount - m_startMarker->m_startInstCount);
+  stats.blockCountDelta = static_cast<int>(blockCount - m_startMarker->m_startBlockCount);
+
+  if (m_profiler)
+    m_profiler->passRun(m_startMarker->m_passName, stats);
+  if (cl::PassStats)
+    SPassStatistics->passRun(m_startMarker->m_passName, stats);
+  return false;
+}
+
+// =====================================================================================================================
+// Add the statistics of one run of a pass to the totals for its name.
+//
+// @param passName : Name of the pass
+// @param stats : Statistics of the run
+void PassStatistics::passRun(StringRef passName, const PassRunStats &stats) {
+  sys::ScopedLock lock(m_mutex);
+  PassTotals &totals = m_totals[passName];
+  ++totals.runCount;
+  totals.wallTime += stats.wallTime;
+  totals.cpuTime += stats.cpuTime;
+  totals.instCountDelta += stats.instCountDelta;
+  totals.blockCountDelta += stats.blockCountDelta;
+}
+
+// =====================================================================================================================
+// Report the totals for each pass, most time-consuming first.
+PassStatistics::~PassStatistics() {
+  if (m_totals.empty())
+    return;
+
+  std::vector<const StringMapEntry<PassTotals> *> entries;
+  double totalWallTime = 0;
+  for (const auto &entry : m_totals) {
+    entries.push_back(&entry);
+    totalWallTime += entry.second.wallTime;
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const StringMapEntry<PassTotals> *lhs, const StringMapEntry<PassTotals> *rhs) {
+              return lhs->second.wallTime > rhs->second.wallTime;
+            });
+
+  std::unique_ptr<raw_fd_ostream> outStream = CreateInfoOutputFile();
+  *outStream << "===" << std::string(73, '-') << "===\n"
+             << "                          LGC pass statistics\n"
+             << "===" << std::string(73, '-') << "===\n"
+             << format("  Total wall time of the measured passes: %.4f seconds\n\n", totalWallTime)
+             << "   ---Wall Time---   --CPU Time--     Runs   Inst delta  Block delta  Name\n";
+  for (const StringMapEntry<PassTotals> *entry : entries) {
+    const PassTotals &totals = entry->second;
+    double percent = totalWallTime > 0 ? totals.wallTime * 100 / totalWallTime : 0;
+    *outStream << format("  %8.4f (%5.1f%%)  %11.4f  %7u  %11lld  %11lld  ", totals.wallTime, percent,
+                         totals.cpuTime, totals.runCount, static_cast<long long>(totals.instCountDelta),
+                         static_cast<long long>(totals.blockCountDelta))
+               << entry->first() << "\n";
+  }
+  *outStream << "\n";
+  outStream->flush();
+}
@@ -31,8 +31,10 @@
 #include "llpcCompiler.h"
 #include "LLVMSPIRVLib.h"
 #include "SPIRVInternal.h"
+#include "llpcCompileProfile.h"
 #include "llpcComputeContext.h"
 #include "llpcContext.h"
+#include "llpcContextPool.h"
 #include "llpcDebug.h"
 #include "llpcElfWriter.h"
 #include "llpcFile.h"
@@ -41,6 +43,7 @@
 #include "llpcSpirvLower.h"
 #include "llpcSpirvLowerResourceCollect.h"
 #include "llpcSpirvLowerUtil.h"
+#include "llpcSpirvModuleCache.h"
 #include "llpcTimerProfiler.h"
 #include "spirvExt.h"
 #include "vkgcElfReader.h"
@@ -49,6 +52,7 @@
 #include "lgc/ElfLinker.h"
 #include "lgc/PassManager.h"
 #include "llvm/BinaryFormat/MsgPackDocument.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/Bitcode/BitcodeWriterPass.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
@@ -61,6 +65,7 @@
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/AlwaysInliner.h"
+#include <map>
 #include <mutex>
 #include <set>
 #include <unordered_set>
@@ -124,10 +129,29 @@ opt<int> RelocatableShaderElfLimit("relocatable-shader-elf-limit",
 // 0 - Disable
 // 1 - Runtime cache
 // 2 - Cache to disk
+// 5 - Map cache file read-only
 static opt<unsigned> ShaderCacheMode("shader-cache-mode",
-                                     desc("Shader cache mode, 0 - disable, 1 - runtime cache, 2 - cache to disk "),
+                                     desc("Shader cache mode, 0 - disable, 1 - runtime cache, 2 - cache to disk, "
+                                          "5 - map cache file read-only "),
                                      init(0));
 
+// -shader-cache-size-limit: limit of the shader data kept in memory by the shader cache in MB
+static opt<unsigned> ShaderCacheSizeLimit("shader-cache-size-limit",
+                                          desc("Limit of the shader data kept in memory by the shader cache in MB, "
+                                               "least recently used shaders are evicted above it (0 - no limit)"),
+                                          init(0));
+
+// -shader-cache-file-size-limit: limit of the shader data in the shader cache file in MB
+static opt<unsigned> ShaderCacheFileSizeLimit("shader-cache-file-size-limit",
+                                              desc("Limit of the shader data in the shader cache file in MB, the file "
+                                                   "is compacted when opened above it (0 - no limit)"),
+                                              init(0));
+
+// -shader-cache-compression: compress shader cache entries
+static opt<bool> ShaderCacheCompression("shader-cache-compression",
+                                        desc("Compress shader cache entries with LZ4 where that makes them smaller"),
+                                        init(false));
+
 // -executable-name: executable file name
 static opt<std::string> ExecutableName("executable-name", desc("Executable file name"), value_desc("filename"),
                                        init("amdllpc"));
@@ -161,6 +185,18 @@ opt<bool> EnablePerStageCache("enable-per-stage-cache", cl::desc("Enable shader
 opt<int> ContextReuseLimit("context-reuse-limit",
                            cl::desc("The maximum number of times a compiler context can be reused"), init(100));
 
+// -context-recycle-inst-count: The count of IR instructions materialized in a compiler context before it is recycled.
+opt<unsigned> ContextRecycleInstCount("context-recycle-inst-count",
+                                      cl::desc("The count of IR instructions materialized in a compiler context, "
+                                               "over its uses, before it is recycled (0 - no limit)"),
+                                      init(1000000));
+
+// -context-pool-stats: Print statistics of the compiler context pool when the last compiler is destroyed.
+opt<bool> ContextPoolStats("context-pool-stats",
+                           cl::desc("Print statistics of the compiler context pool when the last compiler is "
+                                    "destroyed"),
+                           init(false));
+
 extern opt<bool> EnableOuts;
 
 extern opt<bool> EnableErrs;
@@ -169,6 +205,8 @@ extern opt<std::string> LogFileDbgs;
 
 extern opt<std::string> LogFileOuts;
 
+extern opt<bool> EnableTimerProfile;
+
 } // namespace cl
 
 } // namespace llvm
@@ -178,10 +216,34 @@ static cl::opt<bool> UseBuilderRecorder("use-builder-recorder",
                                         cl::desc("Do lowering via recording and replaying LLPC builder"),
                                         cl::init(true));
 
+// -parallel-stage-lowering: translate and lower the shader stages of a pipeline concurrently
+static cl::opt<bool> ParallelStageLowering("parallel-stage-lowering",
+                                           cl::desc("Translate and lower the shader stages of a pipeline concurrently"),
+                                           cl::init(false));
+
+// -compile-thread-count: count of threads in the compiler's thread pool
+static cl::opt<unsigned> CompileThreadCount("compile-thread-count",
+                                            cl::desc("Count of threads in the compiler's thread pool, at least 2 "
+                                                     "(0 - one per hardware thread)"),
+                                            cl::init(0));
+
+// -spirv-module-cache-size: count of parsed SPIR-V modules kept for reuse by pipeline builds
+static cl::opt<unsigned> SpirvModuleCacheSize("spirv-module-cache-size",
+                                              cl::desc("Count of parsed SPIR-V modules kept for reuse by pipeline "
+                                                       "builds (0 - disable)"),
+                                              cl::init(256));
+
+// -tiered-compile: build pipelines missing from the cache quickly, and optimize them fully in the background
+static cl::opt<bool> TieredCompile("tiered-compile",
+                                   cl::desc("Build pipelines missing from the shader cache at the fast optimization "
+                                            "tier, then replace them in the cache with fully optimized pipelines "
+                                            "built in the background"),
+                                   cl::init(false));
+
 namespace Llpc {
 
-sys::Mutex Compiler::m_contextPoolMutex;
-std::vector<Context *> *Compiler::m_contextPool = nullptr;
+ContextPool *Compiler::m_contextPool = nullptr;
+ThreadPool *Compiler::m_threadPool = nullptr;
 
 // Enumerates modes used in shader replacement
 enum ShaderReplaceMode {
@@ -327,12 +389,12 @@ Compiler::Compiler(GfxIpVersion gfxIp, unsigned optionCount, const char *const *
     // LLVM fatal error handler only can be installed once.
     install_fatal_error_handler(fatalErrorHandler);
 
-    // Initiailze m_pContextPool.
-    {
-      std::lock_guard<sys::Mutex> lock(m_contextPoolMutex);
+    m_contextPool = new ContextPool;
 
-      m_contextPool = new std::vector<Context *>();
-    }
+    m_threadPool = new ThreadPool(CompileThreadCount);
+
+    if (SpirvModuleCacheSize > 0)
+      SpirvModuleCache::initialize(SpirvModuleCacheSize);
   }
 
   // Initialize shader cache
@@ -344,6 +406,9 @@ Compiler::Compiler(GfxIpVersion gfxIp, unsigned optionCount, const char *const *
   auxCreateInfo.hash = m_optionHash;
   auxCreateInfo.executableName = cl::ExecutableName.c_str();
   auxCreateInfo.cacheFilePath = cl::ShaderCacheFileDir.c_str();
+  auxCreateInfo.runtimeSizeLimit = static_cast<size_t>(cl::ShaderCacheSizeLimit) * 1024 * 1024;
+  auxCreateInfo.fileSizeLimit = static_cast<size_t>(cl::ShaderCacheFileSizeLimit) * 1024 * 1024;
+  auxCreateInfo.codec = cl::ShaderCacheCompression ? CompressionCodec::Lz4 : CompressionCodec::None;
   if (cl::ShaderCacheFileDir.empty()) {
 #ifdef WIN_OS
     auxCreateInfo.cacheFilePath = getenv("LOCALAPPDATA");
@@ -358,32 +423,49 @@ Compiler::Compiler(GfxIpVersion gfxIp, unsigned optionCount, const char *const *
   ++m_outRedirectCount;
 }
 
+// =====================================================================================================================
+// Prints the statistics of the context pool.
+//
+// @param stats : Statistics of the context pool
+static void printContextPoolStats(const ContextPoolStats &stats) {
+  std::unique_ptr<raw_fd_ostream> outStream = CreateInfoOutputFile();
+  *outStream << "===" << std::string(73, '-') << "===\n"
+             << "                        LLPC context pool statistics\n"
+             << "===" << std::string(73, '-') << "===\n"
+             << format("  %10llu contexts acquired\n", static_cast<unsigned long long>(stats.acquired))
+             << format("  %10llu contexts created\n", static_cast<unsigned long long>(stats.created))
+             << format("  %10llu contexts recycled for their use count\n",
+                       static_cast<unsigned long long>(stats.recycledByUses))
+             << format("  %10llu contexts recycled for their materialized IR\n",
+                       static_cast<unsigned long long>(stats.recycledBySize))
+             << format("  %10llu contexts free in the pool\n", static_cast<unsigned long long>(stats.freeContexts))
+             << format("  %10llu contexts in use\n\n", static_cast<unsigned long long>(stats.contextsInUse));
+  outStream->flush();
+}
+
 // =====================================================================================================================
 Compiler::~Compiler() {
+  // Wait for the asynchronous builds that have not completed yet.
+  {
+    std::unique_lock<std::mutex> lock(m_asyncBuildLock);
+    m_asyncBuildsDone.wait(lock, [this] { return m_asyncBuildCount == 0; });
+  }
+
   bool shutdown = false;
   {
     // Free context pool
-    std::lock_guard<sys::Mutex> lock(m_contextPoolMutex);
-
     // Keep the max allowed count of contexts that reside in the pool so that we can speed up the creatoin of
     // compiler next time.
-    for (auto it = m_contextPool->begin(); it != m_contextPool->end();) {
-      auto context = *it;
-      size_t maxResidentContexts = 0;
+    size_t maxResidentContexts = 0;
 
-      // This is just a W/A for Teamcity. Setting AMD_RESIDENT_CONTEXTS could reduce more than 40 minutes of
-      // CTS running time.
-      char *maxResidentContextsEnv = getenv("AMD_RESIDENT_CONTEXTS");
+    // This is just a W/A for Teamcity. Setting AMD_RESIDENT_CONTEXTS could reduce more than 40 minutes of
+    // CTS running time.
+    char *maxResidentContextsEnv = getenv("AMD_RESIDENT_CONTEXTS");
 
-      if (maxResidentContextsEnv)
-        maxResidentContexts = strtoul(maxResidentContextsEnv, nullptr, 0);
+    if (maxResidentContextsEnv)
+      maxResidentContexts = strtoul(maxResidentContextsEnv, nullptr, 0);
 
-      if (!context->isInUse() && m_contextPool->size() > maxResidentContexts) {
-        it = m_contextPool->erase(it);
-        delete context;
-      } else
-        ++it;
-    }
+    m_contextPool->trim(maxResidentContexts);
   }
 
   // Restore default output
@@ -406,9 +488,14 @@ Compiler::~Compiler() {
 
   if (shutdown) {
     ShaderCacheManager::shutdown();
+    SpirvModuleCache::shutdown();
     remove_fatal_error_handler();
+    if (cl::ContextPoolStats)
+      printContextPoolStats(m_contextPool->getStats());
     delete m_contextPool;
     m_contextPool = nullptr;
+    delete m_threadPool;
+    m_threadPool = nullptr;
   }
 }
 
@@ -424,9 +511,12 @@ void Compiler::Destroy() {
 // @param shaderInfo : Info to build this shader module
 // @param [out] shaderOut : Output of building this shader module
 Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, ShaderModuleBuildOut *shaderOut) const {
+  // Keep data retrieved from the internal shader cache valid until it has been copied to the output.
+  ShaderCacheUse cacheUse(m_shaderCache.get());
   Result result = Result::Success;
   void *allocBuf = nullptr;
   const void *cacheData = nullptr;
+  ElfPackage cacheBuffer;
   size_t allocSize = 0;
   ShaderModuleDataEx moduleDataEx = {};
   // For trimming debug info
@@ -450,8 +540,9 @@ Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, Shad
 
   memcpy(moduleDataEx.common.hash, &hash, sizeof(hash));
 
+  std::unique_ptr<CompileProfile> compileProfile = CompileProfile::create("shader-module", MetroHash::compact64(&hash));
   TimerProfiler timerProfiler(MetroHash::compact64(&hash), "LLPC ShaderModule",
-                              TimerProfiler::ShaderModuleTimerEnableMask);
+                              TimerProfiler::ShaderModuleTimerEnableMask, compileProfile.get());
 
   // Check the type of input shader binary
   if (ShaderModuleHelper::isSpirvBinary(&shaderInfo->shaderBin)) {
@@ -507,7 +598,12 @@ Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, Shad
       // times in async-compile mode.
       cacheEntryState = m_shaderCache->findShader(cacheHash, true, &hEntry);
       if (cacheEntryState == ShaderEntryState::Ready)
-        result = m_shaderCache->retrieveShader(hEntry, &cacheData, &allocSize);
+        result = m_shaderCache->retrieveShader(hEntry, &cacheData, &allocSize, &cacheBuffer);
+      if (compileProfile) {
+        compileProfile->setCacheResult(MetroHash::compact64(&cacheHash),
+                                       cacheEntryState == ShaderEntryState::Ready ? CompileProfileCacheResult::Hit
+                                                                                  : CompileProfileCacheResult::Miss);
+      }
       if (cacheEntryState != ShaderEntryState::Ready) {
         Context *context = acquireContext();
 
@@ -536,6 +632,7 @@ Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, Shad
           unsigned passIndex = 0;
           std::unique_ptr<lgc::PassManager> lowerPassMgr(lgc::PassManager::Create());
           lowerPassMgr->setPassIndex(&passIndex);
+          lowerPassMgr->setPassProfiler(compileProfile.get());
 
           // Set the shader stage in the Builder.
           context->getBuilder()->setShaderStage(getLgcShaderStage(static_cast<ShaderStage>(entryNames[i].stage)));
@@ -581,6 +678,8 @@ Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, Shad
           }
 
           moduleEntry.entrySize = moduleBinary.size() - moduleEntry.entryOffset;
+          if (compileProfile)
+            compileProfile->addIrInstCount("lower", *module);
 
           moduleEntry.passIndex = passIndex;
           if (resCollectPass->detailUsageValid()) {
@@ -612,6 +711,7 @@ Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, Shad
         }
 
         context->setDiagnosticHandlerCallBack(nullptr);
+        releaseContext(context);
       }
       moduleDataEx.extra.entryCount = entryNames.size();
     }
@@ -714,11 +814,21 @@ Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, Shad
     moduleDataExCopy->common.binCode.pCode = code;
     moduleDataExCopy->extra.pFsOutInfos = fsOutInfo;
     shaderOut->pModuleData = &moduleDataExCopy->common;
+
+    // Parse the SPIR-V once here, so that the pipelines built from this shader module only translate it.
+    if (moduleDataExCopy->common.binType == BinaryType::Spirv && SpirvModuleCache::getSpirvModuleCache()) {
+      MetroHash::Hash cacheHash = {};
+      memcpy(cacheHash.dwords, moduleDataExCopy->common.cacheHash, sizeof(cacheHash));
+      SpirvModuleCache::getSpirvModuleCache()->addModule(cacheHash, moduleDataExCopy->common.binCode);
+    }
   } else {
     if (hEntry)
       m_shaderCache->resetShader(hEntry);
   }
 
+  if (compileProfile)
+    compileProfile->setResult(result);
+
   return result;
 }
 
@@ -739,19 +849,55 @@ Result Compiler::buildPipelineWithRelocatableElf(Context *context, ArrayRef<cons
   unsigned originalShaderStageMask = context->getPipelineContext()->getShaderStageMask();
   context->getPipelineContext()->setUnlinked(true);
 
-  ElfPackage elf[ShaderStageNativeStageCount];
-  for (unsigned stage = 0; stage < shaderInfo.size() && result == Result::Success; ++stage) {
+  // Work out which stages are built together into each relocatable elf. Each group is identified by its first stage,
+  // and its elf is stored at that stage's index. When tessellation or geometry is present, the vertex-processing
+  // stages are built together into one half-pipeline elf, because the hardware merges them into the LS-HS and ES-GS
+  // stages, and the ring and LDS sizes shared between them are then all known within the half. So the vertex shader
+  // of such a pipeline is not reused across pipelines that differ in their other vertex-processing stages; that would
+  // need the merged stages to be generated at link time. The fragment shader is always built on its own, so it can be
+  // reused across the pipelines that share it.
+  const unsigned preRasterStageMask =
+      shaderStageToMask(ShaderStageVertex) | shaderStageToMask(ShaderStageTessControl) |
+      shaderStageToMask(ShaderStageTessEval) | shaderStageToMask(ShaderStageGeometry);
+  const bool mergePreRasterStages =
+      context->isGraphics() && (originalShaderStageMask & preRasterStageMask & ~shaderStageToMask(ShaderStageVertex));
+  unsigned groupStageMask[ShaderStageNativeStageCount] = {};
+  for (unsigned stage = 0; stage < shaderInfo.size(); ++stage) {
     if (!shaderInfo[stage] || !shaderInfo[stage]->pModuleData)
       continue;
+    unsigned stageMask = shaderStageToMask(static_cast<ShaderStage>(stage));
+    if (mergePreRasterStages && (stageMask & preRasterStageMask))
+      groupStageMask[ShaderStageVertex] |= stageMask;
+    else
+      groupStageMask[stage] |= stageMask;
+  }
 
-    context->getPipelineContext()->setShaderStageMask(shaderStageToMask(static_cast<ShaderStage>(stage)));
+  // Check the caches for the relocatable elf of each group first, and note the groups that missed.
+  ElfPackage elf[ShaderStageNativeStageCount];
+  BinaryData elfBin[ShaderStageNativeStageCount] = {};
+  ShaderCache *shaderCache[ShaderStageNativeStageCount] = {};
+  CacheEntryHandle hEntry[ShaderStageNativeStageCount] = {};
+  unsigned missStageMask = 0;
+  for (unsigned stage = 0; stage < shaderInfo.size(); ++stage) {
+    if (groupStageMask[stage] == 0)
+      continue;
 
-    // Check the cache for the relocatable shader for this stage.
     MetroHash::Hash cacheHash = {};
     IShaderCache *userShaderCache = nullptr;
     if (context->isGraphics()) {
       auto pipelineInfo = reinterpret_cast<const GraphicsPipelineBuildInfo *>(context->getPipelineBuildInfo());
-      cacheHash = PipelineDumper::generateHashForGraphicsPipeline(pipelineInfo, true, true, stage);
+      if (isPowerOf2_32(groupStageMask[stage]))
+        cacheHash = PipelineDumper::generateHashForGraphicsPipeline(pipelineInfo, true, true, stage);
+      else {
+        // The hash of a group combines the hashes of its stages, each of which includes the non-fragment state.
+        MetroHash64 hasher;
+        for (unsigned groupMask = groupStageMask[stage]; groupMask != 0; groupMask &= groupMask - 1) {
+          MetroHash::Hash stageHash =
+              PipelineDumper::generateHashForGraphicsPipeline(pipelineInfo, true, true, countTrailingZeros(groupMask));
+          hasher.Update(stageHash);
+        }
+        hasher.Finalize(cacheHash.bytes);
+      }
 #if LLPC_CLIENT_INTERFACE_MAJOR_VERSION < 38
       userShaderCache = pipelineInfo->pShaderCache;
 #endif
@@ -763,39 +909,89 @@ Result Compiler::buildPipelineWithRelocatableElf(Context *context, ArrayRef<cons
 #endif
     }
 
-    ShaderEntryState cacheEntryState = ShaderEntryState::New;
-    BinaryData elfBin = {};
-
-    ShaderCache *shaderCache;
-    CacheEntryHandle hEntry;
-    cacheEntryState = lookUpShaderCaches(userShaderCache, &cacheHash, &elfBin, &shaderCache, &hEntry);
-
+    ShaderEntryState cacheEntryState = lookUpShaderCaches(userShaderCache, &cacheHash, &elfBin[stage], &elf[stage],
+                                                          &shaderCache[stage], &hEntry[stage]);
     if (cacheEntryState == ShaderEntryState::Ready) {
-      auto data = reinterpret_cast<const char *>(elfBin.pCode);
-      elf[stage].assign(data, data + elfBin.codeSize);
+      // A compressed shader has already been decompressed into elf[stage].
+      auto data = reinterpret_cast<const char *>(elfBin[stage].pCode);
+      if (data != elf[stage].data())
+        elf[stage].assign(data, data + elfBin[stage].codeSize);
       continue;
     }
+    missStageMask |= shaderStageToMask(static_cast<ShaderStage>(stage));
+  }
 
-    // There was a cache miss, so we need to build the relocatable shader for
-    // this stage.
-    const PipelineShaderInfo *singleStageShaderInfo[ShaderStageNativeStageCount] = {nullptr, nullptr, nullptr,
-                                                                                    nullptr, nullptr, nullptr};
-    singleStageShaderInfo[stage] = shaderInfo[stage];
-
-    result =
-        buildPipelineInternal(context, singleStageShaderInfo, forceLoopUnrollCount, /*unlinked=*/true, &elf[stage]);
+  // Build the relocatable elfs of the groups that missed. The groups are independent until they are linked, so
+  // the first is built on this thread in the given context, while each of the others is built as a task on the thread
+  // pool with its own pipeline context and LLPC context. That is not done when dumping IR, timing passes or profiling
+  // the build, as those are not set up to be used from multiple threads.
+  Result stageResults[ShaderStageNativeStageCount];
+  std::fill(std::begin(stageResults), std::end(stageResults), Result::Success);
+  auto buildStage = [&](unsigned stage, Context *stageContext) {
+    const PipelineShaderInfo *groupShaderInfo[ShaderStageNativeStageCount] = {nullptr, nullptr, nullptr,
+                                                                              nullptr, nullptr, nullptr};
+    for (unsigned groupMask = groupStageMask[stage]; groupMask != 0; groupMask &= groupMask - 1)
+      groupShaderInfo[countTrailingZeros(groupMask)] = shaderInfo[countTrailingZeros(groupMask)];
+    stageContext->getPipelineContext()->setShaderStageMask(groupStageMask[stage]);
+    stageResults[stage] = buildPipelineInternal(stageContext, groupShaderInfo, forceLoopUnrollCount,
+                                                /*unlinked=*/true, &elf[stage]);
+  };
+  auto buildStageInOwnContext = [&](unsigned stage) {
+    // Only a graphics pipeline has more than one group. It shares the user data already merged above.
+    auto pipelineInfo = reinterpret_cast<const GraphicsPipelineBuildInfo *>(context->getPipelineBuildInfo());
+    MetroHash::Hash pipelineHash = context->getPipelineContext()->getPipelineHash();
+    MetroHash::Hash cacheHash = context->getPipelineContext()->getCacheHash();
+    GraphicsContext graphicsContext(m_gfxIp, pipelineInfo, &pipelineHash, &cacheHash);
+    graphicsContext.setUnlinked(true);
+    Context *stageContext = acquireContext();
+    stageContext->attachPipelineContext(&graphicsContext);
+    buildStage(stage, stageContext);
+    releaseContext(stageContext);
+  };
 
-    // Add the result to the cache.
-    if (result == Result::Success) {
-      elfBin.codeSize = elf[stage].size();
-      elfBin.pCode = elf[stage].data();
+  if (missStageMask != 0) {
+    unsigned firstStage = countTrailingZeros(missStageMask);
+    unsigned otherStageMask = missStageMask & ~shaderStageToMask(static_cast<ShaderStage>(firstStage));
+    bool buildConcurrently = !EnableOuts() && !TimePassesIsEnabled && !cl::EnableTimerProfile &&
+                             !context->getPipelineContext()->getCompileProfile();
+    TaskGroup stageTasks(m_threadPool);
+    if (buildConcurrently) {
+      for (unsigned stageMask = otherStageMask; stageMask != 0; stageMask &= stageMask - 1) {
+        unsigned stage = countTrailingZeros(stageMask);
+        stageTasks.async([&buildStageInOwnContext, stage] { buildStageInOwnContext(stage); });
+      }
+    }
+    buildStage(firstStage, context);
+    stageTasks.wait();
+    if (!buildConcurrently) {
+      for (unsigned stageMask = otherStageMask; stageMask != 0; stageMask &= stageMask - 1)
+        buildStage(countTrailingZeros(stageMask), context);
     }
-    updateShaderCache((result == Result::Success), &elfBin, shaderCache, hEntry);
   }
   context->getPipelineContext()->setShaderStageMask(originalShaderStageMask);
 
-  // Link the relocatable shaders into a single pipeline elf file.
-  linkRelocatableShaderElf(elf, pipelineElf, context);
+  // Add the results to the cache, in stage order.
+  for (unsigned stage = 0; stage < shaderInfo.size(); ++stage) {
+    if (!(missStageMask & shaderStageToMask(static_cast<ShaderStage>(stage))))
+      continue;
+    if (stageResults[stage] == Result::Success) {
+      elfBin[stage].codeSize = elf[stage].size();
+      elfBin[stage].pCode = elf[stage].data();
+    } else if (result == Result::Success)
+      result = stageResults[stage];
+    updateShaderCache((stageResults[stage] == Result::Success), &elfBin[stage], shaderCache[stage], hEntry[stage]);
+  }
+
+  // Link the relocatable shaders into a single pipeline elf file. If that cannot be done for this pipeline state,
+  // fall back to a whole-pipeline compile.
+  if (result == Result::Success) {
+    result = linkRelocatableShaderElf(elf, pipelineElf, context);
+    if (result == Result::ErrorUnavailable) {
+      context->getPipelineContext()->setUnlinked(false);
+      result = buildPipelineInternal(context, shaderInfo, forceLoopUnrollCount, /*unlinked=*/false, pipelineElf,
+                                     nullptr);
+    }
+  }
 
   return result;
 }
@@ -828,16 +1024,14 @@ bool Compiler::canUseRelocatableGraphicsShaderElf(const ArrayRef<const PipelineS
 
   bool useRelocatableShaderElf = true;
   for (unsigned stage = 0; stage < shaderInfo.size(); ++stage) {
-    if (stage != ShaderStageVertex && stage != ShaderStageFragment) {
-      if (shaderInfo[stage] && shaderInfo[stage]->pModuleData)
-        useRelocatableShaderElf = false;
-    } else if (!shaderInfo[stage] || !shaderInfo[stage]->pModuleData) {
+    if (!shaderInfo[stage] || !shaderInfo[stage]->pModuleData) {
       // TODO: Generate pass-through shaders when the fragment or vertex shaders are missing.
-      useRelocatableShaderElf = false;
-    } else {
+      if (stage == ShaderStageVertex || stage == ShaderStageFragment)
+        useRelocatableShaderElf = false;
+    } else if (hasUnrelocatableDescriptorNode(shaderInfo[stage]->pUserDataNodes,
+                                              shaderInfo[stage]->userDataNodeCount)) {
       // Check UserDataNode for unsupported Descriptor types.
-      useRelocatableShaderElf =
-          !hasUnrelocatableDescriptorNode(shaderInfo[stage]->pUserDataNodes, shaderInfo[stage]->userDataNodeCount);
+      useRelocatableShaderElf = false;
     }
   }
 
@@ -887,6 +1081,57 @@ bool Compiler::canUseRelocatableComputeShaderElf(const PipelineShaderInfo *shade
   return useRelocatableShaderElf;
 }
 
+// =====================================================================================================================
+// Translate and lower one SPIR-V shader stage of a pipeline in a context of its own, and write the result as bitcode.
+// Building without a pipeline makes BuilderRecorder record the shader modes in the module, from where irLink picks
+// them up, as for a shader module that was built to LLVM bitcode ahead of time.
+//
+// @param pipelineContext : Pipeline context of the pipeline being built
+// @param shaderInfo : Shader info of the stage
+// @param shaderIndex : Index of the stage in the pipeline's shader info
+// @param forceLoopUnrollCount : Force loop unroll count (0 means disable)
+// @param [out] bitcode : Bitcode of the lowered shader module
+// @param [out] passCount : Number of passes run
+Result Compiler::lowerShaderStageToBitcode(PipelineContext *pipelineContext, const PipelineShaderInfo *shaderInfo,
+                                           unsigned shaderIndex, unsigned forceLoopUnrollCount, ElfPackage *bitcode,
+                                           unsigned *passCount) const {
+  Result result = Result::Success;
+  ShaderStage entryStage = shaderInfo->entryStage;
+
+  Context *context = acquireContext();
+  context->attachPipelineContext(pipelineContext);
+  context->setDiagnosticHandler(std::make_unique<LlpcDiagnosticHandler>());
+  context->setScalarBlockLayout(pipelineContext->getPipelineOptions()->scalarBlockLayout);
+  context->setRobustBufferAccess(pipelineContext->getPipelineOptions()->robustBufferAccess);
+  context->setBuilder(context->getLgcContext()->createBuilder(nullptr, true));
+  context->getBuilder()->setShaderStage(getLgcShaderStage(entryStage));
+
+  Module *module = new Module((Twine("llpc") + getShaderStageName(entryStage)).str() +
+                                  std::to_string(getModuleIdByIndex(shaderIndex)),
+                              *context);
+  context->setModuleTargetMachine(module);
+
+  unsigned passIndex = 0;
+  std::unique_ptr<lgc::PassManager> lowerPassMgr(lgc::PassManager::Create());
+  lowerPassMgr->setPassIndex(&passIndex);
+  lowerPassMgr->add(createSpirvLowerTranslator(entryStage, shaderInfo));
+  SpirvLower::addPasses(context, entryStage, *lowerPassMgr, nullptr, forceLoopUnrollCount);
+  raw_svector_ostream bitcodeStream(*bitcode);
+  lowerPassMgr->add(createBitcodeWriterPass(bitcodeStream));
+
+  if (!runPasses(&*lowerPassMgr, module)) {
+    LLPC_ERRS("Failed to translate SPIR-V or run per-shader passes\n");
+    result = Result::ErrorInvalidShader;
+  }
+  *passCount = passIndex;
+
+  context->addMaterializedInstCount(module->getInstructionCount());
+  delete module;
+  context->setDiagnosticHandlerCallBack(nullptr);
+  releaseContext(context);
+  return result;
+}
+
 // =====================================================================================================================
 // Build pipeline internally -- common code for graphics and compute
 //
@@ -895,12 +1140,16 @@ bool Compiler::canUseRelocatableComputeShaderElf(const PipelineShaderInfo *shade
 // @param forceLoopUnrollCount : Force loop unroll count (0 means disable)
 // @param unlinked : Do not provide some state to LGC, so offsets are generated as relocs
 // @param [out] pipelineElf : Output Elf package
+// @param [out] linkedModule : If not nullptr, receives the linked pipeline module (empty if it was not linked here)
 Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const PipelineShaderInfo *> shaderInfo,
-                                       unsigned forceLoopUnrollCount, bool unlinked, ElfPackage *pipelineElf) {
+                                       unsigned forceLoopUnrollCount, bool unlinked, ElfPackage *pipelineElf,
+                                       LinkedPipelineModule *linkedModule) {
   Result result = Result::Success;
   unsigned passIndex = 0;
   const PipelineShaderInfo *fragmentShaderInfo = nullptr;
-  TimerProfiler timerProfiler(context->getPiplineHashCode(), "LLPC", TimerProfiler::PipelineTimerEnableMask);
+  CompileProfile *compileProfile = context->getPipelineContext()->getCompileProfile();
+  TimerProfiler timerProfiler(context->getPiplineHashCode(), "LLPC", TimerProfiler::PipelineTimerEnableMask,
+                              compileProfile);
   bool buildingRelocatableElf = context->getPipelineContext()->isUnlinked();
 
   context->setDiagnosticHandler(std::make_unique<LlpcDiagnosticHandler>());
@@ -935,6 +1184,54 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
   // If not IR input, run the per-shader passes, including SPIR-V translation, and then link the modules
   // into a single pipeline module.
   if (pipelineModule == nullptr) {
+    // If enabled, translate and lower the SPIR-V stages concurrently, each in a context of its own. That needs
+    // the shader modes to be recorded in each module, so it is only done when all stages are SPIR-V and
+    // BuilderRecorder is in use. It is also not done when dumping IR or timing passes, as those are not set up to be
+    // used from multiple threads.
+    std::vector<ElfPackage> stageBitcodes(shaderInfo.size());
+    unsigned parallelStageMask = 0;
+    if (ParallelStageLowering && UseBuilderRecorder && !EnableOuts() && !timerProfiler.getTimer(TimerTranslate)) {
+      for (unsigned shaderIndex = 0; shaderIndex < shaderInfo.size(); ++shaderIndex) {
+        const PipelineShaderInfo *shaderInfoEntry = shaderInfo[shaderIndex];
+        if (!shaderInfoEntry || !shaderInfoEntry->pModuleData)
+          continue;
+        const ShaderModuleData *moduleData = reinterpret_cast<const ShaderModuleData *>(shaderInfoEntry->pModuleData);
+        if (moduleData->binType != BinaryType::Spirv) {
+          parallelStageMask = 0;
+          break;
+        }
+        parallelStageMask |= 1 << shaderIndex;
+      }
+      if (countPopulation(parallelStageMask) < 2)
+        parallelStageMask = 0;
+    }
+
+    if (parallelStageMask != 0) {
+      std::vector<Result> stageResults(shaderInfo.size(), Result::Success);
+      std::vector<unsigned> stagePassCounts(shaderInfo.size(), 0);
+      auto lowerStage = [&](unsigned shaderIndex) {
+        stageResults[shaderIndex] =
+            lowerShaderStageToBitcode(context->getPipelineContext(), shaderInfo[shaderIndex], shaderIndex,
+                                      forceLoopUnrollCount, &stageBitcodes[shaderIndex], &stagePassCounts[shaderIndex]);
+      };
+
+      // The first stage is done on this thread while the others are done as tasks on the thread pool.
+      TaskGroup stageTasks(m_threadPool);
+      unsigned firstShaderIndex = countTrailingZeros(parallelStageMask);
+      for (unsigned shaderIndex = firstShaderIndex + 1; shaderIndex < shaderInfo.size(); ++shaderIndex) {
+        if (parallelStageMask & (1 << shaderIndex))
+          stageTasks.async([&lowerStage, shaderIndex] { lowerStage(shaderIndex); });
+      }
+      lowerStage(firstShaderIndex);
+      stageTasks.wait();
+
+      for (unsigned shaderIndex = 0; shaderIndex < shaderInfo.size(); ++shaderIndex) {
+        passIndex += stagePassCounts[shaderIndex];
+        if (stageResults[shaderIndex] != Result::Success)
+          result = stageResults[shaderIndex];
+      }
+    }
+
     // Create empty modules and set target machine in each.
     std::vector<Module *> modules(shaderInfo.size());
     unsigned stageSkipMask = 0;
@@ -947,7 +1244,16 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
           reinterpret_cast<const ShaderModuleDataEx *>(shaderInfoEntry->pModuleData);
 
       Module *module = nullptr;
-      if (moduleDataEx->common.binType == BinaryType::MultiLlvmBc) {
+      if (parallelStageMask & (1 << shaderIndex)) {
+        // Already translated and lowered; load the result in this context.
+        BinaryData binCode = {};
+        binCode.codeSize = stageBitcodes[shaderIndex].size();
+        binCode.pCode = stageBitcodes[shaderIndex].data();
+        module = context->loadLibary(&binCode).release();
+        stageSkipMask |= (1 << shaderIndex);
+        if (!module)
+          result = Result::ErrorInvalidShader;
+      } else if (moduleDataEx->common.binType == BinaryType::MultiLlvmBc) {
         timerProfiler.startStopTimer(TimerLoadBc, true);
 
         MetroHash::Hash entryNameHash = {};
@@ -997,6 +1303,7 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
 
       std::unique_ptr<lgc::PassManager> lowerPassMgr(lgc::PassManager::Create());
       lowerPassMgr->setPassIndex(&passIndex);
+      lowerPassMgr->setPassProfiler(compileProfile);
 
       // Set the shader stage in the Builder.
       context->getBuilder()->setShaderStage(getLgcShaderStage(entryStage));
@@ -1020,29 +1327,36 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
       if (!success) {
         LLPC_ERRS("Failed to translate SPIR-V or run per-shader passes\n");
         result = Result::ErrorInvalidShader;
-      }
+      } else if (compileProfile)
+        compileProfile->addIrInstCount("translate", *modules[shaderIndex]);
     }
     SmallVector<std::pair<Module *, lgc::ShaderStage>, 5> modulesToLink;
     for (unsigned shaderIndex = 0; shaderIndex < shaderInfo.size() && result == Result::Success; ++shaderIndex) {
       // Per-shader SPIR-V lowering passes.
       const PipelineShaderInfo *shaderInfoEntry = shaderInfo[shaderIndex];
       ShaderStage entryStage = shaderInfoEntry ? shaderInfoEntry->entryStage : ShaderStageInvalid;
-      if (!shaderInfoEntry || !shaderInfoEntry->pModuleData || (stageSkipMask & shaderStageToMask(entryStage)))
+      if (!shaderInfoEntry || !shaderInfoEntry->pModuleData)
         continue;
 
-      context->getBuilder()->setShaderStage(getLgcShaderStage(entryStage));
-      std::unique_ptr<lgc::PassManager> lowerPassMgr(lgc::PassManager::Create());
-      lowerPassMgr->setPassIndex(&passIndex);
-
-      SpirvLower::addPasses(context, entryStage, *lowerPassMgr, timerProfiler.getTimer(TimerLower),
-                            forceLoopUnrollCount
-                            );
-      // Run the passes.
-      bool success = runPasses(&*lowerPassMgr, modules[shaderIndex]);
-      if (!success) {
-        LLPC_ERRS("Failed to translate SPIR-V or run per-shader passes\n");
-        result = Result::ErrorInvalidShader;
+      // Modules loaded as already lowered bitcode skip the lowering passes, but still get linked.
+      if (!(stageSkipMask & shaderStageToMask(entryStage))) {
+        context->getBuilder()->setShaderStage(getLgcShaderStage(entryStage));
+        std::unique_ptr<lgc::PassManager> lowerPassMgr(lgc::PassManager::Create());
+        lowerPassMgr->setPassIndex(&passIndex);
+        lowerPassMgr->setPassProfiler(compileProfile);
+
+        SpirvLower::addPasses(context, entryStage, *lowerPassMgr, timerProfiler.getTimer(TimerLower),
+                              forceLoopUnrollCount
+                              );
+        // Run the passes.
+        bool success = runPasses(&*lowerPassMgr, modules[shaderIndex]);
+        if (!success) {
+          LLPC_ERRS("Failed to translate SPIR-V or run per-shader passes\n");
+          result = Result::ErrorInvalidShader;
+        }
       }
+      if (compileProfile && result == Result::Success)
+        compileProfile->addIrInstCount("lower", *modules[shaderIndex]);
       modulesToLink.push_back({modules[shaderIndex], getLgcShaderStage(static_cast<ShaderStage>(shaderIndex))});
     }
 
@@ -1051,9 +1365,23 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
     if (pipelineModule == nullptr) {
       LLPC_ERRS("Failed to link shader modules into pipeline module\n");
       result = Result::ErrorInvalidShader;
+    } else if (linkedModule) {
+      // Keep the linked module, with the pipeline state that BuilderRecorder has recorded in it, so that the
+      // pipeline can be generated again at another optimization tier.
+      raw_svector_ostream bitcodeStream(linkedModule->bitcode);
+      WriteBitcodeToFile(*pipelineModule, bitcodeStream);
+      linkedModule->stageMask = 0;
+      for (const auto &moduleAndStage : modulesToLink)
+        linkedModule->stageMask |= 1 << moduleAndStage.second;
+      linkedModule->options = pipeline->getOptions();
     }
   }
 
+  if (pipelineModule)
+    context->addMaterializedInstCount(pipelineModule->getInstructionCount());
+  if (compileProfile && pipelineModule)
+    compileProfile->addIrInstCount("link", *pipelineModule);
+
   // Set up function to check shader cache.
   GraphicsShaderCacheChecker graphicsShaderCacheChecker(this, context);
 
@@ -1088,6 +1416,7 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
           timerProfiler.getTimer(TimerCodeGen),
       };
 
+      builderContext->setPassProfiler(compileProfile);
       pipeline->generate(std::move(pipelineModule), elfStream, checkShaderCacheFunc, timers, {});
       result = Result::Success;
     }
@@ -1106,6 +1435,7 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
       (context->getShaderStageMask() & shaderStageToMask(ShaderStageFragment)))
     graphicsShaderCacheChecker.updateRootUserDateOffset(pipelineElf);
 
+  builderContext->setPassProfiler(nullptr);
   context->setDiagnosticHandlerCallBack(nullptr);
 
   return result;
@@ -1133,12 +1463,14 @@ unsigned GraphicsShaderCacheChecker::check(const Module *module, unsigned stageM
 #endif
   if (stageMask & shaderStageToMask(ShaderStageFragment)) {
     m_fragmentCacheEntryState = m_compiler->lookUpShaderCaches(appCache, &fragmentHash, &m_fragmentElf,
-                                                               &m_fragmentShaderCache, &m_hFragmentEntry);
+                                                               &m_fragmentElfBuffer, &m_fragmentShaderCache,
+                                                               &m_hFragmentEntry);
   }
 
   if (stageMask & ~shaderStageToMask(ShaderStageFragment)) {
     m_nonFragmentCacheEntryState = m_compiler->lookUpShaderCaches(appCache, &nonFragmentHash, &m_nonFragmentElf,
-                                                                  &m_nonFragmentShaderCache, &m_hNonFragmentEntry);
+                                                                  &m_nonFragmentElfBuffer, &m_nonFragmentShaderCache,
+                                                                  &m_hNonFragmentEntry);
   }
 
   if (m_nonFragmentCacheEntryState != ShaderEntryState::Compiling) {
@@ -1258,10 +1590,11 @@ unsigned Compiler::ConvertColorBufferFormatToExportFormat(const ColorTarget *tar
 // @param forceLoopUnrollCount : Force loop unroll count (0 means disable)
 // @param buildingRelocatableElf : Build the pipeline by linking relocatable elf
 // @param [out] pipelineElf : Output Elf package
+// @param [out] linkedModule : If not nullptr, receives the linked pipeline module
 Result Compiler::buildGraphicsPipelineInternal(GraphicsContext *graphicsContext,
                                                ArrayRef<const PipelineShaderInfo *> shaderInfo,
                                                unsigned forceLoopUnrollCount, bool buildingRelocatableElf,
-                                               ElfPackage *pipelineElf) {
+                                               ElfPackage *pipelineElf, LinkedPipelineModule *linkedModule) {
   Context *context = acquireContext();
   context->attachPipelineContext(graphicsContext);
 
@@ -1269,7 +1602,8 @@ Result Compiler::buildGraphicsPipelineInternal(GraphicsContext *graphicsContext,
   if (buildingRelocatableElf)
     result = buildPipelineWithRelocatableElf(context, shaderInfo, forceLoopUnrollCount, pipelineElf);
   else
-    result = buildPipelineInternal(context, shaderInfo, forceLoopUnrollCount, /*unlinked=*/false, pipelineElf);
+    result = buildPipelineInternal(context, shaderInfo, forceLoopUnrollCount, /*unlinked=*/false, pipelineElf,
+                                   linkedModule);
   releaseContext(context);
   return result;
 }
@@ -1282,6 +1616,8 @@ Result Compiler::buildGraphicsPipelineInternal(GraphicsContext *graphicsContext,
 // @param pipelineDumpFile : Handle of pipeline dump file
 Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipelineInfo,
                                        GraphicsPipelineBuildOut *pipelineOut, void *pipelineDumpFile) {
+  // Keep data retrieved from the internal shader cache valid until it has been copied to the output.
+  ShaderCacheUse cacheUse(m_shaderCache.get());
   Result result = Result::Success;
   BinaryData elfBin = {};
 
@@ -1297,6 +1633,8 @@ Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipeline
   MetroHash::Hash pipelineHash = {};
   cacheHash = PipelineDumper::generateHashForGraphicsPipeline(pipelineInfo, true, buildingRelocatableElf);
   pipelineHash = PipelineDumper::generateHashForGraphicsPipeline(pipelineInfo, false, false);
+  std::unique_ptr<CompileProfile> compileProfile =
+      CompileProfile::create("graphics", MetroHash::compact64(&pipelineHash));
 
   if (result == Result::Success && EnableOuts()) {
     LLPC_OUTS("===============================================================================\n");
@@ -1329,28 +1667,54 @@ Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipeline
 #endif
   ShaderCache *shaderCache = nullptr;
   CacheEntryHandle hEntry = nullptr;
+  ElfPackage candidateElf;
 
   if (!buildingRelocatableElf)
-    cacheEntryState = lookUpShaderCaches(appCache, &cacheHash, &elfBin, &shaderCache, &hEntry);
+    cacheEntryState = lookUpShaderCaches(appCache, &cacheHash, &elfBin, &candidateElf, &shaderCache, &hEntry);
   else
     cacheEntryState = ShaderEntryState::Compiling;
 
-  ElfPackage candidateElf;
+  if (compileProfile) {
+    // NOTE: A relocatable ELF build looks in the shader cache per stage rather than for the whole pipeline.
+    CompileProfileCacheResult cacheResult = CompileProfileCacheResult::None;
+    if (!buildingRelocatableElf) {
+      cacheResult = cacheEntryState == ShaderEntryState::Ready ? CompileProfileCacheResult::Hit
+                                                               : CompileProfileCacheResult::Miss;
+    }
+    compileProfile->setCacheResult(MetroHash::compact64(&cacheHash), cacheResult);
+  }
 
   if (cacheEntryState == ShaderEntryState::Compiling) {
     unsigned forceLoopUnrollCount = cl::ForceLoopUnrollCount;
 
-    GraphicsContext graphicsContext(m_gfxIp, pipelineInfo, &pipelineHash, &cacheHash);
+    // With tiered compilation, build the pipeline at the fast tier now, under the cache hash of the fully optimized
+    // pipeline that replaces it once it has been built in the background.
+    const GraphicsPipelineBuildInfo *buildInfo = pipelineInfo;
+    GraphicsPipelineBuildInfo fastPipelineInfo;
+    std::shared_ptr<LinkedPipelineModule> linkedModule;
+    if (canUseTieredCompile(shaderInfo, pipelineInfo->options, buildingRelocatableElf, shaderCache, hEntry)) {
+      fastPipelineInfo = *pipelineInfo;
+      fastPipelineInfo.options.optimizationTier = OptimizationTier::Fast;
+      buildInfo = &fastPipelineInfo;
+      linkedModule = std::make_shared<LinkedPipelineModule>();
+    }
+
+    GraphicsContext graphicsContext(m_gfxIp, buildInfo, &pipelineHash, &cacheHash);
+    graphicsContext.setCompileProfile(compileProfile.get());
     result = buildGraphicsPipelineInternal(&graphicsContext, shaderInfo, forceLoopUnrollCount, buildingRelocatableElf,
-                                           &candidateElf);
+                                           &candidateElf, linkedModule.get());
 
     if (result == Result::Success) {
       elfBin.codeSize = candidateElf.size();
       elfBin.pCode = candidateElf.data();
     }
 
-    if (!buildingRelocatableElf)
-      updateShaderCache((result == Result::Success), &elfBin, shaderCache, hEntry);
+    if (!buildingRelocatableElf) {
+      updateShaderCache((result == Result::Success), &elfBin, shaderCache, hEntry,
+                        linkedModule ? ShaderQuality::Fast : ShaderQuality::Full);
+    }
+    if (result == Result::Success && linkedModule)
+      startFullTierBuild(std::move(linkedModule), cacheHash);
   }
 
   if (result == Result::Success) {
@@ -1369,9 +1733,200 @@ Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipeline
     pipelineOut->pipelineBin.pCode = code;
   }
 
+  if (compileProfile) {
+    compileProfile->setElfSize(result == Result::Success ? elfBin.codeSize : 0);
+    compileProfile->setResult(result);
+  }
+
   return result;
 }
 
+// =====================================================================================================================
+// Represents an asynchronous pipeline build whose handle has been returned to the client.
+class PipelineBuild : public IPipelineBuild {
+public:
+  PipelineBuild(ThreadPool *threadPool, TaskPriority priority) : m_tasks(threadPool, priority) {}
+
+  virtual bool IsComplete() const { return m_complete; }
+
+  virtual Result Wait() {
+    m_tasks.wait();
+    return m_result;
+  }
+
+  virtual void Destroy() {
+    m_tasks.wait();
+    delete this;
+  }
+
+  // Queues the build
+  void start(std::function<void()> build) { m_tasks.async(std::move(build)); }
+
+  // Sets the result of the build once it has completed
+  void setResult(Result result) {
+    m_result = result;
+    m_complete = true;
+  }
+
+private:
+  TaskGroup m_tasks;                      // The build, as a group of one task
+  Result m_result = Result::Success;      // Result of the build
+  std::atomic<bool> m_complete = {false}; // Whether the build has completed
+};
+
+// =====================================================================================================================
+// Starts a pipeline build on the thread pool.
+//
+// @param build : Function that builds the pipeline
+// @param priority : Priority of the build
+// @param pfnComplete : Function called with the result of the build when it has completed (optional)
+// @param userData : User data passed to pfnComplete
+// @param [out] ppBuild : Handle to wait on the build (optional)
+Result Compiler::startPipelineBuild(std::function<Result()> build, BuildPriority priority,
+                                    BuildCompleteFunc pfnComplete, void *userData, IPipelineBuild **ppBuild) {
+  if (priority > BuildPriority::Foreground)
+    return Result::ErrorInvalidValue;
+  TaskPriority taskPriority = static_cast<TaskPriority>(priority);
+
+  {
+    std::lock_guard<std::mutex> lock(m_asyncBuildLock);
+    ++m_asyncBuildCount;
+  }
+
+  PipelineBuild *pipelineBuild = ppBuild ? new PipelineBuild(m_threadPool, taskPriority) : nullptr;
+  auto runBuild = [this, build, pfnComplete, userData, pipelineBuild] {
+    Result result = build();
+    if (pfnComplete)
+      pfnComplete(userData, result);
+    if (pipelineBuild)
+      pipelineBuild->setResult(result);
+    asyncBuildDone();
+  };
+
+  if (pipelineBuild) {
+    pipelineBuild->start(runBuild);
+    *ppBuild = pipelineBuild;
+  } else
+    m_threadPool->async(runBuild, taskPriority);
+  return Result::Success;
+}
+
+// =====================================================================================================================
+// Notes that an asynchronous build has completed.
+void Compiler::asyncBuildDone() {
+  std::lock_guard<std::mutex> lock(m_asyncBuildLock);
+  if (--m_asyncBuildCount == 0)
+    m_asyncBuildsDone.notify_all();
+}
+
+// =====================================================================================================================
+// Checks whether a pipeline missing from the shader cache can be built with tiered compilation: first at the fast
+// optimization tier, then fully optimized in the background. The background build generates the pipeline from the
+// linked pipeline module, so this needs the pipeline state to be recorded in that module by BuilderRecorder, and the
+// pipeline to be built from SPIR-V without patching of the ELF afterwards. The cache entry must be in the internal
+// shader cache, as that outlives the background build.
+//
+// @param shaderInfo : Shader info of the pipeline
+// @param options : Pipeline options
+// @param buildingRelocatableElf : Whether the pipeline is built by linking relocatable elf
+// @param shaderCache : Shader cache holding the cache entry (nullptr for the internal shader cache)
+// @param hEntry : Cache entry of the pipeline
+bool Compiler::canUseTieredCompile(ArrayRef<const PipelineShaderInfo *> shaderInfo, const PipelineOptions &options,
+                                   bool buildingRelocatableElf, ShaderCache *shaderCache,
+                                   CacheEntryHandle hEntry) const {
+  if (!TieredCompile || !UseBuilderRecorder || buildingRelocatableElf || !hEntry ||
+      options.optimizationTier != OptimizationTier::Full)
+    return false;
+  if (shaderCache && shaderCache != m_shaderCache.get())
+    return false;
+
+  for (const PipelineShaderInfo *shaderInfoEntry : shaderInfo) {
+    if (!shaderInfoEntry || !shaderInfoEntry->pModuleData)
+      continue;
+    const ShaderModuleData *moduleData = reinterpret_cast<const ShaderModuleData *>(shaderInfoEntry->pModuleData);
+    if (moduleData->binType != BinaryType::Spirv ||
+        (shaderInfoEntry->entryStage == ShaderStageFragment && shaderInfoEntry->options.updateDescInElf))
+      return false;
+  }
+  return true;
+}
+
+// =====================================================================================================================
+// Starts the background build of the fully optimized version of a pipeline that was built at the fast optimization
+// tier. When it completes, it replaces the fast pipeline in the internal shader cache. The build is counted as an
+// asynchronous build, so the compiler waits for it before it is destroyed.
+//
+// @param linkedModule : Linked pipeline module kept from the fast build
+// @param cacheHash : Cache hash of the pipeline
+void Compiler::startFullTierBuild(std::shared_ptr<LinkedPipelineModule> linkedModule,
+                                  const MetroHash::Hash &cacheHash) {
+  {
+    std::lock_guard<std::mutex> lock(m_asyncBuildLock);
+    ++m_asyncBuildCount;
+  }
+
+  auto build = [this, linkedModule, cacheHash] {
+    // Keep the cache from being compacted while the pipeline is replaced in it.
+    ShaderCacheUse cacheUse(m_shaderCache.get());
+    Context *context = acquireContext();
+    ElfPackage pipelineElf;
+    bool success = false;
+
+    BinaryData binCode = {};
+    binCode.codeSize = linkedModule->bitcode.size();
+    binCode.pCode = linkedModule->bitcode.data();
+    std::unique_ptr<Module> pipelineModule = context->loadLibary(&binCode);
+    if (pipelineModule) {
+      context->addMaterializedInstCount(pipelineModule->getInstructionCount());
+      // The rest of the pipeline state is read from the module.
+      std::unique_ptr<Pipeline> pipeline(context->getLgcContext()->createPipeline());
+      lgc::Options options = linkedModule->options;
+      options.optimizationTier = lgc::OptimizationTier::Full;
+      pipeline->setShaderStageMask(linkedModule->stageMask);
+      pipeline->setOptions(options);
+
+      raw_svector_ostream elfStream(pipelineElf);
+#if LLPC_ENABLE_EXCEPTION
+      try
+#endif
+      {
+        pipeline->generate(std::move(pipelineModule), elfStream, nullptr, {}, {});
+        success = true;
+      }
+#if LLPC_ENABLE_EXCEPTION
+      catch (const char *) {
+      }
+#endif
+    }
+    releaseContext(context);
+
+    // If the full build failed, the fast pipeline is discarded from the cache, so that the next build of the pipeline
+    // compiles it again and retries the full build.
+    if (success && !pipelineElf.empty())
+      m_shaderCache->promoteShader(cacheHash, pipelineElf.data(), pipelineElf.size(), ShaderQuality::Full);
+    else
+      m_shaderCache->discardShader(cacheHash, ShaderQuality::Fast);
+    asyncBuildDone();
+  };
+  m_threadPool->async(build, TaskPriority::Background);
+}
+
+// =====================================================================================================================
+// Start building a graphics pipeline from the specified info on the thread pool.
+//
+// @param pipelineInfo : Info to build this graphics pipeline
+// @param [out] pipelineOut : Output of building this graphics pipeline
+// @param priority : Priority of the build
+// @param pfnComplete : Function called with the result of the build when it has completed (optional)
+// @param userData : User data passed to pfnComplete
+// @param [out] ppBuild : Handle to wait on the build (optional)
+Result Compiler::BuildGraphicsPipelineAsync(const GraphicsPipelineBuildInfo *pipelineInfo,
+                                            GraphicsPipelineBuildOut *pipelineOut, BuildPriority priority,
+                                            BuildCompleteFunc pfnComplete, void *userData, IPipelineBuild **ppBuild) {
+  auto build = [this, pipelineInfo, pipelineOut] { return BuildGraphicsPipeline(pipelineInfo, pipelineOut); };
+  return startPipelineBuild(build, priority, pfnComplete, userData, ppBuild);
+}
+
 // =====================================================================================================================
 // Build compute pipeline internally
 //
@@ -1380,10 +1935,11 @@ Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipeline
 // @param forceLoopUnrollCount : Force loop unroll count (0 means disable)
 // @param buildingRelocatableElf : Build the pipeline by linking relocatable elf
 // @param [out] pipelineElf : Output Elf package
+// @param [out] linkedModule : If not nullptr, receives the linked pipeline module
 Result Compiler::buildComputePipelineInternal(ComputeContext *computeContext,
                                               const ComputePipelineBuildInfo *pipelineInfo,
                                               unsigned forceLoopUnrollCount, bool buildingRelocatableElf,
-                                              ElfPackage *pipelineElf) {
+                                              ElfPackage *pipelineElf, LinkedPipelineModule *linkedModule) {
   Context *context = acquireContext();
   context->attachPipelineContext(computeContext);
 
@@ -1394,7 +1950,8 @@ Result Compiler::buildComputePipelineInternal(ComputeContext *computeContext,
   if (buildingRelocatableElf)
     result = buildPipelineWithRelocatableElf(context, shadersInfo, forceLoopUnrollCount, pipelineElf);
   else
-    result = buildPipelineInternal(context, shadersInfo, forceLoopUnrollCount, /*unlinked=*/false, pipelineElf);
+    result = buildPipelineInternal(context, shadersInfo, forceLoopUnrollCount, /*unlinked=*/false, pipelineElf,
+                                   linkedModule);
   releaseContext(context);
   return result;
 }
@@ -1407,6 +1964,8 @@ Result Compiler::buildComputePipelineInternal(ComputeContext *computeContext,
 // @param pipelineDumpFile : Handle of pipeline dump file
 Result Compiler::BuildComputePipeline(const ComputePipelineBuildInfo *pipelineInfo,
                                       ComputePipelineBuildOut *pipelineOut, void *pipelineDumpFile) {
+  // Keep data retrieved from the internal shader cache valid until it has been copied to the output.
+  ShaderCacheUse cacheUse(m_shaderCache.get());
   BinaryData elfBin = {};
 
   bool buildingRelocatableElf = canUseRelocatableComputeShaderElf(&pipelineInfo->cs);
@@ -1417,6 +1976,8 @@ Result Compiler::BuildComputePipeline(const ComputePipelineBuildInfo *pipelineIn
   MetroHash::Hash pipelineHash = {};
   cacheHash = PipelineDumper::generateHashForComputePipeline(pipelineInfo, true, buildingRelocatableElf);
   pipelineHash = PipelineDumper::generateHashForComputePipeline(pipelineInfo, false, buildingRelocatableElf);
+  std::unique_ptr<CompileProfile> compileProfile =
+      CompileProfile::create("compute", MetroHash::compact64(&pipelineHash));
 
   if (result == Result::Success && EnableOuts()) {
     const ShaderModuleData *moduleData = reinterpret_cast<const ShaderModuleData *>(pipelineInfo->cs.pModuleData);
@@ -1445,28 +2006,54 @@ Result Compiler::BuildComputePipeline(const ComputePipelineBuildInfo *pipelineIn
 #endif
   ShaderCache *shaderCache = nullptr;
   CacheEntryHandle hEntry = nullptr;
+  ElfPackage candidateElf;
 
   if (!buildingRelocatableElf)
-    cacheEntryState = lookUpShaderCaches(appCache, &cacheHash, &elfBin, &shaderCache, &hEntry);
+    cacheEntryState = lookUpShaderCaches(appCache, &cacheHash, &elfBin, &candidateElf, &shaderCache, &hEntry);
   else
     cacheEntryState = ShaderEntryState::Compiling;
 
-  ElfPackage candidateElf;
+  if (compileProfile) {
+    // NOTE: A relocatable ELF build looks in the shader cache per stage rather than for the whole pipeline.
+    CompileProfileCacheResult cacheResult = CompileProfileCacheResult::None;
+    if (!buildingRelocatableElf) {
+      cacheResult = cacheEntryState == ShaderEntryState::Ready ? CompileProfileCacheResult::Hit
+                                                               : CompileProfileCacheResult::Miss;
+    }
+    compileProfile->setCacheResult(MetroHash::compact64(&cacheHash), cacheResult);
+  }
 
   if (cacheEntryState == ShaderEntryState::Compiling) {
     unsigned forceLoopUnrollCount = cl::ForceLoopUnrollCount;
 
-    ComputeContext computeContext(m_gfxIp, pipelineInfo, &pipelineHash, &cacheHash);
+    // With tiered compilation, build the pipeline at the fast tier now, under the cache hash of the fully optimized
+    // pipeline that replaces it once it has been built in the background.
+    const ComputePipelineBuildInfo *buildInfo = pipelineInfo;
+    ComputePipelineBuildInfo fastPipelineInfo;
+    std::shared_ptr<LinkedPipelineModule> linkedModule;
+    if (canUseTieredCompile(&pipelineInfo->cs, pipelineInfo->options, buildingRelocatableElf, shaderCache, hEntry)) {
+      fastPipelineInfo = *pipelineInfo;
+      fastPipelineInfo.options.optimizationTier = OptimizationTier::Fast;
+      buildInfo = &fastPipelineInfo;
+      linkedModule = std::make_shared<LinkedPipelineModule>();
+    }
 
-    result = buildComputePipelineInternal(&computeContext, pipelineInfo, forceLoopUnrollCount, buildingRelocatableElf,
-                                          &candidateElf);
+    ComputeContext computeContext(m_gfxIp, buildInfo, &pipelineHash, &cacheHash);
+    computeContext.setCompileProfile(compileProfile.get());
+
+    result = buildComputePipelineInternal(&computeContext, buildInfo, forceLoopUnrollCount, buildingRelocatableElf,
+                                          &candidateElf, linkedModule.get());
 
     if (result == Result::Success) {
       elfBin.codeSize = candidateElf.size();
       elfBin.pCode = candidateElf.data();
     }
-    if (!buildingRelocatableElf)
-      updateShaderCache((result == Result::Success), &elfBin, shaderCache, hEntry);
+    if (!buildingRelocatableElf) {
+      updateShaderCache((result == Result::Success), &elfBin, shaderCache, hEntry,
+                        linkedModule ? ShaderQuality::Fast : ShaderQuality::Full);
+    }
+    if (result == Result::Success && linkedModule)
+      startFullTierBuild(std::move(linkedModule), cacheHash);
   }
 
   if (result == Result::Success) {
@@ -1487,9 +2074,30 @@ Result Compiler::BuildComputePipeline(const ComputePipelineBuildInfo *pipelineIn
     }
   }
 
+  if (compileProfile) {
+    compileProfile->setElfSize(result == Result::Success ? elfBin.codeSize : 0);
+    compileProfile->setResult(result);
+  }
+
   return result;
 }
 
+// =====================================================================================================================
+// Start building a compute pipeline from the specified info on the thread pool.
+//
+// @param pipelineInfo : Info to build this compute pipeline
+// @param [out] pipelineOut : Output of building this compute pipeline
+// @param priority : Priority of the build
+// @param pfnComplete : Function called with the result of the build when it has completed (optional)
+// @param userData : User data passed to pfnComplete
+// @param [out] ppBuild : Handle to wait on the build (optional)
+Result Compiler::BuildComputePipelineAsync(const ComputePipelineBuildInfo *pipelineInfo,
+                                           ComputePipelineBuildOut *pipelineOut, BuildPriority priority,
+                                           BuildCompleteFunc pfnComplete, void *userData, IPipelineBuild **ppBuild) {
+  auto build = [this, pipelineInfo, pipelineOut] { return BuildComputePipeline(pipelineInfo, pipelineOut); };
+  return startPipelineBuild(build, priority, pfnComplete, userData, ppBuild);
+}
+
 // =====================================================================================================================
 // Builds hash code from compilation-options
 //
@@ -1595,6 +2203,7 @@ Result Compiler::CreateShaderCache(const ShaderCacheCreateInfo *pCreateInfo, //
   if ((result == Result::Success) &&
       ((cl::ShaderCacheMode == ShaderCacheEnableRuntime) || (cl::ShaderCacheMode == ShaderCacheEnableOnDisk)) &&
       (pCreateInfo->initialDataSize > 0)) {
+    ShaderCacheUse cacheUse(m_shaderCache.get());
     m_shaderCache->Merge(1, const_cast<const IShaderCache **>(ppShaderCache));
   }
 
@@ -1605,37 +2214,7 @@ Result Compiler::CreateShaderCache(const ShaderCacheCreateInfo *pCreateInfo, //
 // =====================================================================================================================
 // Acquires a free context from context pool.
 Context *Compiler::acquireContext() const {
-  Context *freeContext = nullptr;
-
-  std::lock_guard<sys::Mutex> lock(m_contextPoolMutex);
-
-  // Try to find a free context from pool first
-  for (auto &context : *m_contextPool) {
-    GfxIpVersion gfxIpVersion = context->getGfxIpVersion();
-
-    if (!context->isInUse() && gfxIpVersion.major == m_gfxIp.major && gfxIpVersion.minor == m_gfxIp.minor &&
-        gfxIpVersion.stepping == m_gfxIp.stepping) {
-      // Free up context if it is being used too many times to avoid consuming too much memory.
-      int contextReuseLimit = cl::ContextReuseLimit.getValue();
-      if (contextReuseLimit > 0 && context->getUseCount() > contextReuseLimit) {
-        delete context;
-        context = new Context(m_gfxIp);
-      }
-      freeContext = context;
-      break;
-    }
-  }
-
-  if (!freeContext) {
-    // Create a new one if we fail to find an available one
-    freeContext = new Context(m_gfxIp);
-    m_contextPool->push_back(freeContext);
-  }
-
-  assert(freeContext);
-  freeContext->setInUse(true);
-
-  return freeContext;
+  return m_contextPool->acquire(m_gfxIp);
 }
 
 // =====================================================================================================================
@@ -1665,9 +2244,15 @@ bool Compiler::runPasses(lgc::PassManager *passMgr, Module *module) const {
 //
 // @param context : LLPC context
 void Compiler::releaseContext(Context *context) const {
-  std::lock_guard<sys::Mutex> lock(m_contextPoolMutex);
   context->reset();
-  context->setInUse(false);
+
+  // Free up the context if it has been used too many times, or has materialized so much IR that the types, constants
+  // and metadata it keeps take up too much memory.
+  int contextReuseLimit = cl::ContextReuseLimit.getValue();
+  bool recycleForUses = contextReuseLimit > 0 && context->getUseCount() >= static_cast<unsigned>(contextReuseLimit);
+  bool recycleForSize =
+      cl::ContextRecycleInstCount > 0 && context->getMaterializedInstCount() >= cl::ContextRecycleInstCount;
+  m_contextPool->release(context, recycleForUses, recycleForSize);
 }
 
 // =====================================================================================================================
@@ -1681,10 +2266,11 @@ void Compiler::releaseContext(Context *context) const {
 // @param appPipelineCache : App's pipeline cache
 // @param cacheHash : Hash code of the shader
 // @param [out] elfBin : Pointer to shader data
+// @param [out] elfBuffer : Buffer that holds the shader data if it is stored compressed
 // @param [out] ppShaderCache : Shader cache to use
 // @param [out] phEntry : Handle to use
 ShaderEntryState Compiler::lookUpShaderCaches(IShaderCache *appPipelineCache, MetroHash::Hash *cacheHash,
-                                              BinaryData *elfBin, ShaderCache **ppShaderCache,
+                                              BinaryData *elfBin, ElfPackage *elfBuffer, ShaderCache **ppShaderCache,
                                               CacheEntryHandle *phEntry) {
   ShaderCache *shaderCache[2];
   unsigned shaderCacheCount = 0;
@@ -1703,7 +2289,7 @@ ShaderEntryState Compiler::lookUpShaderCaches(IShaderCache *appPipelineCache, Me
     CacheEntryHandle hCurrentEntry;
     ShaderEntryState cacheEntryState = shaderCache[i]->findShader(*cacheHash, allocateOnMiss, &hCurrentEntry);
     if (cacheEntryState == ShaderEntryState::Ready) {
-      Result result = shaderCache[i]->retrieveShader(hCurrentEntry, &elfBin->pCode, &elfBin->codeSize);
+      Result result = shaderCache[i]->retrieveShader(hCurrentEntry, &elfBin->pCode, &elfBin->codeSize, elfBuffer);
       if (result == Result::Success)
         return ShaderEntryState::Ready;
     } else if (cacheEntryState == ShaderEntryState::Compiling) {
@@ -1727,8 +2313,9 @@ ShaderEntryState Compiler::lookUpShaderCaches(IShaderCache *appPipelineCache, Me
 // @param elfBin : Pointer to shader data
 // @param shaderCache : Shader cache to update (may be nullptr for default)
 // @param hEntry : Handle to update
+// @param quality : Quality of the shader data to insert
 void Compiler::updateShaderCache(bool insert, const BinaryData *elfBin, ShaderCache *shaderCache,
-                                 CacheEntryHandle hEntry) {
+                                 CacheEntryHandle hEntry, ShaderQuality quality) {
   if (!hEntry)
     return;
 
@@ -1737,7 +2324,7 @@ void Compiler::updateShaderCache(bool insert, const BinaryData *elfBin, ShaderCa
 
   if (insert) {
     assert(elfBin->codeSize > 0);
-    shaderCache->insertShader(hEntry, elfBin->pCode, elfBin->codeSize);
+    shaderCache->insertShader(hEntry, elfBin->pCode, elfBin->codeSize, quality);
   } else
     shaderCache->resetShader(hEntry);
 }
@@ -1768,6 +2355,7 @@ void Compiler::buildShaderCacheHash(Context *context, unsigned stageMask, ArrayR
     // Update common shader info
     PipelineDumper::updateHashForPipelineShaderInfo(stage, shaderInfo, true, &hasher, false);
     hasher.Update(pipelineInfo->iaState.deviceIndex);
+    hasher.Update(pipelineOptions->optimizationTier);
 
     // Update input/output usage (provided by middle-end caller of this callback).
     hasher.Update(stageHashes[stage].data(), stageHashes[stage].size());
@@ -1806,49 +2394,35 @@ void Compiler::buildShaderCacheHash(Context *context, unsigned stageMask, ArrayR
 }
 
 // =====================================================================================================================
-// Link relocatable shader elf file into a pipeline elf file and apply relocations.
+// Link relocatable shader elf files into a pipeline elf file and apply relocations, using the middle-end ELF linker.
+// The relocatable elfs are built with the vertex input and color export state applied, so the link needs no glue code.
 //
-// @param shaderElfs : An array of pipeline elf packages, indexed by stage, containing relocatable elf
+// @param shaderElfs : An array of pipeline elf packages, indexed by the first stage of the group of stages each was
+//                     built from, containing relocatable elf
 // @param [out] pipelineElf : Elf package containing the pipeline elf
 // @param context : Acquired context
-void Compiler::linkRelocatableShaderElf(ElfPackage *shaderElfs, ElfPackage *pipelineElf, Context *context) {
-  assert(shaderElfs[ShaderStageTessControl].empty() && "Cannot link tessellation shaders yet.");
-  assert(shaderElfs[ShaderStageTessEval].empty() && "Cannot link tessellation shaders yet.");
-  assert(shaderElfs[ShaderStageGeometry].empty() && "Cannot link geometry shaders yet.");
-
-  Result result = Result::Success;
-  ElfWriter<Elf64> writer(m_gfxIp);
-
-  if (shaderElfs[ShaderStageCompute].empty()) {
-    ElfReader<Elf64> vsReader(m_gfxIp);
-    ElfReader<Elf64> fsReader(m_gfxIp);
-    if (!shaderElfs[ShaderStageVertex].empty()) {
-      size_t codeSize = shaderElfs[ShaderStageVertex].size_in_bytes();
-      result = vsReader.ReadFromBuffer(shaderElfs[ShaderStageVertex].data(), &codeSize);
-      if (result != Result::Success)
-        return;
-    }
-
-    if (!shaderElfs[ShaderStageFragment].empty()) {
-      size_t codeSize = shaderElfs[ShaderStageFragment].size_in_bytes();
-      result = fsReader.ReadFromBuffer(shaderElfs[ShaderStageFragment].data(), &codeSize);
-      if (result != Result::Success)
-        return;
-    }
+// @return : Result::Success, or Result::ErrorUnavailable if the pipeline cannot be linked from the relocatable elfs
+Result Compiler::linkRelocatableShaderElf(ElfPackage *shaderElfs, ElfPackage *pipelineElf, Context *context) {
+  // Set up a middle-end pipeline object with the full pipeline state. The user data has already been merged.
+  std::unique_ptr<Pipeline> pipeline(context->getLgcContext()->createPipeline());
+  context->getPipelineContext()->setPipelineState(&*pipeline, /*unlinked=*/false);
 
-    result = writer.linkGraphicsRelocatableElf({&vsReader, &fsReader}, context);
-  } else {
-    ElfReader<Elf64> csReader(m_gfxIp);
-    size_t codeSize = shaderElfs[ShaderStageCompute].size_in_bytes();
-    result = csReader.ReadFromBuffer(shaderElfs[ShaderStageCompute].data(), &codeSize);
-    if (result != Result::Success)
-      return;
-    result = writer.linkComputeRelocatableElf(csReader, context);
+  // Gather the relocatable elfs in stage order.
+  SmallVector<MemoryBufferRef, ShaderStageNativeStageCount> elfs;
+  for (unsigned stage = 0; stage < ShaderStageNativeStageCount; ++stage) {
+    if (shaderElfs[stage].empty())
+      continue;
+    elfs.push_back(MemoryBufferRef(shaderElfs[stage], getShaderStageAbbreviation(static_cast<ShaderStage>(stage))));
   }
+  std::unique_ptr<ElfLinker> elfLinker(pipeline->createElfLinker(elfs));
 
-  if (result != Result::Success)
-    return;
-  writer.writeToBuffer(pipelineElf);
+  raw_svector_ostream elfStream(*pipelineElf);
+  if (!elfLinker->link(elfStream)) {
+    LLPC_OUTS("Cannot link relocatable shaders: " << pipeline->getLastError() << "\n");
+    pipelineElf->clear();
+    return Result::ErrorUnavailable;
+  }
+  return Result::Success;
 }
 
 // =====================================================================================================================
@@ -33,9 +33,12 @@
 #include "llpc.h"
 #include "llpcShaderCacheManager.h"
 #include "llpcShaderModuleHelper.h"
+#include "llpcThreadPool.h"
 #include "vkgcElfReader.h"
 #include "vkgcMetroHash.h"
 #include "lgc/CommonDefs.h"
+#include "lgc/Pipeline.h"
+#include <memory>
 
 namespace llvm {
 
@@ -58,7 +61,9 @@ using Vkgc::findVkStructInChain;
 class Compiler;
 class ComputeContext;
 class Context;
+class ContextPool;
 class GraphicsContext;
+class PipelineContext;
 
 // =====================================================================================================================
 // Object to manage checking and updating shader cache for graphics pipeline.
@@ -85,11 +90,22 @@ private:
   ShaderCache *m_nonFragmentShaderCache = nullptr;
   CacheEntryHandle m_hNonFragmentEntry = {};
   BinaryData m_nonFragmentElf = {};
+  ElfPackage m_nonFragmentElfBuffer;
 
   ShaderEntryState m_fragmentCacheEntryState = ShaderEntryState::New;
   ShaderCache *m_fragmentShaderCache = nullptr;
   CacheEntryHandle m_hFragmentEntry = {};
   BinaryData m_fragmentElf = {};
+  ElfPackage m_fragmentElfBuffer;
+};
+
+// =====================================================================================================================
+// Linked pipeline module kept from a build at the fast optimization tier, from which the fully optimized pipeline is
+// built in the background.
+struct LinkedPipelineModule {
+  ElfPackage bitcode;   // Pipeline module as bitcode, with the pipeline state recorded in its metadata
+  unsigned stageMask;   // Middle-end shader stage mask of the pipeline
+  lgc::Options options; // Pipeline options given to the middle-end
 };
 
 // =====================================================================================================================
@@ -111,20 +127,29 @@ public:
 
   virtual Result BuildComputePipeline(const ComputePipelineBuildInfo *pipelineInfo,
                                       ComputePipelineBuildOut *pipelineOut, void *pipelineDumpFile = nullptr);
+
+  virtual Result BuildGraphicsPipelineAsync(const GraphicsPipelineBuildInfo *pipelineInfo,
+                                            GraphicsPipelineBuildOut *pipelineOut, BuildPriority priority,
+                                            BuildCompleteFunc pfnComplete, void *userData, IPipelineBuild **ppBuild);
+
+  virtual Result BuildComputePipelineAsync(const ComputePipelineBuildInfo *pipelineInfo,
+                                           ComputePipelineBuildOut *pipelineOut, BuildPriority priority,
+                                           BuildCompleteFunc pfnComplete, void *userData, IPipelineBuild **ppBuild);
   Result buildGraphicsPipelineInternal(GraphicsContext *graphicsContext,
                                        llvm::ArrayRef<const PipelineShaderInfo *> shaderInfo,
                                        unsigned forceLoopUnrollCount, bool buildingRelocatableElf,
-                                       ElfPackage *pipelineElf);
+                                       ElfPackage *pipelineElf, LinkedPipelineModule *linkedModule);
 
   Result buildComputePipelineInternal(ComputeContext *computeContext, const ComputePipelineBuildInfo *pipelineInfo,
                                       unsigned forceLoopUnrollCount, bool buildingRelocatableElf,
-                                      ElfPackage *pipelineElf);
+                                      ElfPackage *pipelineElf, LinkedPipelineModule *linkedModule);
 
   Result buildPipelineWithRelocatableElf(Context *context, llvm::ArrayRef<const PipelineShaderInfo *> shaderInfo,
                                          unsigned forceLoopUnrollCount, ElfPackage *pipelineElf);
 
   Result buildPipelineInternal(Context *context, llvm::ArrayRef<const PipelineShaderInfo *> shaderInfo,
-                               unsigned forceLoopUnrollCount, bool unlinked, ElfPackage *pipelineElf);
+                               unsigned forceLoopUnrollCount, bool unlinked, ElfPackage *pipelineElf,
+                               LinkedPipelineModule *linkedModule);
 
   // Gets the count of compiler instance.
   static unsigned getInstanceCount() { return m_instanceCount; }
@@ -139,9 +164,10 @@ public:
 #endif
 
   ShaderEntryState lookUpShaderCaches(IShaderCache *appPipelineCache, MetroHash::Hash *cacheHash, BinaryData *elfBin,
-                                      ShaderCache **ppShaderCache, CacheEntryHandle *phEntry);
+                                      ElfPackage *elfBuffer, ShaderCache **ppShaderCache, CacheEntryHandle *phEntry);
 
-  void updateShaderCache(bool insert, const BinaryData *elfBin, ShaderCache *shaderCache, CacheEntryHandle phEntry);
+  void updateShaderCache(bool insert, const BinaryData *elfBin, ShaderCache *shaderCache, CacheEntryHandle phEntry,
+                         ShaderQuality quality = ShaderQuality::Full);
 
   static void buildShaderCacheHash(Context *context, unsigned stageMask,
                                    llvm::ArrayRef<llvm::ArrayRef<uint8_t>> stageHashes, MetroHash::Hash *fragmentHash,
@@ -157,8 +183,19 @@ private:
   Context *acquireContext() const;
   void releaseContext(Context *context) const;
 
+  Result startPipelineBuild(std::function<Result()> build, BuildPriority priority, BuildCompleteFunc pfnComplete,
+                            void *userData, IPipelineBuild **ppBuild);
+  void asyncBuildDone();
+
+  bool canUseTieredCompile(llvm::ArrayRef<const PipelineShaderInfo *> shaderInfo, const PipelineOptions &options,
+                           bool buildingRelocatableElf, ShaderCache *shaderCache, CacheEntryHandle hEntry) const;
+  void startFullTierBuild(std::shared_ptr<LinkedPipelineModule> linkedModule, const MetroHash::Hash &cacheHash);
+
   bool runPasses(lgc::PassManager *passMgr, llvm::Module *module) const;
-  void linkRelocatableShaderElf(ElfPackage *shaderElfs, ElfPackage *pipelineElf, Context *context);
+  Result lowerShaderStageToBitcode(PipelineContext *pipelineContext, const PipelineShaderInfo *shaderInfo,
+                                   unsigned shaderIndex, unsigned forceLoopUnrollCount, ElfPackage *bitcode,
+                                   unsigned *passCount) const;
+  Result linkRelocatableShaderElf(ElfPackage *shaderElfs, ElfPackage *pipelineElf, Context *context);
   bool canUseRelocatableGraphicsShaderElf(const llvm::ArrayRef<const PipelineShaderInfo *> &shaderInfo) const;
   bool canUseRelocatableComputeShaderElf(const PipelineShaderInfo *shaderInfo) const;
 
@@ -168,8 +205,11 @@ private:
   static unsigned m_instanceCount;              // The count of compiler instance
   static unsigned m_outRedirectCount;           // The count of output redirect
   ShaderCachePtr m_shaderCache;                 // Shader cache
-  static llvm::sys::Mutex m_contextPoolMutex;   // Mutex for context pool access
-  static std::vector<Context *> *m_contextPool; // Context pool
+  static ContextPool *m_contextPool;            // Context pool
+  static ThreadPool *m_threadPool;              // Thread pool for asynchronous builds and concurrent stages
+  std::mutex m_asyncBuildLock;                  // Lock for the count of asynchronous builds
+  std::condition_variable m_asyncBuildsDone;    // Signaled when the last asynchronous build has completed
+  unsigned m_asyncBuildCount = 0;               // Count of asynchronous builds not completed yet
 };
 
 // Convert front-end LLPC shader stage to middle-end LGC shader stage
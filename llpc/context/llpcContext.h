@@ -66,6 +66,13 @@ public:
   // Get the number of times this context is used.
   unsigned getUseCount() const { return m_useCount; }
 
+  // Adds to the count of IR instructions materialized in this context.
+  void addMaterializedInstCount(unsigned instCount) { m_materializedInstCount += instCount; }
+
+  // Gets the count of IR instructions materialized in this context over its uses. The types, constants and metadata
+  // that the context keeps after it is reset grow with it.
+  uint64_t getMaterializedInstCount() const { return m_materializedInstCount; }
+
   // Attaches pipeline context to LLPC context.
   void attachPipelineContext(PipelineContext *pipelineContext) { m_pipelineContext = pipelineContext; }
 
@@ -149,7 +156,8 @@ private:
   bool m_scalarBlockLayout = false;                     // scalarBlockLayout option from last pipeline compile
   bool m_robustBufferAccess = false;                    // robustBufferAccess option from last pipeline compile
 
-  unsigned m_useCount = 0; // Number of times this context is used.
+  unsigned m_useCount = 0;               // Number of times this context is used.
+  uint64_t m_materializedInstCount = 0; // Count of IR instructions materialized in this context
 };
 
 } // namespace Llpc
@@ -0,0 +1,157 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcContextPool.cpp
+ * @brief LLPC source file: contains implementation of class Llpc::ContextPool.
+ ***********************************************************************************************************************
+ */
+#include "llpcContextPool.h"
+#include "llpcContext.h"
+
+using namespace llvm;
+
+namespace Llpc {
+
+// =====================================================================================================================
+// Deletes the free contexts. All contexts are expected to have been released by now.
+ContextPool::~ContextPool() {
+  assert(m_inUseCount == 0);
+  trim(0);
+}
+
+// =====================================================================================================================
+// Gets the free list of a graphics IP version, creating it if it does not exist yet.
+//
+// @param gfxIp : Graphics IP version
+ContextPool::FreeList &ContextPool::getFreeList(GfxIpVersion gfxIp) {
+  const uint64_t key = (static_cast<uint64_t>(gfxIp.major) << 48) | (static_cast<uint64_t>(gfxIp.minor) << 32) |
+                       gfxIp.stepping;
+  {
+    sys::ScopedReader lock(m_freeListsLock);
+    auto it = m_freeLists.find(key);
+    if (it != m_freeLists.end())
+      return *it->second;
+  }
+
+  sys::ScopedWriter lock(m_freeListsLock);
+  std::unique_ptr<FreeList> &freeList = m_freeLists[key];
+  if (!freeList)
+    freeList.reset(new FreeList);
+  return *freeList;
+}
+
+// =====================================================================================================================
+// Acquires a context of a graphics IP version, reusing a free one if there is one. The most recently released context
+// is reused first, as its memory is the most likely to still be in the processor caches.
+//
+// @param gfxIp : Graphics IP version
+Context *ContextPool::acquire(GfxIpVersion gfxIp) {
+  FreeList &freeList = getFreeList(gfxIp);
+  Context *context = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(freeList.lock);
+    if (!freeList.contexts.empty()) {
+      context = freeList.contexts.back();
+      freeList.contexts.pop_back();
+      --m_freeCount;
+    }
+  }
+
+  if (!context) {
+    context = new Context(gfxIp);
+    ++m_createdCount;
+  }
+  context->setInUse(true);
+  ++m_acquiredCount;
+  ++m_inUseCount;
+  return context;
+}
+
+// =====================================================================================================================
+// Releases a context, which must have been reset. It is put back in the pool, unless it is to be recycled, in which
+// case it is deleted and a new one is created when one is next needed.
+//
+// @param context : Context to release
+// @param recycleForUses : Whether to recycle the context because it has been used too many times
+// @param recycleForSize : Whether to recycle the context because it has materialized too much IR
+void ContextPool::release(Context *context, bool recycleForUses, bool recycleForSize) {
+  context->setInUse(false);
+  --m_inUseCount;
+
+  if (recycleForUses || recycleForSize) {
+    ++(recycleForSize ? m_recycledBySizeCount : m_recycledByUsesCount);
+    delete context;
+    return;
+  }
+
+  FreeList &freeList = getFreeList(context->getGfxIpVersion());
+  std::lock_guard<std::mutex> lock(freeList.lock);
+  freeList.contexts.push_back(context);
+  ++m_freeCount;
+}
+
+// =====================================================================================================================
+// Deletes free contexts until no more than the given count of them are left. The free lists of the GfxIp versions are
+// trimmed one after another, in no particular order, so only within each list are the least recently released contexts
+// deleted first.
+//
+// @param maxFreeContexts : Count of free contexts to keep
+void ContextPool::trim(size_t maxFreeContexts) {
+  std::vector<Context *> deletedContexts;
+  {
+    sys::ScopedReader lock(m_freeListsLock);
+    for (auto &it : m_freeLists) {
+      FreeList &freeList = *it.second;
+      std::lock_guard<std::mutex> freeListLock(freeList.lock);
+      auto begin = freeList.contexts.begin();
+      while (begin != freeList.contexts.end() && m_freeCount > maxFreeContexts) {
+        deletedContexts.push_back(*begin++);
+        --m_freeCount;
+      }
+      freeList.contexts.erase(freeList.contexts.begin(), begin);
+    }
+  }
+
+  // Delete them outside the locks, as that can take a while.
+  for (Context *context : deletedContexts)
+    delete context;
+}
+
+// =====================================================================================================================
+// Gets the statistics of the pool. With contexts being acquired and released concurrently, the counts may not be
+// consistent with each other.
+ContextPoolStats ContextPool::getStats() const {
+  ContextPoolStats stats = {};
+  stats.acquired = m_acquiredCount;
+  stats.created = m_createdCount;
+  stats.recycledByUses = m_recycledByUsesCount;
+  stats.recycledBySize = m_recycledBySizeCount;
+  stats.freeContexts = m_freeCount;
+  stats.contextsInUse = m_inUseCount;
+  return stats;
+}
+
+} // namespace Llpc
@@ -0,0 +1,93 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcContextPool.h
+ * @brief LLPC header file: contains declaration of class Llpc::ContextPool.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include "llpc.h"
+#include "llvm/Support/RWMutex.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Llpc {
+
+class Context;
+
+// Statistics of a context pool
+struct ContextPoolStats {
+  uint64_t acquired;         // Count of contexts acquired
+  uint64_t created;          // Count of contexts created because no free one was available
+  uint64_t recycledByUses;   // Count of contexts deleted for having been used too many times
+  uint64_t recycledBySize;   // Count of contexts deleted for having materialized too much IR
+  uint64_t freeContexts;     // Count of free contexts in the pool now
+  uint64_t contextsInUse;    // Count of contexts acquired and not released yet
+};
+
+// =====================================================================================================================
+// Represents the pool of contexts shared by the compilers of the process. Free contexts are kept in a list per
+// graphics IP version, each with a lock of its own, so acquiring a context is a pop from the list of its version rather
+// than a search of all contexts under one lock. A released context is deleted rather than kept if it is to be recycled,
+// so the memory that it retains is given back as soon as it is no longer used.
+class ContextPool {
+public:
+  ContextPool() {}
+  ~ContextPool();
+
+  Context *acquire(GfxIpVersion gfxIp);
+  void release(Context *context, bool recycleForUses, bool recycleForSize);
+  void trim(size_t maxFreeContexts);
+  ContextPoolStats getStats() const;
+
+private:
+  ContextPool(const ContextPool &) = delete;
+  ContextPool &operator=(const ContextPool &) = delete;
+
+  // Free contexts of one graphics IP version
+  struct FreeList {
+    std::mutex lock;                 // Lock of the list
+    std::vector<Context *> contexts; // Free contexts, the most recently released last
+  };
+
+  FreeList &getFreeList(GfxIpVersion gfxIp);
+
+  mutable llvm::sys::RWMutex m_freeListsLock;                        // Lock of the map of free lists
+  std::unordered_map<uint64_t, std::unique_ptr<FreeList>> m_freeLists; // Free lists, by graphics IP version
+
+  std::atomic<uint64_t> m_acquiredCount = {0};       // Count of contexts acquired
+  std::atomic<uint64_t> m_createdCount = {0};        // Count of contexts created
+  std::atomic<uint64_t> m_recycledByUsesCount = {0}; // Count of contexts recycled for their use count
+  std::atomic<uint64_t> m_recycledBySizeCount = {0}; // Count of contexts recycled for their materialized IR
+  std::atomic<uint64_t> m_freeCount = {0};           // Count of free contexts
+  std::atomic<uint64_t> m_inUseCount = {0};          // Count of contexts in use
+};
+
+} // namespace Llpc
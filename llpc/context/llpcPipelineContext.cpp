@@ -37,6 +37,7 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
 
 #define DEBUG_TYPE "llpc-pipeline-context"
 
@@ -58,6 +59,12 @@ static cl::opt<bool> IncludeLlvmIr("include-llvm-ir",
                                    cl::desc("Include LLVM IR as a separate section in the ELF binary"),
                                    cl::init(false));
 
+// -optimization-tier: override the optimization tier of the pipeline
+static cl::opt<unsigned> OptimizationTierOverride("optimization-tier",
+                                                  cl::desc("Override the optimization tier of the pipeline "
+                                                           "(0 - full, 1 - fast, 2 - minimal)"),
+                                                  cl::init(0));
+
 // -vgpr-limit: maximum VGPR limit for this shader
 static cl::opt<unsigned> VgprLimit("vgpr-limit", cl::desc("Maximum VGPR limit for this shader"), cl::init(0));
 
@@ -236,6 +243,15 @@ void PipelineContext::setOptionsInPipeline(Pipeline *pipeline) const {
   options.reconfigWorkgroupLayout = getPipelineOptions()->reconfigWorkgroupLayout;
   options.includeIr = (IncludeLlvmIr || getPipelineOptions()->includeIr);
 
+  options.optimizationTier = static_cast<lgc::OptimizationTier>(getPipelineOptions()->optimizationTier);
+  if (OptimizationTierOverride.getNumOccurrences() > 0) {
+    if (OptimizationTierOverride > static_cast<unsigned>(lgc::OptimizationTier::Minimal))
+      report_fatal_error(Twine("Invalid -optimization-tier=") + Twine(OptimizationTierOverride.getValue()) +
+                             ", must be 0 (full), 1 (fast) or 2 (minimal)",
+                         false);
+    options.optimizationTier = static_cast<lgc::OptimizationTier>(OptimizationTierOverride.getValue());
+  }
+
   switch (getPipelineOptions()->shadowDescriptorTableUsage) {
   case Vkgc::ShadowDescriptorTableUsage::Auto:
     // Use default of 2 for standalone amdllpc.
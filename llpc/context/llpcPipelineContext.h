@@ -50,6 +50,8 @@ class Pipeline;
 
 namespace Llpc {
 
+class CompileProfile;
+
 // Enumerates types of descriptor.
 enum class DescriptorType : unsigned {
   UniformBlock = 0,   // Uniform block
@@ -127,6 +129,10 @@ public:
   uint64_t getPiplineHashCode() const { return MetroHash::compact64(&m_pipelineHash); }
   uint64_t getCacheHashCode() const { return MetroHash::compact64(&m_cacheHash); }
 
+  // Gets full pipeline hash and cache hash
+  const MetroHash::Hash &getPipelineHash() const { return m_pipelineHash; }
+  const MetroHash::Hash &getCacheHash() const { return m_cacheHash; }
+
   virtual ShaderHash getShaderHashCode(ShaderStage stage) const;
 
   // Gets per pipeline options
@@ -148,6 +154,10 @@ public:
   // Get whether we are building a relocatable (unlinked) ElF
   bool isUnlinked() const { return m_unlinked; }
 
+  // Set and get the compile profile of the build (nullptr if not profiling)
+  void setCompileProfile(CompileProfile *compileProfile) { m_compileProfile = compileProfile; }
+  CompileProfile *getCompileProfile() const { return m_compileProfile; }
+
 protected:
   // Gets dummy vertex input create info
   virtual VkPipelineVertexInputStateCreateInfo *getDummyVertexInputInfo() { return nullptr; }
@@ -189,7 +199,8 @@ private:
   void setColorExportState(lgc::Pipeline *pipeline) const;
 
   ShaderFpMode m_shaderFpModes[ShaderStageCountInternal] = {};
-  bool m_unlinked = false; // Whether we are building an "unlinked" half-pipeline ELF
+  bool m_unlinked = false;                     // Whether we are building an "unlinked" half-pipeline ELF
+  CompileProfile *m_compileProfile = nullptr; // Compile profile of the build (optional)
 };
 
 } // namespace Llpc
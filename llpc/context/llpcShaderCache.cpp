@@ -30,10 +30,16 @@
 */
 #include "llpcShaderCache.h"
 #include "vkgcUtil.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/DJB.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <numeric>
 #include <string.h>
+#include <unordered_map>
 
 #define DEBUG_TYPE "llpc-shader-cache"
 
@@ -49,67 +55,15 @@ static const char CacheFileSubPath[] = "\\AMD\\LlpcCache\\";
 
 static const char ClientStr[] = "LLPC";
 
-static constexpr uint64_t CrcWidth = sizeof(uint64_t) * 8;
-static constexpr uint64_t CrcInitialValue = 0xFFFFFFFFFFFFFFFF;
-
-static const uint64_t CrcLookup[256] = {
-    0x0000000000000000, 0xAD93D23594C935A9, 0xF6B4765EBD5B5EFB, 0x5B27A46B29926B52, 0x40FB3E88EE7F885F,
-    0xED68ECBD7AB6BDF6, 0xB64F48D65324D6A4, 0x1BDC9AE3C7EDE30D, 0x81F67D11DCFF10BE, 0x2C65AF2448362517,
-    0x77420B4F61A44E45, 0xDAD1D97AF56D7BEC, 0xC10D4399328098E1, 0x6C9E91ACA649AD48, 0x37B935C78FDBC61A,
-    0x9A2AE7F21B12F3B3, 0xAE7F28162D3714D5, 0x03ECFA23B9FE217C, 0x58CB5E48906C4A2E, 0xF5588C7D04A57F87,
-    0xEE84169EC3489C8A, 0x4317C4AB5781A923, 0x183060C07E13C271, 0xB5A3B2F5EADAF7D8, 0x2F895507F1C8046B,
-    0x821A8732650131C2, 0xD93D23594C935A90, 0x74AEF16CD85A6F39, 0x6F726B8F1FB78C34, 0xC2E1B9BA8B7EB99D,
-    0x99C61DD1A2ECD2CF, 0x3455CFE43625E766, 0xF16D8219CEA71C03, 0x5CFE502C5A6E29AA, 0x07D9F44773FC42F8,
-    0xAA4A2672E7357751, 0xB196BC9120D8945C, 0x1C056EA4B411A1F5, 0x4722CACF9D83CAA7, 0xEAB118FA094AFF0E,
-    0x709BFF0812580CBD, 0xDD082D3D86913914, 0x862F8956AF035246, 0x2BBC5B633BCA67EF, 0x3060C180FC2784E2,
-    0x9DF313B568EEB14B, 0xC6D4B7DE417CDA19, 0x6B4765EBD5B5EFB0, 0x5F12AA0FE39008D6, 0xF281783A77593D7F,
-    0xA9A6DC515ECB562D, 0x04350E64CA026384, 0x1FE994870DEF8089, 0xB27A46B29926B520, 0xE95DE2D9B0B4DE72,
-    0x44CE30EC247DEBDB, 0xDEE4D71E3F6F1868, 0x7377052BABA62DC1, 0x2850A14082344693, 0x85C3737516FD733A,
-    0x9E1FE996D1109037, 0x338C3BA345D9A59E, 0x68AB9FC86C4BCECC, 0xC5384DFDF882FB65, 0x4F48D60609870DAF,
-    0xE2DB04339D4E3806, 0xB9FCA058B4DC5354, 0x146F726D201566FD, 0x0FB3E88EE7F885F0, 0xA2203ABB7331B059,
-    0xF9079ED05AA3DB0B, 0x54944CE5CE6AEEA2, 0xCEBEAB17D5781D11, 0x632D792241B128B8, 0x380ADD49682343EA,
-    0x95990F7CFCEA7643, 0x8E45959F3B07954E, 0x23D647AAAFCEA0E7, 0x78F1E3C1865CCBB5, 0xD56231F41295FE1C,
-    0xE137FE1024B0197A, 0x4CA42C25B0792CD3, 0x1783884E99EB4781, 0xBA105A7B0D227228, 0xA1CCC098CACF9125,
-    0x0C5F12AD5E06A48C, 0x5778B6C67794CFDE, 0xFAEB64F3E35DFA77, 0x60C18301F84F09C4, 0xCD5251346C863C6D,
-    0x9675F55F4514573F, 0x3BE6276AD1DD6296, 0x203ABD891630819B, 0x8DA96FBC82F9B432, 0xD68ECBD7AB6BDF60,
-    0x7B1D19E23FA2EAC9, 0xBE25541FC72011AC, 0x13B6862A53E92405, 0x489122417A7B4F57, 0xE502F074EEB27AFE,
-    0xFEDE6A97295F99F3, 0x534DB8A2BD96AC5A, 0x086A1CC99404C708, 0xA5F9CEFC00CDF2A1, 0x3FD3290E1BDF0112,
-    0x9240FB3B8F1634BB, 0xC9675F50A6845FE9, 0x64F48D65324D6A40, 0x7F281786F5A0894D, 0xD2BBC5B36169BCE4,
-    0x899C61D848FBD7B6, 0x240FB3EDDC32E21F, 0x105A7C09EA170579, 0xBDC9AE3C7EDE30D0, 0xE6EE0A57574C5B82,
-    0x4B7DD862C3856E2B, 0x50A1428104688D26, 0xFD3290B490A1B88F, 0xA61534DFB933D3DD, 0x0B86E6EA2DFAE674,
-    0x91AC011836E815C7, 0x3C3FD32DA221206E, 0x671877468BB34B3C, 0xCA8BA5731F7A7E95, 0xD1573F90D8979D98,
-    0x7CC4EDA54C5EA831, 0x27E349CE65CCC363, 0x8A709BFBF105F6CA, 0x9E91AC0C130E1B5E, 0x33027E3987C72EF7,
-    0x6825DA52AE5545A5, 0xC5B608673A9C700C, 0xDE6A9284FD719301, 0x73F940B169B8A6A8, 0x28DEE4DA402ACDFA,
-    0x854D36EFD4E3F853, 0x1F67D11DCFF10BE0, 0xB2F403285B383E49, 0xE9D3A74372AA551B, 0x44407576E66360B2,
-    0x5F9CEF95218E83BF, 0xF20F3DA0B547B616, 0xA92899CB9CD5DD44, 0x04BB4BFE081CE8ED, 0x30EE841A3E390F8B,
-    0x9D7D562FAAF03A22, 0xC65AF24483625170, 0x6BC9207117AB64D9, 0x7015BA92D04687D4, 0xDD8668A7448FB27D,
-    0x86A1CCCC6D1DD92F, 0x2B321EF9F9D4EC86, 0xB118F90BE2C61F35, 0x1C8B2B3E760F2A9C, 0x47AC8F555F9D41CE,
-    0xEA3F5D60CB547467, 0xF1E3C7830CB9976A, 0x5C7015B69870A2C3, 0x0757B1DDB1E2C991, 0xAAC463E8252BFC38,
-    0x6FFC2E15DDA9075D, 0xC26FFC20496032F4, 0x9948584B60F259A6, 0x34DB8A7EF43B6C0F, 0x2F07109D33D68F02,
-    0x8294C2A8A71FBAAB, 0xD9B366C38E8DD1F9, 0x7420B4F61A44E450, 0xEE0A5304015617E3, 0x43998131959F224A,
-    0x18BE255ABC0D4918, 0xB52DF76F28C47CB1, 0xAEF16D8CEF299FBC, 0x0362BFB97BE0AA15, 0x58451BD25272C147,
-    0xF5D6C9E7C6BBF4EE, 0xC1830603F09E1388, 0x6C10D43664572621, 0x3737705D4DC54D73, 0x9AA4A268D90C78DA,
-    0x8178388B1EE19BD7, 0x2CEBEABE8A28AE7E, 0x77CC4ED5A3BAC52C, 0xDA5F9CE03773F085, 0x40757B122C610336,
-    0xEDE6A927B8A8369F, 0xB6C10D4C913A5DCD, 0x1B52DF7905F36864, 0x008E459AC21E8B69, 0xAD1D97AF56D7BEC0,
-    0xF63A33C47F45D592, 0x5BA9E1F1EB8CE03B, 0xD1D97A0A1A8916F1, 0x7C4AA83F8E402358, 0x276D0C54A7D2480A,
-    0x8AFEDE61331B7DA3, 0x91224482F4F69EAE, 0x3CB196B7603FAB07, 0x679632DC49ADC055, 0xCA05E0E9DD64F5FC,
-    0x502F071BC676064F, 0xFDBCD52E52BF33E6, 0xA69B71457B2D58B4, 0x0B08A370EFE46D1D, 0x10D4399328098E10,
-    0xBD47EBA6BCC0BBB9, 0xE6604FCD9552D0EB, 0x4BF39DF8019BE542, 0x7FA6521C37BE0224, 0xD2358029A377378D,
-    0x891224428AE55CDF, 0x2481F6771E2C6976, 0x3F5D6C94D9C18A7B, 0x92CEBEA14D08BFD2, 0xC9E91ACA649AD480,
-    0x647AC8FFF053E129, 0xFE502F0DEB41129A, 0x53C3FD387F882733, 0x08E45953561A4C61, 0xA5778B66C2D379C8,
-    0xBEAB1185053E9AC5, 0x1338C3B091F7AF6C, 0x481F67DBB865C43E, 0xE58CB5EE2CACF197, 0x20B4F813D42E0AF2,
-    0x8D272A2640E73F5B, 0xD6008E4D69755409, 0x7B935C78FDBC61A0, 0x604FC69B3A5182AD, 0xCDDC14AEAE98B704,
-    0x96FBB0C5870ADC56, 0x3B6862F013C3E9FF, 0xA142850208D11A4C, 0x0CD157379C182FE5, 0x57F6F35CB58A44B7,
-    0xFA6521692143711E, 0xE1B9BB8AE6AE9213, 0x4C2A69BF7267A7BA, 0x170DCDD45BF5CCE8, 0xBA9E1FE1CF3CF941,
-    0x8ECBD005F9191E27, 0x235802306DD02B8E, 0x787FA65B444240DC, 0xD5EC746ED08B7575, 0xCE30EE8D17669678,
-    0x63A33CB883AFA3D1, 0x388498D3AA3DC883, 0x95174AE63EF4FD2A, 0x0F3DAD1425E60E99, 0xA2AE7F21B12F3B30,
-    0xF989DB4A98BD5062, 0x541A097F0C7465CB, 0x4FC6939CCB9986C6, 0xE25541A95F50B36F, 0xB972E5C276C2D83D,
-    0x14E137F7E20BED94};
+// Shaders smaller than this are not worth compressing
+static const size_t MinCompressedShaderSize = 256;
 
 // =====================================================================================================================
 ShaderCache::ShaderCache()
     : m_onDiskFile(), m_disableCache(true), m_shaderDataEnd(sizeof(ShaderCacheSerializedHeader)), m_totalShaders(0),
-      m_serializedSize(sizeof(ShaderCacheSerializedHeader)), m_getValueFunc(nullptr), m_storeValueFunc(nullptr) {
+      m_serializedSize(sizeof(ShaderCacheSerializedHeader)), m_runtimeSizeLimit(0), m_fileSizeLimit(0),
+      m_fileSession(1), m_useClock(1), m_activeUses(0), m_codec(CompressionCodec::None), m_getValueFunc(nullptr),
+      m_storeValueFunc(nullptr) {
   memset(m_fileFullPath, 0, MaxFilePathLen);
   memset(&m_gfxIp, 0, sizeof(m_gfxIp));
 }
@@ -122,21 +76,28 @@ ShaderCache::~ShaderCache() {
 // =====================================================================================================================
 // Destruction, does clean-up work.
 void ShaderCache::Destroy() {
-  if (m_onDiskFile.isOpen())
+  if (m_onDiskFile.isOpen()) {
+    addDirectoryToFile();
     m_onDiskFile.close();
+  }
   resetRuntimeCache();
 }
 
 // =====================================================================================================================
 // Resets the runtime shader cache to an empty state. Releases all allocator memory and decommits it back to the OS.
+//
+// NOTE: This function assumes that no other thread is accessing the shader cache.
 void ShaderCache::resetRuntimeCache() {
-  for (auto indexMap : m_shaderIndexMap)
-    delete indexMap.second;
-  m_shaderIndexMap.clear();
+  for (unsigned i = 0; i < ShaderIndexMapStripeCount; ++i)
+    m_shaderIndexMap.getStripeByIndex(i).map.clear();
+  m_indexAllocator.DestroyAll();
+  m_freeIndices.clear();
 
-  for (auto allocIt : m_allocationList)
-    delete[] allocIt.first;
-  m_allocationList.clear();
+  m_fileDirectory.clear();
+  m_mappedDirectory = {};
+  m_mappedFile.reset();
+
+  m_cacheSpace.clear();
 
   m_totalShaders = 0;
   m_shaderDataEnd = sizeof(ShaderCacheSerializedHeader);
@@ -144,7 +105,9 @@ void ShaderCache::resetRuntimeCache() {
 }
 
 // =====================================================================================================================
-// Copies the shader cache data to the memory blob provided by the calling function.
+// Copies the shader cache data to the memory blob provided by the calling function. Only the data of the shaders in
+// the index map is copied, so that data replaced by promoteShader or Merge is left out and the shader count in the
+// header matches the data.
 //
 // NOTE: It is expected that the calling function has not used this shader cache since querying the size
 //
@@ -154,47 +117,52 @@ void ShaderCache::resetRuntimeCache() {
 Result ShaderCache::Serialize(void *blob, size_t *size) {
   Result result = Result::Success;
 
+  for (unsigned i = 0; i < ShaderIndexMapStripeCount; ++i)
+    m_shaderIndexMap.getStripeByIndex(i).lock(true);
+
+  // Shaders in the mapped file are not in cache space, so they are not serialized.
+  const char *mappedBegin = m_mappedFile ? m_mappedFile->const_data() : nullptr;
+  const char *mappedEnd = m_mappedFile ? mappedBegin + m_mappedFile->size() : nullptr;
+  std::vector<const ShaderHeader *> shaders;
+  size_t serializedSize = sizeof(ShaderCacheSerializedHeader);
+  for (unsigned i = 0; i < ShaderIndexMapStripeCount; ++i) {
+    for (auto it : m_shaderIndexMap.getStripeByIndex(i).map) {
+      const char *data = static_cast<const char *>(it.second->dataBlob);
+      if (it.second->state == ShaderEntryState::Ready && !(data >= mappedBegin && data < mappedEnd)) {
+        shaders.push_back(static_cast<const ShaderHeader *>(it.second->dataBlob));
+        serializedSize += it.second->header.size;
+      }
+    }
+  }
+
   if (*size == 0) {
     // Query shader cache serailzied size
-    (*size) = m_serializedSize;
-  } else {
-    // Do serialize
-    assert(m_shaderDataEnd == m_serializedSize || m_shaderDataEnd == sizeof(ShaderCacheSerializedHeader));
-
-    if (m_serializedSize >= sizeof(ShaderCacheSerializedHeader)) {
-      if (blob && (*size) >= m_serializedSize) {
-        // First construct the header and copy it into the memory provided
-        ShaderCacheSerializedHeader header = {};
-        header.headerSize = sizeof(ShaderCacheSerializedHeader);
-        header.shaderCount = m_totalShaders;
-        header.shaderDataEnd = m_shaderDataEnd;
-        getBuildTime(&header.buildId);
-
-        memcpy(blob, &header, sizeof(ShaderCacheSerializedHeader));
-
-        void *dataDst = voidPtrInc(blob, sizeof(ShaderCacheSerializedHeader));
-
-        // Then iterate through all allocators (which hold the backing memory for the shader data)
-        // and copy their contents to the blob.
-        for (auto it : m_allocationList) {
-          assert(it.first);
-
-          const size_t copySize = it.second;
-          if (voidPtrDiff(dataDst, blob) + copySize > (*size)) {
-            result = Result::ErrorUnknown;
-            break;
-          }
-
-          memcpy(dataDst, it.first, copySize);
-          dataDst = voidPtrInc(dataDst, copySize);
-        }
-      } else {
-        llvm_unreachable("Should never be called!");
-        result = Result::ErrorUnknown;
-      }
+    (*size) = serializedSize;
+  } else if (blob && (*size) >= serializedSize) {
+    // First construct the header and copy it into the memory provided
+    ShaderCacheSerializedHeader header = {};
+    header.headerSize = sizeof(ShaderCacheSerializedHeader);
+    header.version = ShaderCacheFormatVersion;
+    header.shaderCount = shaders.size();
+    header.shaderDataEnd = serializedSize;
+    getBuildTime(&header.buildId);
+
+    memcpy(blob, &header, sizeof(ShaderCacheSerializedHeader));
+
+    // Then copy the data of each shader, which starts with its header.
+    void *dataDst = voidPtrInc(blob, sizeof(ShaderCacheSerializedHeader));
+    for (const ShaderHeader *shader : shaders) {
+      memcpy(dataDst, shader, shader->size);
+      dataDst = voidPtrInc(dataDst, shader->size);
     }
+  } else {
+    llvm_unreachable("Should never be called!");
+    result = Result::ErrorUnknown;
   }
 
+  for (unsigned i = 0; i < ShaderIndexMapStripeCount; ++i)
+    m_shaderIndexMap.getStripeByIndex(i).unlock(true);
+
   return result;
 }
 
@@ -209,35 +177,61 @@ Result ShaderCache::Merge(unsigned srcCacheCount, const IShaderCache **ppSrcCach
 
   Result result = Result::Success;
 
-  lockCacheMap(false);
-
   for (unsigned i = 0; i < srcCacheCount; i++) {
     ShaderCache *srcCache = static_cast<ShaderCache *>(const_cast<IShaderCache *>(ppSrcCaches[i]));
-    srcCache->lockCacheMap(true);
 
-    for (auto it : srcCache->m_shaderIndexMap) {
-      uint64_t key = it.first;
+    for (unsigned stripeIdx = 0; stripeIdx < ShaderIndexMapStripeCount; ++stripeIdx) {
+      // Collect the ready entries of the source stripe first, so that we never hold a lock of the source cache while
+      // taking one of this cache. An entry's header and data are taken together, as promoteShader may replace them;
+      // data blobs themselves are immutable until the source cache is reset.
+      SmallVector<std::pair<ShaderHeader, const void *>, 16> srcShaders;
+      {
+        ShaderIndexMapStripe &srcStripe = srcCache->m_shaderIndexMap.getStripeByIndex(stripeIdx);
+        sys::ScopedReader srcLock(srcStripe.mutex);
+        for (auto it : srcStripe.map) {
+          if (it.second->state == ShaderEntryState::Ready)
+            srcShaders.push_back({it.second->header, it.second->dataBlob});
+        }
+      }
+
+      ShaderIndexMapStripe &stripe = m_shaderIndexMap.getStripeByIndex(stripeIdx);
+      sys::ScopedWriter lock(stripe.mutex);
+      for (const auto &srcShader : srcShaders) {
+        const ShaderHeader &srcHeader = srcShader.first;
+        uint64_t key = srcHeader.key;
 
-      auto indexMap = m_shaderIndexMap.find(key);
-      if (indexMap == m_shaderIndexMap.end()) {
+        // A shader that is already here is only replaced by a copy of a higher quality.
         ShaderIndex *index = nullptr;
-        void *mem = getCacheSpace(it.second->header.size);
-        memcpy(mem, it.second->dataBlob, it.second->header.size);
+        bool isNew = false;
+        auto indexMap = stripe.map.find(key);
+        if (indexMap == stripe.map.end()) {
+          index = createShaderIndex();
+          stripe.map[key] = index;
+          isNew = true;
+        } else if (indexMap->second->state == ShaderEntryState::Ready &&
+                   indexMap->second->header.quality < srcHeader.quality) {
+          index = indexMap->second;
+        }
 
-        index = new ShaderIndex;
-        index->dataBlob = mem;
-        index->state = ShaderEntryState::Ready;
-        index->header = it.second->header;
+        if (index) {
+          void *mem = getCacheSpace(srcHeader.size);
+          memcpy(mem, srcShader.second, srcHeader.size);
+
+          index->dataBlob = mem;
+          index->state = ShaderEntryState::Ready;
+          index->header = srcHeader;
+          index->checksumVerified = true;
+          markUsed(index);
 
-        m_shaderIndexMap[key] = index;
-        m_totalShaders++;
+          if (isNew) {
+            std::lock_guard<sys::Mutex> allocLock(m_lock);
+            m_totalShaders++;
+          }
+        }
       }
     }
-    srcCache->unlockCacheMap(true);
   }
 
-  unlockCacheMap(false);
-
   return result;
 }
 
@@ -252,18 +246,38 @@ Result ShaderCache::init(const ShaderCacheCreateInfo *createInfo, const ShaderCa
   if (auxCreateInfo->shaderCacheMode != ShaderCacheDisable) {
     m_disableCache = false;
     m_clientData = createInfo->pClientData;
-    m_getValueFunc = createInfo->pfnGetValueFunc;
-    m_storeValueFunc = createInfo->pfnStoreValueFunc;
+    // The external cache is only used if both functions are given.
+    if (createInfo->pfnGetValueFunc && createInfo->pfnStoreValueFunc) {
+      m_getValueFunc = createInfo->pfnGetValueFunc;
+      m_storeValueFunc = createInfo->pfnStoreValueFunc;
+    }
     m_gfxIp = auxCreateInfo->gfxIp;
     m_hash = auxCreateInfo->hash;
+    m_runtimeSizeLimit = auxCreateInfo->runtimeSizeLimit;
+    m_codec = auxCreateInfo->codec;
+    // The file can only be compacted if it is written.
+    if (auxCreateInfo->shaderCacheMode == ShaderCacheEnableOnDisk ||
+        auxCreateInfo->shaderCacheMode == ShaderCacheForceInternalCacheOnDisk)
+      m_fileSizeLimit = auxCreateInfo->fileSizeLimit;
 
-    lockCacheMap(false);
+    // No other thread can use the cache during initialization, so the index map stripes need not be locked here.
+    std::lock_guard<sys::Mutex> lock(m_lock);
 
     // If we're in runtime mode and the caller provided a data blob, try to load the from that blob.
     if (auxCreateInfo->shaderCacheMode == ShaderCacheEnableRuntime && createInfo->initialDataSize > 0) {
       if (loadCacheFromBlob(createInfo->pInitialData, createInfo->initialDataSize) != Result::Success)
         resetRuntimeCache();
     }
+    // If we're in mapped mode try to map the cache file. The file is never written in this mode, so new shaders are
+    // only kept in memory.
+    else if (auxCreateInfo->shaderCacheMode == ShaderCacheEnableOnDiskMapped) {
+      bool cacheFileExists = false;
+      result = buildFileName(auxCreateInfo->executableName, auxCreateInfo->cacheFilePath, auxCreateInfo->gfxIp,
+                             &cacheFileExists);
+
+      if (result == Result::Success && cacheFileExists && loadCacheFromMapping() != Result::Success)
+        resetRuntimeCache();
+    }
     // If we're in on-disk mode try to load the cache from file.
     else if (auxCreateInfo->shaderCacheMode == ShaderCacheEnableOnDisk ||
              auxCreateInfo->shaderCacheMode == ShaderCacheForceInternalCacheOnDisk ||
@@ -293,7 +307,9 @@ Result ShaderCache::init(const ShaderCacheCreateInfo *createInfo, const ShaderCa
       if (result == Result::Success) {
         if (cacheFileExists) {
           loadResult = loadCacheFromFile();
-          if (auxCreateInfo->shaderCacheMode == ShaderCacheEnableOnDiskReadOnly && loadResult == Result::Success)
+          // The file is never written in read-only mode, so close it whether or not it loaded. Otherwise Destroy
+          // and insertShader would add the directory and new shaders to it.
+          if (auxCreateInfo->shaderCacheMode == ShaderCacheEnableOnDiskReadOnly)
             m_onDiskFile.close();
         } else
           resetCacheFile();
@@ -304,8 +320,6 @@ Result ShaderCache::init(const ShaderCacheCreateInfo *createInfo, const ShaderCa
       if (loadResult != Result::Success)
         resetRuntimeCache();
     }
-
-    unlockCacheMap(false);
   } else
     m_disableCache = true;
 
@@ -358,11 +372,14 @@ void ShaderCache::resetCacheFile() {
 
   ShaderCacheSerializedHeader header = {};
   header.headerSize = sizeof(ShaderCacheSerializedHeader);
+  header.version = ShaderCacheFormatVersion;
   header.shaderCount = 0;
   header.shaderDataEnd = header.headerSize;
+  header.session = m_fileSession;
   getBuildTime(&header.buildId);
 
   m_onDiskFile.write(&header, header.headerSize);
+  m_fileDirectory.clear();
 }
 
 // =====================================================================================================================
@@ -389,36 +406,54 @@ ShaderEntryState ShaderCache::findShader(MetroHash::Hash hash, bool allocateOnMi
   Result mapResult = Result::Success;
   assert(phEntry);
 
-  bool readOnlyLock = (!allocateOnMiss);
-  lockCacheMap(readOnlyLock);
   uint64_t hashKey = MetroHash::compact64(&hash);
-  auto indexMap = m_shaderIndexMap.find(hashKey);
-  if (indexMap != m_shaderIndexMap.end()) {
+  ShaderIndexMapStripe &stripe = m_shaderIndexMap.getStripe(hashKey);
+
+  // Fast path: a hit on a ready entry, or a miss that must not allocate and cannot be served from the mapped file, only
+  // needs the shared lock of the stripe that holds the key.
+  bool readOnlyLock = true;
+  stripe.lock(readOnlyLock);
+  auto indexMap = stripe.map.find(hashKey);
+  if (indexMap != stripe.map.end() && indexMap->second->state == ShaderEntryState::Ready) {
+    markUsed(indexMap->second);
+    *phEntry = indexMap->second;
+    stripe.unlock(readOnlyLock);
+    return ShaderEntryState::Ready;
+  }
+  if (indexMap == stripe.map.end() && !allocateOnMiss && m_mappedDirectory.empty()) {
+    stripe.unlock(readOnlyLock);
+    return ShaderEntryState::Unavailable;
+  }
+  stripe.unlock(readOnlyLock);
+
+  // Slow path: the entry has to be created, or its state may change, so take the stripe lock for writing. The map is
+  // searched again, as another thread may have added the key in between.
+  readOnlyLock = false;
+  stripe.lock(readOnlyLock);
+  indexMap = stripe.map.find(hashKey);
+  if (indexMap != stripe.map.end()) {
     existed = true;
     index = indexMap->second;
+  } else if ((index = createMappedIndex(hashKey))) {
+    existed = true;
+    stripe.map[hashKey] = index;
   } else if (allocateOnMiss) {
-    index = new ShaderIndex;
-    m_shaderIndexMap[hashKey] = index;
+    index = createShaderIndex();
+    stripe.map[hashKey] = index;
   }
 
   if (!index)
     mapResult = Result::ErrorUnavailable;
 
   if (mapResult == Result::Success) {
-    if (existed) {
-      // We don't need to hold on to the write lock if we're not the one doing the compile
-      if (!readOnlyLock) {
-        unlockCacheMap(readOnlyLock);
-        readOnlyLock = true;
-        lockCacheMap(readOnlyLock);
-      }
-    } else {
+    if (!existed) {
       bool needsInit = true;
 
       // We didn't find the entry in our own hash map, now search the external cache if available
-      if (useExternalCache()) {
+      ShaderCacheGetValue getValueFunc = m_getValueFunc.load(std::memory_order_relaxed);
+      if (getValueFunc) {
         // The first call to the external cache queries the existence and the size of the cached shader.
-        Result extResult = m_getValueFunc(m_clientData, hashKey, nullptr, &index->header.size);
+        Result extResult = getValueFunc(m_clientData, hashKey, nullptr, &index->header.size);
         if (extResult == Result::Success) {
           // An entry was found matching our hash, we should allocate memory to hold the data and call again
           assert(index->header.size > 0);
@@ -427,7 +462,7 @@ ShaderEntryState ShaderCache::findShader(MetroHash::Hash hash, bool allocateOnMi
           if (!index->dataBlob)
             extResult = Result::ErrorOutOfMemory;
           else {
-            extResult = m_getValueFunc(m_clientData, hashKey, index->dataBlob, &index->header.size);
+            extResult = getValueFunc(m_clientData, hashKey, index->dataBlob, &index->header.size);
           }
         }
 
@@ -444,8 +479,7 @@ ShaderEntryState ShaderCache::findShader(MetroHash::Hash hash, bool allocateOnMi
         } else if (extResult == Result::ErrorUnavailable) {
           // This means the external cache is unavailable and we shouldn't bother using it anymore. To
           // prevent useless calls we'll zero out the function pointers.
-          m_getValueFunc = nullptr;
-          m_storeValueFunc = nullptr;
+          disableExternalCache();
         } else {
           // extResult should never be ErrorInvalidMemorySize since Cache space is always allocated based
           // on 1st m_pfnGetValueFunc call.
@@ -457,23 +491,20 @@ ShaderEntryState ShaderCache::findShader(MetroHash::Hash hash, bool allocateOnMi
 
       if (needsInit) {
         // This is a brand new cache entry so we need to initialize the ShaderIndex.
-        memset(index, 0, sizeof(*index));
+        index->header = {};
+        index->dataBlob = nullptr;
         index->header.key = hashKey;
         index->state = ShaderEntryState::New;
       }
     } // End if (existed == false)
 
     if (index->state == ShaderEntryState::Compiling) {
-      // The shader is being compiled by another thread, we should release the lock and wait for it to complete
-      while (index->state == ShaderEntryState::Compiling) {
-        unlockCacheMap(readOnlyLock);
-        {
-          std::unique_lock<std::mutex> lock(m_conditionMutex);
-
-          m_conditionVariable.wait_for(lock, std::chrono::seconds(1));
-        }
-        lockCacheMap(readOnlyLock);
-      }
+      // The shader is being compiled by another thread, we should release the lock and wait for it to complete.
+      // Waiting on the entry releases the stripe lock, and the compiling thread changes the state with that lock held
+      // before signaling the entry, so the wakeup cannot be missed and other entries' waiters are not woken.
+      assert(!readOnlyLock);
+      while (index->state == ShaderEntryState::Compiling)
+        index->compileDone.wait(stripe.mutex);
       // At this point the shader entry is either Ready, New or something failed. We've already
       // initialized our result code to an error code above, the Ready and New cases are handled below so
       // nothing else to do here.
@@ -489,89 +520,203 @@ ShaderEntryState ShaderCache::findShader(MetroHash::Hash hash, bool allocateOnMi
     }
 
     // Return the ShaderIndex as a handle so subsequent calls into the cache can avoid the hash map lookup.
+    markUsed(index);
     (*phEntry) = index;
     result = index->state;
   }
 
-  unlockCacheMap(readOnlyLock);
+  stripe.unlock(readOnlyLock);
 
   return result;
 }
 
+// =====================================================================================================================
+// Compresses a shader if that pays off, and stores it with its header in new cache space. Returns the stored header,
+// which is followed by the shader data, or nullptr if the cache space could not be allocated.
+//
+// @param key : Compacted hash key of the shader
+// @param blob : Shader data
+// @param shaderSize : Size of shader data in bytes
+// @param quality : Quality of the shader data
+ShaderHeader *ShaderCache::storeShaderData(uint64_t key, const void *blob, size_t shaderSize, ShaderQuality quality) {
+  // The compressed form is only kept if it saves at least an eighth.
+  const void *storedData = blob;
+  size_t storedSize = shaderSize;
+  CompressionCodec codec = CompressionCodec::None;
+  std::unique_ptr<uint8_t[]> compressedData;
+  if (m_codec == CompressionCodec::Lz4 && shaderSize >= MinCompressedShaderSize) {
+    const size_t capacity = shaderSize - shaderSize / 8;
+    compressedData.reset(new uint8_t[capacity]);
+    const size_t compressedSize = lz4Compress(blob, shaderSize, compressedData.get(), capacity);
+    if (compressedSize != 0) {
+      storedData = compressedData.get();
+      storedSize = compressedSize;
+      codec = CompressionCodec::Lz4;
+    }
+  }
+
+  // Allocate space to store the serialized shader and a copy of the header. The header is duplicated in the data to
+  // simplify serialize/load.
+  auto *const header = static_cast<ShaderHeader *>(getCacheSpace(storedSize + sizeof(ShaderHeader)));
+  if (!header)
+    return nullptr;
+
+  // Serialize the shader into an opaque blob of data, and compute a checksum for it (useful for detecting data
+  // corruption).
+  void *const dataBlob = (header + 1);
+  memcpy(dataBlob, storedData, storedSize);
+  header->key = key;
+  header->checksum = calculateChecksum(static_cast<uint8_t *>(dataBlob), storedSize);
+  header->size = storedSize + sizeof(ShaderHeader);
+  header->uncompressedSize = shaderSize;
+  header->codec = codec;
+  header->quality = quality;
+  return header;
+}
+
 // =====================================================================================================================
 // Inserts a new shader into the cache. The new shader is written to the cache file if it is in-use, and will also
-// upload it to the client's external cache if it is in-use.
+// upload it to the client's external cache if it is in-use, unless it is of a reduced quality.
 //
 // @param hEntry : Handle of shader cache entry
 // @param blob : Shader data
 // @param shaderSize : size of shader data in bytes
-void ShaderCache::insertShader(CacheEntryHandle hEntry, const void *blob, size_t shaderSize) {
+// @param quality : Quality of the shader data
+void ShaderCache::insertShader(CacheEntryHandle hEntry, const void *blob, size_t shaderSize, ShaderQuality quality) {
   auto *const index = static_cast<ShaderIndex *>(hEntry);
   assert(m_disableCache == false);
   assert(index && index->state == ShaderEntryState::Compiling);
 
-  lockCacheMap(false);
-
-  Result result = Result::Success;
-
-  if (result == Result::Success) {
-    // Allocate space to store the serialized shader and a copy of the header. The header is duplicated in the
-    // data to simplify serialize/load.
-    index->header.size = (shaderSize + sizeof(ShaderHeader));
-    index->dataBlob = getCacheSpace(index->header.size);
-
-    if (!index->dataBlob)
-      result = Result::ErrorOutOfMemory;
-    else {
-      ++m_totalShaders;
-
-      auto *const header = static_cast<ShaderHeader *>(index->dataBlob);
-      void *const dataBlob = (header + 1);
-
-      // Serialize the shader into an opaque blob of data.
-      memcpy(dataBlob, blob, shaderSize);
-
-      // Compute a CRC for the serialized data (useful for detecting data corruption), and copy the index's
-      // header into the data's header.
-      index->header.crc = calculateCrc(static_cast<uint8_t *>(dataBlob), shaderSize);
-      (*header) = index->header;
-
-      if (useExternalCache()) {
-        // If we're making use of the external shader cache then we need to store the compiled shader data here.
-        Result externalResult = m_storeValueFunc(m_clientData, index->header.key, index->dataBlob, index->header.size);
-        if (externalResult == Result::ErrorUnavailable) {
-          // This is the only return code we can do anything about. In this case it means the external cache
-          // is not available and we should zero out the function pointers to avoid making useless calls on
-          // subsequent shader compiles.
-          m_getValueFunc = nullptr;
-          m_storeValueFunc = nullptr;
-        } else {
-          // Otherwise the store either succeeded (yay!) or failed in some other transient way. Either way,
-          // we will just continue, there's nothing to be done.
-        }
+  ShaderEntryState newState = ShaderEntryState::Ready;
+
+  // The entry is owned by this thread while it is compiling, so only the cache space, the external cache and the file
+  // need to be guarded here. Its state is published below under the lock of its stripe.
+  ShaderHeader *header = storeShaderData(index->header.key, blob, shaderSize, quality);
+  std::unique_lock<sys::Mutex> allocLock(m_lock);
+
+  if (header) {
+    ++m_totalShaders;
+    index->header = (*header);
+    index->dataBlob = header;
+    index->lastUse.store(++m_useClock, std::memory_order_relaxed);
+
+    // A shader of a reduced quality is only kept in memory until promoteShader replaces it, so that it never outlives
+    // this cache.
+    ShaderCacheStoreValue storeValueFunc = m_storeValueFunc.load(std::memory_order_relaxed);
+    if (quality == ShaderQuality::Full && storeValueFunc) {
+      // If we're making use of the external shader cache then we need to store the compiled shader data here.
+      Result externalResult = storeValueFunc(m_clientData, index->header.key, index->dataBlob, index->header.size);
+      if (externalResult == Result::ErrorUnavailable) {
+        // This is the only return code we can do anything about. In this case it means the external cache
+        // is not available and we should zero out the function pointers to avoid making useless calls on
+        // subsequent shader compiles.
+        disableExternalCache();
+      } else {
+        // Otherwise the store either succeeded (yay!) or failed in some other transient way. Either way,
+        // we will just continue, there's nothing to be done.
       }
-
-      // Mark this entry as ready, we'll wake the waiting threads once we release the lock
-      index->state = ShaderEntryState::Ready;
-
-      // Finally, update the file if necessary.
-      if (m_onDiskFile.isOpen())
-        addShaderToFile(index);
     }
-  }
 
-  if (result != Result::Success) {
+    // Finally, update the file if necessary. Once the file has reached its size limit, new shaders are only kept in
+    // memory until the file is compacted when it is next opened.
+    if (quality == ShaderQuality::Full && m_onDiskFile.isOpen() &&
+        (m_fileSizeLimit == 0 ||
+         m_shaderDataEnd - sizeof(ShaderCacheSerializedHeader) + index->header.size <= m_fileSizeLimit))
+      addShaderToFile(header);
+  } else {
     // Something failed while attempting to add the shader, most likely memory allocation. There's not much we
     // can do here except give up on adding data. This means we need to set the entry back to New so if another
     // thread is waiting it will be allowed to continue (it will likely just get to this same point, but at least
     // we won't hang or crash).
-    index->state = ShaderEntryState::New;
+    newState = ShaderEntryState::New;
     index->header.size = 0;
     index->dataBlob = nullptr;
   }
 
-  unlockCacheMap(false);
-  m_conditionVariable.notify_all();
+  allocLock.unlock();
+
+  // Mark this entry as ready (or new on failure), then wake the waiting threads once we release the lock
+  ShaderIndexMapStripe &stripe = m_shaderIndexMap.getStripe(index->header.key);
+  stripe.lock(false);
+  index->state = newState;
+  stripe.unlock(false);
+  index->compileDone.notify_all();
+}
+
+// =====================================================================================================================
+// Replaces the data of a ready shader with data of a higher quality, such as the fully optimized version of a shader
+// that was first compiled quickly. The new data is published atomically: a thread retrieving the shader gets either
+// the old data or the new data, and the old data stays valid while the cache is in use. The new data is also written
+// to the cache file and the client's external cache if they are in use. Returns false if the shader is not ready in
+// the cache, or its data is already of the same or a higher quality.
+//
+// @param hash : Hash code of shader
+// @param blob : Shader data
+// @param shaderSize : size of shader data in bytes
+// @param quality : Quality of the shader data
+bool ShaderCache::promoteShader(MetroHash::Hash hash, const void *blob, size_t shaderSize, ShaderQuality quality) {
+  if (m_disableCache)
+    return false;
+
+  // The stripe stays locked for writing while the new data is stored, so that no other thread promotes the shader in
+  // between and no data is stored that is not used. The shader count is unchanged, as the shader replaces itself.
+  uint64_t hashKey = MetroHash::compact64(&hash);
+  ShaderIndexMapStripe &stripe = m_shaderIndexMap.getStripe(hashKey);
+  stripe.lock(false);
+  auto indexMap = stripe.map.find(hashKey);
+  ShaderIndex *index = nullptr;
+  ShaderHeader *header = nullptr;
+  if (indexMap != stripe.map.end() && indexMap->second->state == ShaderEntryState::Ready &&
+      indexMap->second->header.quality < quality)
+    header = storeShaderData(hashKey, blob, shaderSize, quality);
+  if (header) {
+    index = indexMap->second;
+    index->header = (*header);
+    index->dataBlob = header;
+    index->checksumVerified = true;
+    markUsed(index);
+  }
+  stripe.unlock(false);
+  if (!index)
+    return false;
+
+  std::lock_guard<sys::Mutex> allocLock(m_lock);
+  ShaderCacheStoreValue storeValueFunc = m_storeValueFunc.load(std::memory_order_relaxed);
+  if (storeValueFunc && storeValueFunc(m_clientData, hashKey, header, header->size) == Result::ErrorUnavailable)
+    disableExternalCache();
+  if (m_onDiskFile.isOpen() &&
+      (m_fileSizeLimit == 0 ||
+       m_shaderDataEnd - sizeof(ShaderCacheSerializedHeader) + header->size <= m_fileSizeLimit))
+    addShaderToFile(header);
+  return true;
+}
+
+// =====================================================================================================================
+// Turns a ready shader of the specified quality back into a new entry, so that the next lookup compiles it again. This
+// is used when the fully optimized version of a shader that was first compiled quickly fails to build, so that it is
+// not left at the reduced quality for good. The discarded data stays valid while the cache is in use.
+//
+// @param hash : Hash code of shader
+// @param quality : Quality of the shader data to discard
+void ShaderCache::discardShader(MetroHash::Hash hash, ShaderQuality quality) {
+  if (m_disableCache)
+    return;
+
+  uint64_t hashKey = MetroHash::compact64(&hash);
+  ShaderIndexMapStripe &stripe = m_shaderIndexMap.getStripe(hashKey);
+  sys::ScopedWriter lock(stripe.mutex);
+  auto indexMap = stripe.map.find(hashKey);
+  if (indexMap == stripe.map.end() || indexMap->second->state != ShaderEntryState::Ready ||
+      indexMap->second->header.quality != quality)
+    return;
+
+  ShaderIndex *index = indexMap->second;
+  index->state = ShaderEntryState::New;
+  index->header.size = 0;
+  index->dataBlob = nullptr;
+
+  std::lock_guard<sys::Mutex> allocLock(m_lock);
+  --m_totalShaders;
 }
 
 // =====================================================================================================================
@@ -582,42 +727,90 @@ void ShaderCache::resetShader(CacheEntryHandle hEntry) {
   auto *const index = static_cast<ShaderIndex *>(hEntry);
   assert(m_disableCache == false);
   assert(index && index->state == ShaderEntryState::Compiling);
-  lockCacheMap(false);
+  ShaderIndexMapStripe &stripe = m_shaderIndexMap.getStripe(index->header.key);
+  stripe.lock(false);
   index->state = ShaderEntryState::New;
   index->header.size = 0;
   index->dataBlob = nullptr;
-  unlockCacheMap(false);
-  m_conditionVariable.notify_all();
+  stripe.unlock(false);
+  index->compileDone.notify_all();
 }
 
 // =====================================================================================================================
-// Retrieves the shader from the cache which is identified by the specified entry handle.
+// Retrieves the shader from the cache which is identified by the specified entry handle. A compressed shader is
+// decompressed into the caller's buffer, otherwise the returned data points into the cache.
 //
 // @param hEntry : Handle of shader cache entry
 // @param [out] ppBlob : Shader data
 // @param [out] size : size of shader data in bytes
-Result ShaderCache::retrieveShader(CacheEntryHandle hEntry, const void **ppBlob, size_t *size) {
-  const auto *const index = static_cast<ShaderIndex *>(hEntry);
+// @param [out] buffer : Buffer to decompress the shader data into, which the caller keeps as long as it uses the data
+Result ShaderCache::retrieveShader(CacheEntryHandle hEntry, const void **ppBlob, size_t *size,
+                                   SmallVectorImpl<char> *buffer) {
+  auto *const index = static_cast<ShaderIndex *>(hEntry);
 
   assert(m_disableCache == false);
   assert(index);
-  assert(index->header.size >= sizeof(ShaderHeader));
-
-  lockCacheMap(true);
 
-  *ppBlob = voidPtrInc(index->dataBlob, sizeof(ShaderHeader));
-  *size = index->header.size - sizeof(ShaderHeader);
+  ShaderIndexMapStripe &stripe = m_shaderIndexMap.getStripe(index->header.key);
+  bool readOnlyLock = true;
+  stripe.lock(readOnlyLock);
+
+  if (!index->checksumVerified) {
+    // This is the first retrieval of an entry from the mapped file. Verify its checksum with the write lock held, so
+    // that it is only done once.
+    stripe.unlock(readOnlyLock);
+    readOnlyLock = false;
+    stripe.lock(readOnlyLock);
+
+    if (!index->checksumVerified) {
+      const uint64_t checksum =
+          calculateChecksum(static_cast<const uint8_t *>(voidPtrInc(index->dataBlob, sizeof(ShaderHeader))),
+                            index->header.size - sizeof(ShaderHeader));
+      if (checksum != index->header.checksum) {
+        // The data is corrupted, so turn this into a new entry. The next lookup will then compile the shader again.
+        index->state = ShaderEntryState::New;
+        index->header.size = 0;
+        index->dataBlob = nullptr;
+      }
+      index->checksumVerified = true;
+    }
+  }
 
-  unlockCacheMap(true);
+  Result result = Result::ErrorUnknown;
+  const bool ready = index->state == ShaderEntryState::Ready;
+  const ShaderHeader header = index->header;
+  const void *const dataBlob = index->dataBlob;
+  stripe.unlock(readOnlyLock);
+
+  // The entry's data may be replaced by promoteShader, so its header and data pointer are read together above. The data
+  // itself stays valid while the cache is in use, so it can be read without the stripe lock.
+  if (ready) {
+    assert(header.size >= sizeof(ShaderHeader));
+    const void *storedData = voidPtrInc(dataBlob, sizeof(ShaderHeader));
+    const size_t storedSize = header.size - sizeof(ShaderHeader);
+    if (header.codec == CompressionCodec::None) {
+      *ppBlob = storedData;
+      *size = storedSize;
+      if (*size > 0)
+        result = Result::Success;
+    } else if (header.codec == CompressionCodec::Lz4) {
+      buffer->resize(header.uncompressedSize);
+      if (lz4Decompress(storedData, storedSize, buffer->data(), buffer->size())) {
+        *ppBlob = buffer->data();
+        *size = buffer->size();
+        result = Result::Success;
+      }
+    }
+  }
 
-  return *size > 0 ? Result::Success : Result::ErrorUnknown;
+  return result;
 }
 
 // =====================================================================================================================
 // Adds data for a new shader to the on-disk file
 //
-// @param index : A new shader
-void ShaderCache::addShaderToFile(const ShaderIndex *index) {
+// @param data : Header of the new shader's data in cache space, followed by the data
+void ShaderCache::addShaderToFile(const ShaderHeader *data) {
   assert(m_onDiskFile.isOpen());
 
   // We only need to update the parts of the file that changed, which is the number of shaders, the new data section,
@@ -627,27 +820,76 @@ void ShaderCache::addShaderToFile(const ShaderIndex *index) {
   const unsigned shaderCountOffset = offsetof(struct ShaderCacheSerializedHeader, shaderCount);
   const unsigned dataEndOffset = offsetof(struct ShaderCacheSerializedHeader, shaderDataEnd);
 
+  const unsigned directoryOffset = offsetof(struct ShaderCacheSerializedHeader, directoryOffset);
+
+  // The file holds the shaders in its directory. Shaders only kept in memory, such as those of a reduced quality or
+  // those added once the file has reached its size limit, are counted in m_totalShaders but not here.
+  const size_t shaderCount = m_fileDirectory.size() + 1;
   m_onDiskFile.seek(shaderCountOffset, true);
-  m_onDiskFile.write(&m_totalShaders, sizeof(size_t));
+  m_onDiskFile.write(&shaderCount, sizeof(size_t));
+
+  // The new shader data overwrites the directory, if there is one. It is written again when the file is closed.
+  const size_t noDirectory = 0;
+  m_onDiskFile.seek(directoryOffset, true);
+  m_onDiskFile.write(&noDirectory, sizeof(size_t));
 
   // Write the new shader data at the current end of the data section
   m_onDiskFile.seek(static_cast<unsigned>(m_shaderDataEnd), true);
-  m_onDiskFile.write(index->dataBlob, index->header.size);
+  m_onDiskFile.write(data, data->size);
+  m_fileDirectory.push_back({data->key, m_shaderDataEnd, data->size, m_fileSession});
 
   // Then update the data end value and write it out to the file.
-  m_shaderDataEnd += index->header.size;
+  m_shaderDataEnd += data->size;
   m_onDiskFile.seek(dataEndOffset, true);
   m_onDiskFile.write(&m_shaderDataEnd, sizeof(size_t));
 
   m_onDiskFile.flush();
 }
 
+// =====================================================================================================================
+// Writes the entry directory after the shader data of the on-disk file and records it in the file header, so that the
+// file can later be mapped without walking the shader data.
+void ShaderCache::addDirectoryToFile() {
+  assert(m_onDiskFile.isOpen());
+
+  // Record this session as the last use of the shaders that were used in it.
+  for (ShaderCacheDirectoryEntry &record : m_fileDirectory) {
+    const auto &map = m_shaderIndexMap.getStripe(record.key).map;
+    auto indexMap = map.find(record.key);
+    if (indexMap != map.end() && indexMap->second->lastUse.load(std::memory_order_relaxed) != 0)
+      record.lastUse = m_fileSession;
+  }
+
+  // Sort by key, keeping copies of a duplicated key in file order, which is the order createMappedIndex picks from.
+  std::sort(m_fileDirectory.begin(), m_fileDirectory.end(),
+            [](const ShaderCacheDirectoryEntry &lhs, const ShaderCacheDirectoryEntry &rhs) {
+              return lhs.key < rhs.key || (lhs.key == rhs.key && lhs.offset < rhs.offset);
+            });
+
+  size_t directory[3] = {alignTo(m_shaderDataEnd, alignof(ShaderCacheDirectoryEntry)), m_fileDirectory.size(),
+                         m_fileSession};
+
+  m_onDiskFile.seek(static_cast<unsigned>(directory[0]), true);
+  m_onDiskFile.write(m_fileDirectory.data(), m_fileDirectory.size() * sizeof(ShaderCacheDirectoryEntry));
+
+  // directoryOffset, directoryCount and session are adjacent in the header, so update them with one write.
+  static_assert(offsetof(struct ShaderCacheSerializedHeader, directoryCount) ==
+                        offsetof(struct ShaderCacheSerializedHeader, directoryOffset) + sizeof(size_t) &&
+                    offsetof(struct ShaderCacheSerializedHeader, session) ==
+                        offsetof(struct ShaderCacheSerializedHeader, directoryOffset) + 2 * sizeof(size_t),
+                "Unexpected header layout");
+  m_onDiskFile.seek(offsetof(struct ShaderCacheSerializedHeader, directoryOffset), true);
+  m_onDiskFile.write(directory, sizeof(directory));
+
+  m_onDiskFile.flush();
+}
+
 // =====================================================================================================================
 // Loads all shader data from the cache file into the local cache copy. Returns true if the file contents were loaded
 // successfully or false if invalid data was found.
 //
-// NOTE: This function assumes that a write lock has already been taken by the calling function and that the on-disk
-// file has been successfully opened and the file position is the beginning of the file.
+// NOTE: This function assumes that it is called during initialization, with the cache lock taken by the calling
+// function, and that the on-disk file has been successfully opened and the file position is the beginning of the file.
 Result ShaderCache::loadCacheFromFile() {
   assert(m_onDiskFile.isOpen());
 
@@ -657,9 +899,10 @@ Result ShaderCache::loadCacheFromFile() {
   m_onDiskFile.read(&header, sizeof(ShaderCacheSerializedHeader), nullptr);
 
   const size_t fileSize = File::getFileSize(m_fileFullPath);
-  const size_t dataSize = fileSize - sizeof(ShaderCacheSerializedHeader);
   Result result = validateAndLoadHeader(&header, fileSize);
 
+  // Only the shader data is loaded, not the directory or any unused space after it.
+  size_t dataSize = m_shaderDataEnd - sizeof(ShaderCacheSerializedHeader);
   void *dataMem = nullptr;
   if (result == Result::Success) {
     // The header is valid, so allocate space to fit all of the shader data.
@@ -680,6 +923,13 @@ Result ShaderCache::loadCacheFromFile() {
       result = Result::ErrorOutOfMemory;
   }
 
+  if (result == Result::Success)
+    result = buildFileDirectory(dataMem, dataSize, &header);
+
+  // If the file has outgrown its size limit, rewrite it with only the most recently used shaders.
+  if (result == Result::Success && m_fileSizeLimit != 0 && dataSize > m_fileSizeLimit)
+    dataSize = compactCacheFile(dataMem, dataSize);
+
   if (result == Result::Success) {
     // Now setup the shader index hash map.
     result = populateIndexMap(dataMem, dataSize);
@@ -693,11 +943,254 @@ Result ShaderCache::loadCacheFromFile() {
   return result;
 }
 
+// =====================================================================================================================
+// Builds the directory of the shaders loaded from the on-disk file, taking the last use of each shader from the
+// directory that was written when the file was last closed, if there is one.
+//
+// NOTE: This function assumes that it is called during initialization, with the cache lock taken by the calling
+// function.
+//
+// @param dataStart : Start pointer of the loaded shader data
+// @param dataSize : Shader data size in bytes
+// @param header : Header of the cache file
+Result ShaderCache::buildFileDirectory(const void *dataStart, size_t dataSize,
+                                       const ShaderCacheSerializedHeader *header) {
+  m_fileSession = header->session + 1;
+
+  size_t offset = 0;
+  for (size_t shader = 0; shader < m_totalShaders; ++shader) {
+    const auto *shaderHeader = static_cast<const ShaderHeader *>(voidPtrInc(dataStart, offset));
+    if (offset + sizeof(ShaderHeader) > dataSize || shaderHeader->size < sizeof(ShaderHeader) ||
+        offset + shaderHeader->size > dataSize)
+      return Result::ErrorUnknown;
+    m_fileDirectory.push_back(
+        {shaderHeader->key, sizeof(ShaderCacheSerializedHeader) + offset, shaderHeader->size, 0});
+    offset += shaderHeader->size;
+  }
+
+  if (header->directoryOffset < header->shaderDataEnd || header->directoryCount == 0)
+    return Result::Success;
+
+  // The previous directory is sorted by key, so sort a copy by offset to match it up with the shaders. A directory
+  // that cannot be read only loses the last use information.
+  std::vector<ShaderCacheDirectoryEntry> previousDirectory(header->directoryCount);
+  const size_t previousSize = previousDirectory.size() * sizeof(ShaderCacheDirectoryEntry);
+  size_t bytesRead = 0;
+  m_onDiskFile.seek(static_cast<unsigned>(header->directoryOffset), true);
+  if (m_onDiskFile.read(previousDirectory.data(), previousSize, &bytesRead) != Result::Success ||
+      bytesRead != previousSize)
+    return Result::Success;
+
+  auto byOffset = [](const ShaderCacheDirectoryEntry &lhs, const ShaderCacheDirectoryEntry &rhs) {
+    return lhs.offset < rhs.offset;
+  };
+  std::sort(previousDirectory.begin(), previousDirectory.end(), byOffset);
+  for (ShaderCacheDirectoryEntry &record : m_fileDirectory) {
+    auto it = std::lower_bound(previousDirectory.begin(), previousDirectory.end(), record, byOffset);
+    if (it != previousDirectory.end() && it->offset == record.offset && it->key == record.key)
+      record.lastUse = it->lastUse;
+  }
+
+  return Result::Success;
+}
+
+// =====================================================================================================================
+// Rewrites the on-disk file with the most recently used shaders that fit in three quarters of the file size limit,
+// leaving room for new shaders before the limit is reached again. Of the copies of a key, only the first one of the
+// highest quality is kept, as the others are never used. The kept shaders are moved to the front of the loaded data,
+// and its new size is returned.
+//
+// NOTE: This function assumes that it is called during initialization, with the cache lock taken by the calling
+// function, after buildFileDirectory has set up the directory of the loaded data.
+//
+// @param [in,out] dataStart : Start pointer of the loaded shader data, which is the only allocation in cache space
+// @param dataSize : Shader data size in bytes
+size_t ShaderCache::compactCacheFile(void *dataStart, size_t dataSize) {
+  const size_t sizeTarget = m_fileSizeLimit - m_fileSizeLimit / 4;
+
+  // Pick the shaders to keep, most recently used first. Of shaders last used in the same session, the ones added
+  // later are preferred.
+  std::vector<unsigned> order(m_fileDirectory.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](unsigned lhs, unsigned rhs) {
+    const ShaderCacheDirectoryEntry &lhsRecord = m_fileDirectory[lhs];
+    const ShaderCacheDirectoryEntry &rhsRecord = m_fileDirectory[rhs];
+    return lhsRecord.lastUse > rhsRecord.lastUse ||
+           (lhsRecord.lastUse == rhsRecord.lastUse && lhsRecord.offset > rhsRecord.offset);
+  });
+
+  auto getQuality = [dataStart](const ShaderCacheDirectoryEntry &record) {
+    return static_cast<const ShaderHeader *>(voidPtrInc(dataStart, record.offset - sizeof(ShaderCacheSerializedHeader)))
+        ->quality;
+  };
+  std::unordered_map<uint64_t, unsigned> bestCopies;
+  for (unsigned idx = 0; idx < m_fileDirectory.size(); ++idx) {
+    auto inserted = bestCopies.insert({m_fileDirectory[idx].key, idx});
+    if (!inserted.second && getQuality(m_fileDirectory[inserted.first->second]) < getQuality(m_fileDirectory[idx]))
+      inserted.first->second = idx;
+  }
+  std::vector<bool> keep(m_fileDirectory.size());
+  for (const auto &bestCopy : bestCopies)
+    keep[bestCopy.second] = true;
+
+  size_t keptSize = 0;
+  for (unsigned idx : order) {
+    if (!keep[idx])
+      continue;
+    if (keptSize + m_fileDirectory[idx].size <= sizeTarget)
+      keptSize += m_fileDirectory[idx].size;
+    else
+      keep[idx] = false;
+  }
+
+  // Move the kept shaders to the front of the data, in their original order.
+  std::vector<ShaderCacheDirectoryEntry> directory;
+  size_t newDataSize = 0;
+  for (unsigned idx = 0; idx < m_fileDirectory.size(); ++idx) {
+    if (!keep[idx])
+      continue;
+    ShaderCacheDirectoryEntry record = m_fileDirectory[idx];
+    memmove(voidPtrInc(dataStart, newDataSize),
+            voidPtrInc(dataStart, record.offset - sizeof(ShaderCacheSerializedHeader)), record.size);
+    record.offset = sizeof(ShaderCacheSerializedHeader) + newDataSize;
+    directory.push_back(record);
+    newDataSize += record.size;
+  }
+  assert(newDataSize == keptSize);
+
+  // Then write a new file holding just those.
+  resetCacheFile();
+  m_onDiskFile.write(dataStart, newDataSize);
+
+  m_totalShaders = directory.size();
+  m_shaderDataEnd = sizeof(ShaderCacheSerializedHeader) + newDataSize;
+  m_onDiskFile.seek(offsetof(struct ShaderCacheSerializedHeader, shaderCount), true);
+  m_onDiskFile.write(&m_totalShaders, sizeof(size_t));
+  m_onDiskFile.seek(offsetof(struct ShaderCacheSerializedHeader, shaderDataEnd), true);
+  m_onDiskFile.write(&m_shaderDataEnd, sizeof(size_t));
+  m_onDiskFile.flush();
+
+  m_fileDirectory = std::move(directory);
+
+  // Give back the cache space of the dropped shaders.
+  assert(m_cacheSpace.size() == 1 && m_cacheSpace.back().used == dataSize);
+  m_cacheSpace.back().used = newDataSize;
+  m_serializedSize -= dataSize - newDataSize;
+
+  LLVM_DEBUG(dbgs() << "Compacted shader cache file from " << dataSize << " to " << newDataSize << " bytes\n");
+  return newDataSize;
+}
+
+// =====================================================================================================================
+// Maps the cache file read-only and sets up the directory used to look up its shaders. No shader data is read here:
+// an entry is added to the index map by its first lookup, and its checksum is verified by its first retrieval.
+//
+// NOTE: This function assumes that it is called during initialization, with the cache lock taken by the calling
+// function.
+Result ShaderCache::loadCacheFromMapping() {
+  Expected<sys::fs::file_t> file = sys::fs::openNativeFileForRead(m_fileFullPath);
+  if (!file) {
+    consumeError(file.takeError());
+    return Result::ErrorUnavailable;
+  }
+
+  Result result = Result::Success;
+  const size_t fileSize = File::getFileSize(m_fileFullPath);
+  if (fileSize < sizeof(ShaderCacheSerializedHeader))
+    result = Result::ErrorUnknown;
+
+  if (result == Result::Success) {
+    std::error_code errCode;
+    m_mappedFile = std::make_unique<sys::fs::mapped_file_region>(*file, sys::fs::mapped_file_region::readonly,
+                                                                 fileSize, 0, errCode);
+    if (errCode) {
+      m_mappedFile.reset();
+      result = Result::ErrorUnknown;
+    }
+  }
+  sys::fs::closeFile(*file);
+
+  const char *fileData = m_mappedFile ? m_mappedFile->const_data() : nullptr;
+  const auto *header = reinterpret_cast<const ShaderCacheSerializedHeader *>(fileData);
+  if (result == Result::Success)
+    result = validateAndLoadHeader(header, fileSize);
+
+  if (result == Result::Success) {
+    const size_t directoryEnd = header->directoryOffset + header->directoryCount * sizeof(ShaderCacheDirectoryEntry);
+    if (header->directoryOffset >= header->shaderDataEnd &&
+        header->directoryOffset % alignof(ShaderCacheDirectoryEntry) == 0 && directoryEnd <= fileSize) {
+      m_mappedDirectory =
+          makeArrayRef(reinterpret_cast<const ShaderCacheDirectoryEntry *>(fileData + header->directoryOffset),
+                       header->directoryCount);
+    } else {
+      // The file has no up-to-date directory, for example because it was not closed after shaders were added. Build
+      // one by walking the shader headers, which still leaves the shader data itself untouched.
+      size_t offset = sizeof(ShaderCacheSerializedHeader);
+      for (size_t shader = 0; shader < header->shaderCount && result == Result::Success; ++shader) {
+        const auto *shaderHeader = reinterpret_cast<const ShaderHeader *>(fileData + offset);
+        if (offset + sizeof(ShaderHeader) > header->shaderDataEnd || shaderHeader->size < sizeof(ShaderHeader) ||
+            offset + shaderHeader->size > header->shaderDataEnd)
+          result = Result::ErrorUnknown;
+        else {
+          m_fileDirectory.push_back({shaderHeader->key, offset, shaderHeader->size, 0});
+          offset += shaderHeader->size;
+        }
+      }
+      std::sort(m_fileDirectory.begin(), m_fileDirectory.end(),
+                [](const ShaderCacheDirectoryEntry &lhs, const ShaderCacheDirectoryEntry &rhs) {
+                  return lhs.key < rhs.key || (lhs.key == rhs.key && lhs.offset < rhs.offset);
+                });
+      m_mappedDirectory = m_fileDirectory;
+    }
+  }
+
+  // The shader counters only describe the shaders held in cache space, which the mapped shaders are not.
+  m_totalShaders = 0;
+  m_shaderDataEnd = sizeof(ShaderCacheSerializedHeader);
+
+  return result;
+}
+
+// =====================================================================================================================
+// Creates an index map entry for the shader with the specified key from the mapped file. Returns nullptr if the mapped
+// file does not contain the shader. The entry points straight into the mapping, and its checksum is verified on first
+// retrieval.
+//
+// NOTE: This function assumes that the lock of the index map stripe that holds the key has been taken for writing by
+// the calling function.
+//
+// @param key : Compacted hash key of the shader
+ShaderIndex *ShaderCache::createMappedIndex(uint64_t key) {
+  auto it = std::lower_bound(m_mappedDirectory.begin(), m_mappedDirectory.end(), key,
+                             [](const ShaderCacheDirectoryEntry &entry, uint64_t key) { return entry.key < key; });
+  // Of the copies of the key, use the first one of the highest quality. The directory is not covered by any checksum,
+  // so check that a record is sane before using it.
+  const ShaderHeader *header = nullptr;
+  for (; it != m_mappedDirectory.end() && it->key == key; ++it) {
+    if (it->offset < sizeof(ShaderCacheSerializedHeader) || it->size < sizeof(ShaderHeader) ||
+        it->offset + it->size > m_mappedFile->size())
+      continue;
+    const auto *copy = reinterpret_cast<const ShaderHeader *>(m_mappedFile->const_data() + it->offset);
+    if (copy->key == key && copy->size == it->size && (!header || header->quality < copy->quality))
+      header = copy;
+  }
+  if (!header)
+    return nullptr;
+
+  ShaderIndex *index = createShaderIndex();
+  index->header = (*header);
+  index->dataBlob = const_cast<ShaderHeader *>(header);
+  index->state = ShaderEntryState::Ready;
+  index->checksumVerified = false;
+  return index;
+}
+
 // =====================================================================================================================
 // Loads all shader data from a client provided initial data blob. Returns true if the file contents were loaded
 // successfully or false if invalid data was found.
 //
-// NOTE: This function assumes that a write lock has already been taken by the calling function.
+// NOTE: This function assumes that it is called during initialization, with the cache lock taken by the calling
+// function.
 //
 // @param initialData : Initial data of the shader cache
 // @param initialDataSize : Size of initial data
@@ -725,17 +1218,17 @@ Result ShaderCache::loadCacheFromBlob(const void *initialData, size_t initialDat
 }
 
 // =====================================================================================================================
-// Validates shader data (from a file or a blob) by checking the CRCs and adding index hash map entries if successful.
-// Will return a failure if any of the shader data is invalid.
+// Validates shader data (from a file or a blob) by checking the checksums and adding index hash map entries if
+// successful. Will return a failure if any of the shader data is invalid.
 //
 // @param dataStart : Start pointer of cached shader data
 // @param dataSize : Shader data size in bytes
 Result ShaderCache::populateIndexMap(void *dataStart, size_t dataSize) {
   Result result = Result::Success;
 
-  // Iterate through all of the entries to verify the data CRC, zero out the GPU memory pointer/offset and add to the
-  // hashmap. We zero out the GPU memory data here because we're already iterating through each entry, rather than
-  // take the hit each time we add shader data to the file.
+  // Iterate through all of the entries to verify the data checksum, zero out the GPU memory pointer/offset and add to
+  // the hashmap. We zero out the GPU memory data here because we're already iterating through each entry, rather
+  // than take the hit each time we add shader data to the file.
   auto *header = static_cast<ShaderHeader *>(dataStart);
 
   for (unsigned shader = 0; (shader < m_totalShaders && result == Result::Success); ++shader) {
@@ -747,19 +1240,26 @@ Result ShaderCache::populateIndexMap(void *dataStart, size_t dataSize) {
     // The serialized data blob representing each RelocatableShader object immediately follows the header.
     void *const dataBlob = (header + 1);
 
-    // Verify the CRC
-    const uint64_t crc = calculateCrc(static_cast<uint8_t *>(dataBlob), (header->size - sizeof(ShaderHeader)));
+    // Verify the checksum
+    const uint64_t checksum =
+        calculateChecksum(static_cast<uint8_t *>(dataBlob), (header->size - sizeof(ShaderHeader)));
 
-    if (crc == header->crc) {
-      // It all checks out, so add this shader to the hash map!
+    if (checksum == header->checksum) {
+      // It all checks out, so add this shader to the hash map! A later copy of a key only replaces the earlier one
+      // if it is of a higher quality.
       ShaderIndex *index = nullptr;
-      auto indexMap = m_shaderIndexMap.find(header->key);
-      if (indexMap == m_shaderIndexMap.end()) {
-        index = new ShaderIndex;
+      ShaderIndexMapStripe &stripe = m_shaderIndexMap.getStripe(header->key);
+      auto indexMap = stripe.map.find(header->key);
+      if (indexMap == stripe.map.end()) {
+        index = createShaderIndex();
+        stripe.map[header->key] = index;
+      } else if (indexMap->second->header.quality < header->quality)
+        index = indexMap->second;
+
+      if (index) {
         index->header = (*header);
         index->dataBlob = header;
         index->state = ShaderEntryState::Ready;
-        m_shaderIndexMap[header->key] = index;
       }
     } else
       result = Result::ErrorUnknown;
@@ -772,18 +1272,14 @@ Result ShaderCache::populateIndexMap(void *dataStart, size_t dataSize) {
 }
 
 // =====================================================================================================================
-// Caclulates a 64-bit CRC of the data provided
+// Calculates a 64-bit checksum of the data provided, using MetroHash64.
 //
-// @param data : Data need generate CRC
+// @param data : Data need generate checksum
 // @param numBytes : Data size in bytes
-uint64_t ShaderCache::calculateCrc(const uint8_t *data, size_t numBytes) {
-  uint64_t crc = CrcInitialValue;
-  for (unsigned byte = 0; byte < numBytes; ++byte) {
-    uint8_t tableIndex = static_cast<uint8_t>(crc >> (CrcWidth - 8)) & 0xFF;
-    crc = (crc << 8) ^ CrcLookup[tableIndex] ^ data[byte];
-  }
-
-  return crc;
+uint64_t ShaderCache::calculateChecksum(const uint8_t *data, size_t numBytes) {
+  uint64_t checksum = 0;
+  MetroHash64::Hash(data, numBytes, reinterpret_cast<uint8_t *>(&checksum));
+  return checksum;
 }
 
 // =====================================================================================================================
@@ -799,7 +1295,7 @@ Result ShaderCache::validateAndLoadHeader(const ShaderCacheSerializedHeader *hea
 
   Result result = Result::Success;
 
-  if (header->headerSize == sizeof(ShaderCacheSerializedHeader) &&
+  if (header->headerSize == sizeof(ShaderCacheSerializedHeader) && header->version == ShaderCacheFormatVersion &&
       memcmp(header->buildId.buildDate, buildId.buildDate, sizeof(buildId.buildDate)) == 0 &&
       memcmp(header->buildId.buildTime, buildId.buildTime, sizeof(buildId.buildTime)) == 0 &&
       memcmp(&header->buildId.gfxIp, &buildId.gfxIp, sizeof(buildId.gfxIp)) == 0 &&
@@ -812,24 +1308,159 @@ Result ShaderCache::validateAndLoadHeader(const ShaderCacheSerializedHeader *hea
 
   // Make sure the shader data end value is correct. It's ok for there to be unused space at the end of the file, but
   // if the shaderDataEnd is beyond the end of the file we have a problem.
-  if (result == Result::Success && m_shaderDataEnd > dataSourceSize)
+  if (result == Result::Success &&
+      (m_shaderDataEnd < sizeof(ShaderCacheSerializedHeader) || m_shaderDataEnd > dataSourceSize))
     result = Result::ErrorUnknown;
 
   return result;
 }
 
 // =====================================================================================================================
-// Allocates memory from the shader cache's linear allocator. This function assumes that a write lock has been taken by
-// the calling function.
+// Allocates memory from the shader cache's linear allocator. This may be called with the lock of an index map stripe
+// held, but never takes one itself. Allocations are rounded up so that every one is aligned for the ShaderHeader that
+// usually starts it.
 //
 // @param numBytes : Allocation size in bytes
 void *ShaderCache::getCacheSpace(size_t numBytes) {
-  auto p = new uint8_t[numBytes];
-  m_allocationList.push_back(std::pair<uint8_t *, size_t>(p, numBytes));
+  numBytes = alignTo(numBytes, alignof(ShaderHeader));
+  std::lock_guard<sys::Mutex> lock(m_lock);
+
+  CacheSpaceChunk *chunk = nullptr;
+  if (numBytes > CacheSpaceChunkSize / 4) {
+    // Large allocations (e.g. a whole cache file) get a chunk of their own. It is put before the current chunk, so
+    // that the remaining space of that can still be used.
+    auto insertPos = m_cacheSpace.empty() ? m_cacheSpace.end() : std::prev(m_cacheSpace.end());
+    chunk = &*m_cacheSpace.insert(insertPos, {std::unique_ptr<uint8_t[]>(new uint8_t[numBytes]), numBytes, 0});
+  } else {
+    if (m_cacheSpace.empty() || m_cacheSpace.back().size - m_cacheSpace.back().used < numBytes)
+      m_cacheSpace.push_back({std::unique_ptr<uint8_t[]>(new uint8_t[CacheSpaceChunkSize]), CacheSpaceChunkSize, 0});
+    chunk = &m_cacheSpace.back();
+  }
+
+  void *p = chunk->mem.get() + chunk->used;
+  chunk->used += numBytes;
   m_serializedSize += numBytes;
   return p;
 }
 
+// =====================================================================================================================
+// Creates a new shader index entry in the shader cache's index arena, reusing the entry of an evicted shader if there
+// is one. The entry lives until the runtime cache is reset or its shader is evicted. This may be called with the lock
+// of an index map stripe held, but never takes one itself.
+ShaderIndex *ShaderCache::createShaderIndex() {
+  std::lock_guard<sys::Mutex> lock(m_lock);
+  if (!m_freeIndices.empty()) {
+    ShaderIndex *index = m_freeIndices.back();
+    m_freeIndices.pop_back();
+    index->~ShaderIndex();
+    return new (index) ShaderIndex;
+  }
+  return new (m_indexAllocator.Allocate()) ShaderIndex;
+}
+
+// =====================================================================================================================
+// Records that a shader has been used, for choosing the shaders to evict. The entry is only written when the use
+// clock has moved since its last use, so that threads hitting the same shader do not keep writing its cache line.
+//
+// @param index : Shader index entry of the shader
+void ShaderCache::markUsed(ShaderIndex *index) {
+  const unsigned useClock = m_useClock.load(std::memory_order_relaxed);
+  if (index->lastUse.load(std::memory_order_relaxed) != useClock)
+    index->lastUse.store(useClock, std::memory_order_relaxed);
+}
+
+// =====================================================================================================================
+// Stops using the external cache after it reported itself unavailable. This may race with other threads reading the
+// function pointers, which then either make one more call or see the cleared pointers.
+void ShaderCache::disableExternalCache() {
+  m_getValueFunc.store(nullptr, std::memory_order_relaxed);
+  m_storeValueFunc.store(nullptr, std::memory_order_relaxed);
+}
+
+// =====================================================================================================================
+// Marks the start of a use of the shader cache, during which shader data retrieved from it must stay valid.
+void ShaderCache::beginUse() {
+  std::lock_guard<sys::Mutex> lock(m_lock);
+  ++m_activeUses;
+}
+
+// =====================================================================================================================
+// Marks the end of a use of the shader cache. The last user to leave evicts shaders if the cache space has outgrown
+// the runtime size limit.
+void ShaderCache::endUse() {
+  std::lock_guard<sys::Mutex> lock(m_lock);
+  assert(m_activeUses > 0);
+  if (--m_activeUses == 0 && m_runtimeSizeLimit != 0 &&
+      m_serializedSize - sizeof(ShaderCacheSerializedHeader) > m_runtimeSizeLimit)
+    compactRuntimeCache();
+}
+
+// =====================================================================================================================
+// Evicts the least recently used shaders until the shader data in cache space fits in three quarters of the runtime
+// size limit, and moves the kept shaders into new cache space so that the memory of the evicted ones is released.
+// Shaders in the mapped file take no cache space and are never evicted.
+//
+// NOTE: This function assumes that the cache lock is taken by the calling function and that the cache has no active
+// users, so no other thread can be accessing the index map or holding a pointer to shader data.
+void ShaderCache::compactRuntimeCache() {
+  const char *mappedBegin = m_mappedFile ? m_mappedFile->const_data() : nullptr;
+  const char *mappedEnd = m_mappedFile ? mappedBegin + m_mappedFile->size() : nullptr;
+
+  std::vector<ShaderIndex *> entries;
+  for (unsigned i = 0; i < ShaderIndexMapStripeCount; ++i) {
+    for (auto it : m_shaderIndexMap.getStripeByIndex(i).map) {
+      const char *data = static_cast<const char *>(it.second->dataBlob);
+      if (it.second->state == ShaderEntryState::Ready && !(data >= mappedBegin && data < mappedEnd))
+        entries.push_back(it.second);
+    }
+  }
+  std::sort(entries.begin(), entries.end(), [](const ShaderIndex *lhs, const ShaderIndex *rhs) {
+    return lhs->lastUse.load(std::memory_order_relaxed) > rhs->lastUse.load(std::memory_order_relaxed);
+  });
+
+  std::vector<CacheSpaceChunk> oldCacheSpace;
+  oldCacheSpace.swap(m_cacheSpace);
+  m_serializedSize = sizeof(ShaderCacheSerializedHeader);
+
+  const size_t sizeTarget = m_runtimeSizeLimit - m_runtimeSizeLimit / 4;
+  size_t keptSize = 0;
+  size_t evictedCount = 0;
+  for (ShaderIndex *index : entries) {
+    if (keptSize + index->header.size <= sizeTarget) {
+      void *mem = getCacheSpace(index->header.size);
+      memcpy(mem, index->dataBlob, index->header.size);
+      index->dataBlob = mem;
+      keptSize += index->header.size;
+    } else {
+      m_shaderIndexMap.getStripe(index->header.key).map.erase(index->header.key);
+      m_freeIndices.push_back(index);
+      ++evictedCount;
+    }
+  }
+
+  // With an on-disk file, the shader count describes the file rather than the cache space. Without one it counts the
+  // shaders in cache space, which no longer includes data replaced by promoteShader.
+  if (!m_onDiskFile.isOpen())
+    m_totalShaders = entries.size() - evictedCount;
+
+  LLVM_DEBUG(dbgs() << "Evicted " << evictedCount << " shaders from shader cache, keeping " << keptSize
+                    << " bytes\n");
+}
+
+// =====================================================================================================================
+//
+// @param cache : Shader cache to mark in use, may be null
+ShaderCacheUse::ShaderCacheUse(ShaderCache *cache) : m_cache(cache) {
+  if (m_cache)
+    m_cache->beginUse();
+}
+
+// =====================================================================================================================
+ShaderCacheUse::~ShaderCacheUse() {
+  if (m_cache)
+    m_cache->endUse();
+}
+
 // =====================================================================================================================
 // Returns the time & date that pipeline.cpp was compiled.
 //
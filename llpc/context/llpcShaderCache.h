@@ -31,22 +31,40 @@
 #pragma once
 
 #include "llpc.h"
+#include "llpcCompression.h"
 #include "llpcFile.h"
 #include "llpcUtil.h"
 #include "vkgcMetroHash.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/RWMutex.h"
+#include <atomic>
 #include <condition_variable>
-#include <list>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace Llpc {
 
+// Enumerates the qualities of shader data in the cache. Shader data of a higher quality replaces that of a lower one
+// stored under the same key (see ShaderCache::promoteShader).
+enum class ShaderQuality : unsigned {
+  Fast = 0, // Compiled quickly at a reduced optimization tier, to be replaced by the fully optimized shader
+  Full = 1, // Fully optimized
+};
+
 // Header data that is stored with each shader in the cache.
 struct ShaderHeader {
-  uint64_t key; // Compacted hash key used to identify shaders
-  uint64_t crc; // CRC of the shader cache entry, used to detect data corruption.
-  size_t size;  // Total size of the shader data in the storage file
+  uint64_t key;              // Compacted hash key used to identify shaders
+  uint64_t checksum;         // Checksum of the stored shader data, used to detect data corruption.
+  size_t size;               // Total size of the shader data in the storage file
+  uint64_t uncompressedSize; // Size of the shader data after decompression, not including this header
+  CompressionCodec codec;    // Codec the stored shader data is compressed with
+  ShaderQuality quality;     // Quality of the shader data
 };
 
 // Enum defining the states a shader cache entry can be in
@@ -64,18 +82,54 @@ enum ShaderCacheMode {
   ShaderCacheEnableOnDisk = 2,             // Enabled with on-disk file
   ShaderCacheForceInternalCacheOnDisk = 3, // Force to use internal cache on disk
   ShaderCacheEnableOnDiskReadOnly = 4,     // Only read on-disk file with write-protection
+  ShaderCacheEnableOnDiskMapped = 5,       // Map on-disk file read-only, and verify each entry on first retrieval
 };
 
 // Stores data in the hash map of cached shaders and helps correlated a shader in the hash to a location in the
 // cache's linear allocators where the shader is actually stored.
 struct ShaderIndex {
-  ShaderHeader header;             // Shader header data (key, crc, size)
-  volatile ShaderEntryState state; // Shader entry state
-  void *dataBlob;                  // Serialized data blob representing a cached RelocatableShader object.
+  ShaderHeader header;              // Shader header data (key, checksum, size)
+  volatile ShaderEntryState state;  // Shader entry state
+  void *dataBlob;                   // Serialized data blob representing a cached RelocatableShader object.
+  bool checksumVerified = true;     // Whether the checksum has been checked; false until a mapped entry is retrieved
+  std::atomic<unsigned> lastUse{0}; // Use clock of the cache when the entry was last found or inserted, 0 if unused
+  // Signaled when this entry leaves the Compiling state. It is waited on with the lock of the index map stripe that
+  // holds the entry, which is also held whenever the state changes.
+  std::condition_variable_any compileDone;
 };
 
-// The key in hash map is a 64-bit compacted Shader Hash
-typedef std::unordered_map<uint64_t, ShaderIndex *> ShaderIndexMap;
+// Number of independently locked stripes the shader index map is split into. Must be a power of two.
+static constexpr unsigned ShaderIndexMapStripeCount = 64;
+
+// One stripe of the shader index map. The key in the hash map is a 64-bit compacted Shader Hash; a key always lives in
+// the stripe selected by ShaderIndexMap::getStripe.
+struct ShaderIndexMapStripe {
+  // Lock this stripe, for reading only or for writing
+  void lock(bool readOnly) { readOnly ? mutex.lock_shared() : mutex.lock(); }
+
+  // Unlock this stripe
+  void unlock(bool readOnly) { readOnly ? mutex.unlock_shared() : mutex.unlock(); }
+
+  llvm::sys::RWMutex mutex;                        // Reader/writer lock for this stripe
+  std::unordered_map<uint64_t, ShaderIndex *> map; // Shader index entries of this stripe
+};
+
+// =====================================================================================================================
+// Concurrent map from compacted shader hash to shader index. Lookups only take the shared lock of the stripe the key
+// belongs to, so threads hitting on different (or the same) entries do not serialize on one cache-wide lock.
+class ShaderIndexMap {
+public:
+  // Gets the stripe that holds the specified key
+  ShaderIndexMapStripe &getStripe(uint64_t key) {
+    return m_stripes[(key ^ (key >> 32)) & (ShaderIndexMapStripeCount - 1)];
+  }
+
+  // Gets the stripe with the specified index, used to visit all entries
+  ShaderIndexMapStripe &getStripeByIndex(unsigned idx) { return m_stripes[idx]; }
+
+private:
+  ShaderIndexMapStripe m_stripes[ShaderIndexMapStripeCount];
+};
 
 // Specifies auxiliary info necessary to create a shader cache object.
 struct ShaderCacheAuxCreateInfo {
@@ -84,6 +138,9 @@ struct ShaderCacheAuxCreateInfo {
   MetroHash::Hash hash;            // Hash code of compilation options
   const char *cacheFilePath;       // root directory of cache file
   const char *executableName;      // Name of executable file
+  size_t runtimeSizeLimit;         // Limit of the shader data held in memory in bytes, 0 for no limit
+  size_t fileSizeLimit;            // Limit of the shader data in the on-disk file in bytes, 0 for no limit
+  CompressionCodec codec;          // Codec new shaders are compressed with
 };
 
 // Length of date field used in BuildUniqueId
@@ -103,19 +160,69 @@ struct BuildUniqueId {
   MetroHash::Hash hash;          // Hash code of compilation options
 };
 
+// Version of the serialized shader cache format. Bump this whenever the layout of the serialized data or the way it is
+// validated changes, so that data written in an older format is rejected.
+//  1: Initial version, entries are checked with a 64-bit CRC
+//  2: Entries are checked with MetroHash64
+//  3: The file header counts sessions, and directory records store the last session that used each shader
+//  4: Shader headers record the codec and the uncompressed size of the shader data
+//  5: Shader headers record the quality of the shader data, and a key may be stored again with a higher quality
+static constexpr unsigned ShaderCacheFormatVersion = 5;
+
 // This the header for the shader cache data when the cache is serialized/written to disk
 struct ShaderCacheSerializedHeader {
-  size_t headerSize;     // Size of the header structure. This member must always be first
-                         // since it is used to validate the serialized data.
-  BuildUniqueId buildId; // Build time/date of the PAL version that created the cache file
-  size_t shaderCount;    // Number of shaders in the shaderIndex array
-  size_t shaderDataEnd;  // Offset to the end of shader data
+  size_t headerSize;      // Size of the header structure. This member must always be first
+                          // since it is used to validate the serialized data.
+  unsigned version;       // Version of the format, must be ShaderCacheFormatVersion
+  BuildUniqueId buildId;  // Build time/date of the PAL version that created the cache file
+  size_t shaderCount;     // Number of shaders in the shaderIndex array
+  size_t shaderDataEnd;   // Offset to the end of shader data
+  size_t directoryOffset; // Offset to the entry directory, or 0 if the file has no up-to-date directory
+  size_t directoryCount;  // Number of records in the entry directory
+  size_t session;         // Number of the last session that wrote the file; each opening for writing is a session
+};
+
+// One record of the entry directory, which is written after the shader data when an on-disk cache file is closed. The
+// directory is sorted by key, so that a mapped file can be searched without walking the shader data.
+struct ShaderCacheDirectoryEntry {
+  uint64_t key;     // Compacted hash key of the shader
+  uint64_t offset;  // Offset of the shader's ShaderHeader from the start of the file
+  uint64_t size;    // Total size of the shader data, including the ShaderHeader
+  uint64_t lastUse; // Last session that found or inserted the shader
 };
 
 constexpr unsigned MaxFilePathLen = 256;
 
+// Size of a chunk of cache space. Allocations larger than a quarter of this get a chunk of their own.
+constexpr size_t CacheSpaceChunkSize = 1024 * 1024;
+
+// A chunk of the shader cache's bump arena. Shader data is allocated back to back without padding, so that the used
+// bytes of all chunks together are exactly the serialized shader data.
+struct CacheSpaceChunk {
+  std::unique_ptr<uint8_t[]> mem; // Memory of the chunk
+  size_t size;                    // Size of the chunk in bytes
+  size_t used;                    // Number of bytes allocated from the chunk
+};
+
 typedef void *CacheEntryHandle;
 
+class ShaderCache;
+
+// =====================================================================================================================
+// Marks a scope in which data retrieved from a shader cache may be referenced. A cache with a runtime size limit only
+// evicts shaders when no such scope is active, so that retrieved pointers stay valid until the scope ends.
+class ShaderCacheUse {
+public:
+  ShaderCacheUse(ShaderCache *cache);
+  ~ShaderCacheUse();
+
+private:
+  ShaderCacheUse(const ShaderCacheUse &) = delete;
+  ShaderCacheUse &operator=(const ShaderCacheUse &) = delete;
+
+  ShaderCache *m_cache; // Shader cache in use, may be null
+};
+
 // =====================================================================================================================
 // This class implements a cache for compiled shaders. The shader cache persists in memory at runtime and can be
 // serialized to disk by the client/application for persistence between runs.
@@ -133,14 +240,23 @@ public:
 
   ShaderEntryState findShader(MetroHash::Hash hash, bool allocateOnMiss, CacheEntryHandle *phEntry);
 
-  void insertShader(CacheEntryHandle hEntry, const void *blob, size_t size);
+  void insertShader(CacheEntryHandle hEntry, const void *blob, size_t size,
+                    ShaderQuality quality = ShaderQuality::Full);
+
+  bool promoteShader(MetroHash::Hash hash, const void *blob, size_t size, ShaderQuality quality);
+
+  void discardShader(MetroHash::Hash hash, ShaderQuality quality);
 
   void resetShader(CacheEntryHandle hEntry);
 
-  Result retrieveShader(CacheEntryHandle hEntry, const void **ppBlob, size_t *size);
+  Result retrieveShader(CacheEntryHandle hEntry, const void **ppBlob, size_t *size,
+                        llvm::SmallVectorImpl<char> *buffer);
 
   bool isCompatible(const ShaderCacheCreateInfo *createInfo, const ShaderCacheAuxCreateInfo *auxCreateInfo);
 
+  void beginUse();
+  void endUse();
+
 private:
   ShaderCache(const ShaderCache &) = delete;
   ShaderCache &operator=(const ShaderCache &) = delete;
@@ -150,30 +266,33 @@ private:
   Result validateAndLoadHeader(const ShaderCacheSerializedHeader *header, size_t dataSourceSize);
   Result loadCacheFromBlob(const void *initialData, size_t initialDataSize);
   Result populateIndexMap(void *dataStart, size_t dataSize);
-  uint64_t calculateCrc(const uint8_t *data, size_t numBytes);
+  uint64_t calculateChecksum(const uint8_t *data, size_t numBytes);
 
   Result loadCacheFromFile();
+  Result loadCacheFromMapping();
+  ShaderIndex *createMappedIndex(uint64_t key);
   void resetCacheFile();
-  void addShaderToFile(const ShaderIndex *index);
+  void addShaderToFile(const ShaderHeader *data);
+  void addDirectoryToFile();
+  Result buildFileDirectory(const void *dataStart, size_t dataSize, const ShaderCacheSerializedHeader *header);
+  size_t compactCacheFile(void *dataStart, size_t dataSize);
+  void compactRuntimeCache();
 
   void *getCacheSpace(size_t numBytes);
+  ShaderHeader *storeShaderData(uint64_t key, const void *blob, size_t shaderSize, ShaderQuality quality);
+  ShaderIndex *createShaderIndex();
+  void markUsed(ShaderIndex *index);
 
-  // Lock cache map
-  void lockCacheMap(bool readOnly) { m_lock.lock(); }
-
-  // Unlock cache map
-  void unlockCacheMap(bool readOnly) { m_lock.unlock(); }
-
-  bool useExternalCache() { return m_getValueFunc && m_storeValueFunc; }
+  void disableExternalCache();
 
   void resetRuntimeCache();
   void getBuildTime(BuildUniqueId *buildId);
 
-  llvm::sys::Mutex m_lock; // Read/Write lock for access to the shader cache hash map
+  llvm::sys::Mutex m_lock; // Lock for the cache space allocations, the on-disk file and the shader counters
   File m_onDiskFile;       // File for on-disk storage of the cache
   bool m_disableCache;     // Whether disable cache completely
 
-  // Map of shader index data which detail the hash, crc, size and CPU memory location for each shader
+  // Map of shader index data which detail the hash, checksum, size and CPU memory location for each shader
   // in the cache.
   ShaderIndexMap m_shaderIndexMap;
 
@@ -184,13 +303,28 @@ private:
 
   char m_fileFullPath[MaxFilePathLen]; // Full path/filename of the shader cache on-disk file
 
-  std::list<std::pair<uint8_t *, size_t>> m_allocationList; // Memory allcoated by GetCacheSpace
-  unsigned m_serializedSize;                                // Serialized byte size of whole shader cache
-  std::mutex m_conditionMutex;                              // Mutex that will be used with the condition variable
-  std::condition_variable m_conditionVariable; // Condition variable that will be used to wait compile finish
+  std::vector<ShaderCacheDirectoryEntry> m_fileDirectory;          // Directory of the shaders in the on-disk file
+  std::unique_ptr<llvm::sys::fs::mapped_file_region> m_mappedFile; // Read-only mapping of the on-disk file
+  llvm::ArrayRef<ShaderCacheDirectoryEntry> m_mappedDirectory;     // Sorted directory of the mapped file
+
+  std::vector<CacheSpaceChunk> m_cacheSpace;                   // Chunks of memory allocated by getCacheSpace
+  llvm::SpecificBumpPtrAllocator<ShaderIndex> m_indexAllocator; // Arena of the shader index entries
+  std::vector<ShaderIndex *> m_freeIndices;                     // Index entries released by evicting their shaders
+  unsigned m_serializedSize;                                    // Byte size of the cache space plus a serialized header
+
+  size_t m_runtimeSizeLimit;        // Limit of the shader data held in cache space in bytes, 0 for no limit
+  size_t m_fileSizeLimit;           // Limit of the shader data in the on-disk file in bytes, 0 for no limit
+  size_t m_fileSession;             // Session number recorded for shaders used while the on-disk file is open
+  std::atomic<unsigned> m_useClock; // Advanced by each insert; stamped into entries to order them by last use
+  unsigned m_activeUses;            // Number of users between beginUse and endUse
+  CompressionCodec m_codec;         // Codec new shaders are compressed with
+
   const void *m_clientData;                    // Client data that will be used by function GetValue and StoreValue
-  ShaderCacheGetValue m_getValueFunc;          // GetValue function used to query an external cache for shader data
-  ShaderCacheStoreValue m_storeValueFunc;      // StoreValue function used to store shader data in an external cache
+  // The external cache functions are cleared by whichever thread finds the external cache unavailable, while other
+  // threads may be reading them without holding the same lock, so they are atomic. Callers load each function once
+  // and call through that copy.
+  std::atomic<ShaderCacheGetValue> m_getValueFunc;     // GetValue function used to query an external cache
+  std::atomic<ShaderCacheStoreValue> m_storeValueFunc; // StoreValue function used to store shader data externally
   GfxIpVersion m_gfxIp;                        // Graphics IP version info
   MetroHash::Hash m_hash;                      // Hash code of compilation options
 };
@@ -0,0 +1,109 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+@file llpcSpirvModuleCache.cpp
+@brief LLPC source file: contains implementation of class Llpc::SpirvModuleCache.
+***********************************************************************************************************************
+*/
+#include "llpcSpirvModuleCache.h"
+#include "LLVMSPIRVLib.h"
+#include "SPIRVModule.h"
+#include "llpcShaderModuleHelper.h"
+
+#define DEBUG_TYPE "llpc-spirv-module-cache"
+
+using namespace llvm;
+
+namespace Llpc {
+
+// =====================================================================================================================
+// The global SpirvModuleCache object
+SpirvModuleCache *SpirvModuleCache::m_cache = nullptr;
+
+// =====================================================================================================================
+ParsedSpirvModule::~ParsedSpirvModule() {
+}
+
+// =====================================================================================================================
+// Finds the parsed SPIR-V module with the specified cache hash, and marks it as most recently used.
+//
+// @param cacheHash : Cache hash of the SPIR-V binary
+ParsedSpirvModulePtr SpirvModuleCache::findModule(const MetroHash::Hash &cacheHash) {
+  std::lock_guard<std::mutex> lock(m_lock);
+  auto it = m_moduleMap.find(MetroHash::compact64(&cacheHash));
+  if (it == m_moduleMap.end() || memcmp(&it->second->first, &cacheHash, sizeof(cacheHash)) != 0)
+    return nullptr;
+
+  m_modules.splice(m_modules.begin(), m_modules, it->second);
+  return it->second->second;
+}
+
+// =====================================================================================================================
+// Parses the specified SPIR-V binary and adds the result to the cache, evicting the least recently used module if the
+// cache is full. The binary is optimized first if SPIR-V optimization is enabled, as the translator would otherwise do
+// for each pipeline.
+//
+// @param cacheHash : Cache hash of the SPIR-V binary
+// @param spirvBin : SPIR-V binary, which must be word aligned
+void SpirvModuleCache::addModule(const MetroHash::Hash &cacheHash, const BinaryData &spirvBin) {
+  if (findModule(cacheHash))
+    return;
+
+  // Parse without holding the lock.
+  BinaryData optimizedSpirvBin = {};
+  const BinaryData *bin = &spirvBin;
+  if (ShaderModuleHelper::optimizeSpirv(&spirvBin, &optimizedSpirvBin) == Result::Success)
+    bin = &optimizedSpirvBin;
+
+  assert(reinterpret_cast<uintptr_t>(bin->pCode) % sizeof(unsigned) == 0);
+  ArrayRef<uint32_t> spirvWords(static_cast<const uint32_t *>(bin->pCode), bin->codeSize / sizeof(uint32_t));
+  ParsedSpirvModulePtr parsedModule = std::make_shared<ParsedSpirvModule>();
+  parsedModule->module = parseSpirv(spirvWords);
+
+  ShaderModuleHelper::cleanOptimizedSpirv(&optimizedSpirvBin);
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  uint64_t key = MetroHash::compact64(&cacheHash);
+  auto it = m_moduleMap.find(key);
+  if (it != m_moduleMap.end()) {
+    // Either another thread has just added the same module, or a different module has the same compacted hash and
+    // gets replaced. Pipelines that are translating the replaced module still hold a reference to it.
+    if (memcmp(&it->second->first, &cacheHash, sizeof(cacheHash)) == 0)
+      return;
+    m_modules.erase(it->second);
+    m_moduleMap.erase(it);
+  }
+
+  m_modules.emplace_front(cacheHash, std::move(parsedModule));
+  m_moduleMap[key] = m_modules.begin();
+
+  if (m_modules.size() > m_capacity) {
+    m_moduleMap.erase(MetroHash::compact64(&m_modules.back().first));
+    m_modules.pop_back();
+  }
+}
+
+} // namespace Llpc
@@ -0,0 +1,94 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ @file llpcSpirvModuleCache.h
+ @brief LLPC header file: contains declaration of class Llpc::SpirvModuleCache.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include "llpc.h"
+#include "vkgcMetroHash.h"
+#include "llvm/ADT/ArrayRef.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace SPIRV {
+class SPIRVModule;
+} // namespace SPIRV
+
+namespace Llpc {
+
+// =====================================================================================================================
+// Represents a SPIR-V module that is parsed once, when its shader module is built, and then shared by all the pipelines
+// built from that shader module.
+struct ParsedSpirvModule {
+  ~ParsedSpirvModule();
+
+  std::unique_ptr<SPIRV::SPIRVModule> module; // Parsed SPIR-V module
+  std::mutex translationLock;                 // Serializes the translations of the module, which all modify it
+};
+
+typedef std::shared_ptr<ParsedSpirvModule> ParsedSpirvModulePtr;
+
+// =====================================================================================================================
+// This class holds the parsed SPIR-V modules of recently built shader modules, keyed by the SPIR-V cache hash
+class SpirvModuleCache {
+public:
+  SpirvModuleCache(unsigned capacity) : m_capacity(capacity) {}
+
+  // Create the global SpirvModuleCache object
+  static void initialize(unsigned capacity) { m_cache = new SpirvModuleCache(capacity); }
+
+  // Get the global SpirvModuleCache object, which is null if the cache is disabled
+  static SpirvModuleCache *getSpirvModuleCache() { return m_cache; }
+
+  static void shutdown() {
+    delete m_cache;
+    m_cache = nullptr;
+  }
+
+  ParsedSpirvModulePtr findModule(const MetroHash::Hash &cacheHash);
+
+  void addModule(const MetroHash::Hash &cacheHash, const BinaryData &spirvBin);
+
+private:
+  SpirvModuleCache(const SpirvModuleCache &) = delete;
+  SpirvModuleCache &operator=(const SpirvModuleCache &) = delete;
+
+  typedef std::list<std::pair<MetroHash::Hash, ParsedSpirvModulePtr>> ModuleList;
+
+  const unsigned m_capacity;                                      // Max count of modules held
+  std::mutex m_lock;                                              // Lock of the module list and map
+  ModuleList m_modules;                                           // Modules, most recently used first
+  std::unordered_map<uint64_t, ModuleList::iterator> m_moduleMap; // Map from compacted cache hash to module
+
+  static SpirvModuleCache *m_cache; // Global cache
+};
+
+} // namespace Llpc
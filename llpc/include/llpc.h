@@ -166,6 +166,42 @@ protected:
   virtual ~IShaderCache() {}
 };
 
+/// Enumerates the priorities of asynchronous pipeline builds.
+enum class BuildPriority : unsigned {
+  Background = 0, ///< Build that nothing is waiting for yet, such as a pipeline precompile
+  Normal = 1,     ///< Normal build
+  Foreground = 2, ///< Latency-critical build, such as one the application is blocked on
+};
+
+/// Defines callback function called with the result of an asynchronous pipeline build when it has completed
+typedef void (*BuildCompleteFunc)(void *pUserData, Result result);
+
+// =====================================================================================================================
+/// Represents an asynchronous pipeline build started with ICompiler::BuildGraphicsPipelineAsync or
+/// ICompiler::BuildComputePipelineAsync.
+class IPipelineBuild {
+public:
+  /// Checks whether the build has completed, without waiting.
+  ///
+  /// @returns True if the build has completed.
+  virtual bool IsComplete() const = 0;
+
+  /// Waits for the build to complete. A build that has not been started yet is run on the calling thread.
+  ///
+  /// @returns Result of the build.
+  virtual Result Wait() = 0;
+
+  /// Waits for the build to complete, then frees all resources associated with this object.
+  virtual void Destroy() = 0;
+
+protected:
+  /// @internal Constructor. Prevent use of new operator on this interface.
+  IPipelineBuild() {}
+
+  /// @internal Destructor. Prevent use of delete operator on this interface.
+  virtual ~IPipelineBuild() {}
+};
+
 // =====================================================================================================================
 /// Represents the interfaces of a pipeline compiler.
 class ICompiler {
@@ -236,6 +272,42 @@ public:
   virtual Result CreateShaderCache(const ShaderCacheCreateInfo *pCreateInfo, IShaderCache **ppShaderCache) = 0;
 #endif
 
+  /// Starts building a graphics pipeline from the specified info on the compiler's thread pool. The build info and the
+  /// output must stay valid until the build has completed. A queued build is only started when no build of higher
+  /// priority is queued.
+  ///
+  /// @param [in]  pPipelineInfo  Info to build this graphics pipeline
+  /// @param [out] pPipelineOut   Output of building this graphics pipeline, set when the build has completed
+  /// @param [in]  priority       Priority of the build
+  /// @param [in]  pfnComplete    [Optional] Function called with the result of the build when it has completed. It
+  ///                             can be called on any thread.
+  /// @param [in]  pUserData      User data passed to pfnComplete
+  /// @param [out] ppBuild        [Optional] Handle to wait on the build, which must be destroyed before the compiler
+  ///
+  /// @returns Result::Success if the build was started. Other return codes indicate failure.
+  virtual Result BuildGraphicsPipelineAsync(const GraphicsPipelineBuildInfo *pPipelineInfo,
+                                            GraphicsPipelineBuildOut *pPipelineOut, BuildPriority priority,
+                                            BuildCompleteFunc pfnComplete, void *pUserData,
+                                            IPipelineBuild **ppBuild) = 0;
+
+  /// Starts building a compute pipeline from the specified info on the compiler's thread pool. The build info and the
+  /// output must stay valid until the build has completed. A queued build is only started when no build of higher
+  /// priority is queued.
+  ///
+  /// @param [in]  pPipelineInfo  Info to build this compute pipeline
+  /// @param [out] pPipelineOut   Output of building this compute pipeline, set when the build has completed
+  /// @param [in]  priority       Priority of the build
+  /// @param [in]  pfnComplete    [Optional] Function called with the result of the build when it has completed. It
+  ///                             can be called on any thread.
+  /// @param [in]  pUserData      User data passed to pfnComplete
+  /// @param [out] ppBuild        [Optional] Handle to wait on the build, which must be destroyed before the compiler
+  ///
+  /// @returns Result::Success if the build was started. Other return codes indicate failure.
+  virtual Result BuildComputePipelineAsync(const ComputePipelineBuildInfo *pPipelineInfo,
+                                           ComputePipelineBuildOut *pPipelineOut, BuildPriority priority,
+                                           BuildCompleteFunc pfnComplete, void *pUserData,
+                                           IPipelineBuild **ppBuild) = 0;
+
 protected:
   ICompiler() {}
   /// Destructor
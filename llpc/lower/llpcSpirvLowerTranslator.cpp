@@ -32,8 +32,8 @@
 #include "LLVMSPIRVLib.h"
 #include "llpcCompiler.h"
 #include "llpcContext.h"
+#include "llpcSpirvModuleCache.h"
 #include "lgc/Builder.h"
-#include <sstream>
 #include <string>
 
 #define DEBUG_TYPE "llpc-spirv-lower-translator"
@@ -78,15 +78,8 @@ bool SpirvLowerTranslator::runOnModule(Module &module) {
 // @param shaderInfo : Specialization info
 // @param [in/out] module : Module to translate into, initially empty
 void SpirvLowerTranslator::translateSpirvToLlvm(const PipelineShaderInfo *shaderInfo, Module *module) {
-  BinaryData optimizedSpirvBin = {};
   const ShaderModuleData *moduleData = reinterpret_cast<const ShaderModuleData *>(shaderInfo->pModuleData);
   assert(moduleData->binType == BinaryType::Spirv);
-  const BinaryData *spirvBin = &moduleData->binCode;
-  if (ShaderModuleHelper::optimizeSpirv(spirvBin, &optimizedSpirvBin) == Result::Success)
-    spirvBin = &optimizedSpirvBin;
-
-  std::string spirvCode(static_cast<const char *>(spirvBin->pCode), spirvBin->codeSize);
-  std::istringstream spirvStream(spirvCode);
   std::string errMsg;
   SPIRV::SPIRVSpecConstMap specConstMap;
   ShaderStage entryStage = shaderInfo->entryStage;
@@ -103,8 +96,38 @@ void SpirvLowerTranslator::translateSpirvToLlvm(const PipelineShaderInfo *shader
 
   Context *context = static_cast<Context *>(&module->getContext());
 
-  if (!readSpirv(context->getBuilder(), &(moduleData->usage), spirvStream, convertToExecModel(entryStage),
-                 shaderInfo->pEntryTarget, specConstMap, module, errMsg)) {
+  // Reuse the SPIR-V module parsed when the shader module was built, if it is still cached.
+  ParsedSpirvModulePtr parsedModule;
+  if (SpirvModuleCache::getSpirvModuleCache()) {
+    MetroHash::Hash cacheHash = {};
+    memcpy(cacheHash.dwords, moduleData->cacheHash, sizeof(cacheHash));
+    parsedModule = SpirvModuleCache::getSpirvModuleCache()->findModule(cacheHash);
+  }
+
+  bool success = false;
+  if (parsedModule) {
+    // Translation adds constants for literal operands to the module, and specializes a module with specialization
+    // constants in place for its duration, so only one pipeline at a time may translate it.
+    std::lock_guard<std::mutex> lock(parsedModule->translationLock);
+    success = readSpirv(context->getBuilder(), &(moduleData->usage), *parsedModule->module,
+                        convertToExecModel(entryStage), shaderInfo->pEntryTarget, specConstMap, module, errMsg);
+  } else {
+    BinaryData optimizedSpirvBin = {};
+    const BinaryData *spirvBin = &moduleData->binCode;
+    if (ShaderModuleHelper::optimizeSpirv(spirvBin, &optimizedSpirvBin) == Result::Success)
+      spirvBin = &optimizedSpirvBin;
+
+    // The SPIR-V binary is decoded in place, so it must be word aligned.
+    assert(reinterpret_cast<uintptr_t>(spirvBin->pCode) % sizeof(unsigned) == 0);
+    ArrayRef<uint32_t> spirvWords(static_cast<const uint32_t *>(spirvBin->pCode),
+                                  spirvBin->codeSize / sizeof(uint32_t));
+    success = readSpirv(context->getBuilder(), &(moduleData->usage), spirvWords, convertToExecModel(entryStage),
+                        shaderInfo->pEntryTarget, specConstMap, module, errMsg);
+
+    ShaderModuleHelper::cleanOptimizedSpirv(&optimizedSpirvBin);
+  }
+
+  if (!success) {
     report_fatal_error(Twine("Failed to translate SPIR-V to LLVM (") +
                            getShaderStageName(static_cast<ShaderStage>(entryStage)) + " shader): " + errMsg,
                        false);
@@ -114,8 +137,6 @@ void SpirvLowerTranslator::translateSpirvToLlvm(const PipelineShaderInfo *shader
   // rather than a pipeline compile.
   m_context->getBuilder()->recordShaderModes(module);
 
-  ShaderModuleHelper::cleanOptimizedSpirv(&optimizedSpirvBin);
-
   // NOTE: Our shader entrypoint is marked in the SPIR-V reader as dllexport. Here we mark it as follows:
   //   * remove the dllexport;
   //   * ensure it is public.
@@ -0,0 +1,32 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform sampler2D samp2D[16];
+
+layout(location = 0) flat in int index;
+layout(location = 1) in vec2 uv;
+
+layout(location = 0) out vec4 fragColor;
+
+void main()
+{
+    vec4 f4 = texture(samp2D[nonuniformEXT(index)], uv);
+    f4 += texture(samp2D[nonuniformEXT(index)], uv * 2.0);
+
+    fragColor = f4;
+}
+// BEGIN_SHADERTEST
+/*
+; RUN: amdllpc -spvgen-dir=%spvgendir% -v %gfxip %s | FileCheck -check-prefix=SHADERTEST %s
+
+; The two samples through the same non-uniform descriptor index share a single waterfall loop.
+; SHADERTEST-LABEL: {{^// LLPC}} pipeline patching results
+; SHADERTEST: call i32 @llvm.amdgcn.waterfall.begin
+; SHADERTEST-NOT: call i32 @llvm.amdgcn.waterfall.begin
+; SHADERTEST: call {{.*}}@llvm.amdgcn.waterfall.end
+; SHADERTEST-NOT: call i32 @llvm.amdgcn.waterfall.begin
+; SHADERTEST: call {{.*}}@llvm.amdgcn.waterfall.end
+; SHADERTEST-NOT: call i32 @llvm.amdgcn.waterfall.begin
+; SHADERTEST: AMDLLPC SUCCESS
+*/
+// END_SHADERTEST
@@ -61,8 +61,12 @@
 #endif
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <sstream>
 #include <stdlib.h> // getenv
+#include <thread>
 
 // NOTE: To enable VLD, please add option BUILD_WIN_VLD=1 in build option.To run amdllpc with VLD enabled,
 // please copy vld.ini and all files in.\winVisualMemDetector\bin\Win64 to current directory of amdllpc.
@@ -239,6 +243,12 @@ static cl::opt<bool> CheckAutoLayoutCompatible(
     "check-auto-layout-compatible",
     cl::desc("check if auto descriptor layout got from spv file is commpatible with real layout"));
 
+// -j: number of threads to compile independent pipeline files with
+static cl::opt<unsigned> NumThreads("j",
+                                    cl::desc("Compile independent pipeline (.pipe) or LLVM IR (.ll) files on N threads "
+                                             "sharing one compiler, and print a batch summary (0 = hardware threads)"),
+                                    cl::value_desc("N"), cl::init(1));
+
 namespace llvm {
 
 namespace cl {
@@ -1430,6 +1440,93 @@ static Result processPipeline(ICompiler *compiler, ArrayRef<std::string> inFiles
   return result;
 }
 
+// Represents the outcome of processing one pipeline file in batch mode.
+struct BatchFileResult {
+  Result result;  // Result of processing the file
+  double latency; // Wall-clock time spent processing the file, in milliseconds
+};
+
+// =====================================================================================================================
+// Gets the given percentile of a sorted list of latencies, using the nearest-rank method.
+//
+// @param sortedLatencies : Latencies sorted in ascending order (must not be empty)
+// @param percentile : Percentile to get, in the range (0, 100]
+static double getLatencyPercentile(ArrayRef<double> sortedLatencies, unsigned percentile) {
+  assert(!sortedLatencies.empty());
+  size_t rank = (sortedLatencies.size() * percentile + 99) / 100;
+  return sortedLatencies[std::max<size_t>(rank, 1) - 1];
+}
+
+// =====================================================================================================================
+// Processes independent pipeline files concurrently on the same compiler (batch mode). Each file is compiled as a
+// separate pipeline, as in serial mode. Per-file results are reported in input order once all files are done,
+// followed by a summary of throughput, latency and failures.
+//
+// Returns Success only if every file was processed successfully.
+//
+// @param compiler : LLPC compiler object
+// @param inFiles : Input pipeline files, each one compiled as a separate pipeline
+// @param threadCount : Number of threads to compile with
+static Result processPipelineBatch(ICompiler *compiler, ArrayRef<std::string> inFiles, unsigned threadCount) {
+  const unsigned fileCount = inFiles.size();
+  threadCount = std::min(threadCount, fileCount);
+
+  // NOTE: SPVGEN is loaded on first use, which is not thread-safe. Without -spvgen-dir it has not been loaded yet, and
+  // the worker threads would each load it to parse pipeline files and compile GLSL, so load it up front, so that they
+  // only ever observe it loaded.
+  InitSpvGen();
+
+  std::vector<BatchFileResult> fileResults(fileCount);
+  std::atomic<unsigned> nextFileIndex(0);
+
+  auto worker = [&] {
+    for (unsigned fileIndex = nextFileIndex++; fileIndex < fileCount; fileIndex = nextFileIndex++) {
+      unsigned nextFile = 0;
+      auto startTime = std::chrono::steady_clock::now();
+      Result result = processPipeline(compiler, {inFiles[fileIndex]}, 0, &nextFile);
+      std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - startTime;
+      fileResults[fileIndex] = {result, latency.count()};
+    }
+  };
+
+  auto batchStartTime = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < threadCount; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &thread : threads)
+    thread.join();
+  std::chrono::duration<double> wallTime = std::chrono::steady_clock::now() - batchStartTime;
+
+  // Report per-file results in input order, so that the output does not depend on scheduling.
+  Result batchResult = Result::Success;
+  unsigned failureCount = 0;
+  std::vector<double> latencies;
+  latencies.reserve(fileCount);
+  for (unsigned i = 0; i < fileCount; ++i) {
+    const BatchFileResult &fileResult = fileResults[i];
+    bool passed = fileResult.result == Result::Success;
+    if (!passed) {
+      ++failureCount;
+      batchResult = fileResult.result;
+    }
+    latencies.push_back(fileResult.latency);
+    const char *status = passed ? "PASS" : "FAIL";
+    outs() << format("%s %10.3f ms  ", status, fileResult.latency) << inFiles[i] << "\n";
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  outs() << "\n=====  AMDLLPC BATCH SUMMARY  =====\n";
+  outs() << "Pipelines: " << fileCount << ", failed: " << failureCount << ", threads: " << threadCount << "\n";
+  outs() << format("Wall time: %.3f s, throughput: %.2f pipelines/s\n", wallTime.count(),
+                   wallTime.count() > 0 ? fileCount / wallTime.count() : 0.0);
+  outs() << format("Latency: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", getLatencyPercentile(latencies, 50),
+                   getLatencyPercentile(latencies, 99), latencies.back());
+  outs().flush();
+
+  return batchResult;
+}
+
 #ifdef WIN_OS
 // =====================================================================================================================
 // Finds all filenames which can match input file name
@@ -1529,8 +1626,8 @@ int main(int argc, char *argv[]) {
 
   // Simplify error handling and enable early returns. These assume that result statuses
   // are always written to the |result| local variable.
-  auto isFailure = [result] { return result != Result::Success; };
-  auto onFailure = [compiler, result] {
+  auto isFailure = [&result] { return result != Result::Success; };
+  auto onFailure = [compiler, &result] {
     assert(result != Result::Success);
     (void)result;
     compiler->Destroy();
@@ -1549,12 +1646,24 @@ int main(int argc, char *argv[]) {
   // The first input file is a pipeline file or LLVM IR file. Assume they all are, and compile each one
   // separately but in the same context.
   if (isPipelineInfoFile(expandedInputFiles[0]) || isLlvmIrFile(expandedInputFiles[0])) {
-    unsigned nextFile = 0;
-
-    for (const std::string &file : expandedInputFiles) {
-      result = processPipeline(compiler, {file}, 0, &nextFile);
+    unsigned threadCount = NumThreads == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : NumThreads;
+    if (threadCount > 1) {
+      // Batch mode: every file gets its own default-named output file, so a single -o target cannot be honored.
+      if (!OutFile.empty() && expandedInputFiles.size() > 1) {
+        LLPC_ERRS("Option -o cannot be used with -j and multiple input files\n");
+        result = Result::ErrorInvalidValue;
+      } else
+        result = processPipelineBatch(compiler, expandedInputFiles, threadCount);
       if (isFailure())
         return onFailure();
+    } else {
+      unsigned nextFile = 0;
+
+      for (const std::string &file : expandedInputFiles) {
+        result = processPipeline(compiler, {file}, 0, &nextFile);
+        if (isFailure())
+          return onFailure();
+      }
     }
   } else {
     // Otherwise, join all input files into the same pipeline.
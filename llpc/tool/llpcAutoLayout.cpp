@@ -36,6 +36,7 @@
 #include "SPIRVFunction.h"
 #include "SPIRVInstruction.h"
 #include "SPIRVModule.h"
+#include "SPIRVStream.h"
 #include "SPIRVType.h"
 #include "amdllpc.h"
 #include "llpcDebug.h"
@@ -275,9 +276,9 @@ bool checkPipelineStateCompatible(const ICompiler *compiler, Llpc::GraphicsPipel
 // @param checkAutoLayoutCompatible : if check AutoLayout Compatiple
 void doAutoLayoutDesc(ShaderStage shaderStage, BinaryData spirvBin, GraphicsPipelineBuildInfo *pipelineInfo,
                       PipelineShaderInfo *shaderInfo, unsigned &topLevelOffset, bool checkAutoLayoutCompatible) {
-  // Read the SPIR-V.
-  std::string spirvCode(static_cast<const char *>(spirvBin.pCode), spirvBin.codeSize);
-  std::istringstream spirvStream(spirvCode);
+  // Read the SPIR-V. It is decoded in place, so it must be word aligned.
+  assert(reinterpret_cast<uintptr_t>(spirvBin.pCode) % sizeof(SPIRVWord) == 0);
+  SPIRVInputStream spirvStream(static_cast<const SPIRVWord *>(spirvBin.pCode), spirvBin.codeSize / sizeof(SPIRVWord));
   std::unique_ptr<SPIRVModule> module(SPIRVModule::createSPIRVModule());
   spirvStream >> *module;
 
@@ -0,0 +1,155 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcShaderCacheBench.cpp
+ * @brief LLPC source file: multithreaded hit/miss microbenchmark of the shader cache index
+ ***********************************************************************************************************************
+ */
+#include "llpcShaderCache.h"
+#include "vkgcMetroHash.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+using namespace Llpc;
+
+// -threads: maximum number of threads to look up shaders from
+static cl::opt<unsigned> MaxThreads("threads", cl::desc("Maximum number of lookup threads"),
+                                    cl::init(std::thread::hardware_concurrency()));
+
+// -entries: number of shaders in the cache before the lookups start
+static cl::opt<unsigned> EntryCount("entries", cl::desc("Number of shaders in the cache"), cl::init(4096));
+
+// -lookups: number of lookups done by each thread
+static cl::opt<unsigned> LookupCount("lookups", cl::desc("Number of lookups per thread"), cl::init(200000));
+
+// -miss-percent: percentage of lookups that miss and insert a new shader
+static cl::opt<unsigned> MissPercent("miss-percent", cl::desc("Percentage of lookups that miss"), cl::init(5));
+
+// -shader-size: size of each shader blob in bytes
+static cl::opt<unsigned> ShaderSize("shader-size", cl::desc("Size of each shader in bytes"), cl::init(256));
+
+// =====================================================================================================================
+// Makes the hash that a shader number is cached under.
+//
+// @param number : Shader number
+static MetroHash::Hash getShaderHash(uint64_t number) {
+  MetroHash::Hash hash = {};
+  MetroHash64::Hash(reinterpret_cast<const uint8_t *>(&number), sizeof(number), hash.bytes);
+  return hash;
+}
+
+// =====================================================================================================================
+// Looks up a shader, compiling (inserting) it on a miss the same way the compiler does.
+//
+// @param cache : Shader cache
+// @param hash : Hash of the shader
+// @param blob : Shader data inserted on a miss
+// @returns : True if the shader was found in the cache
+static bool lookUpShader(ShaderCache &cache, MetroHash::Hash hash, ArrayRef<char> blob) {
+  CacheEntryHandle hEntry = nullptr;
+  ShaderEntryState state = cache.findShader(hash, true, &hEntry);
+  if (state == ShaderEntryState::Ready) {
+    ShaderCacheUse cacheUse(&cache);
+    SmallVector<char, 256> buffer;
+    const void *data = nullptr;
+    size_t size = 0;
+    return cache.retrieveShader(hEntry, &data, &size, &buffer) == Result::Success;
+  }
+  if (state == ShaderEntryState::Compiling)
+    cache.insertShader(hEntry, blob.data(), blob.size());
+  return false;
+}
+
+// =====================================================================================================================
+// Runs the lookups of one thread count against a freshly populated cache.
+//
+// @param threadCount : Number of threads looking up shaders
+// @param blob : Shader data
+// @returns : Lookups per second over all threads
+static double runLookups(unsigned threadCount, ArrayRef<char> blob) {
+  ShaderCacheCreateInfo createInfo = {};
+  ShaderCacheAuxCreateInfo auxCreateInfo = {};
+  auxCreateInfo.shaderCacheMode = ShaderCacheEnableRuntime;
+  ShaderCache cache;
+  if (cache.init(&createInfo, &auxCreateInfo) != Result::Success) {
+    errs() << "Failed to create the shader cache\n";
+    exit(1);
+  }
+
+  for (unsigned i = 0; i < EntryCount; ++i)
+    lookUpShader(cache, getShaderHash(i), blob);
+
+  // Each thread misses on its own range of shader numbers above the populated ones, so that every miss inserts.
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned threadIdx = 0; threadIdx < threadCount; ++threadIdx) {
+    threads.emplace_back([&cache, blob, threadIdx] {
+      uint64_t missNumber = EntryCount + uint64_t(threadIdx) * LookupCount;
+      uint64_t hitNumber = threadIdx;
+      for (unsigned i = 0; i < LookupCount; ++i) {
+        if (i % 100 < MissPercent)
+          lookUpShader(cache, getShaderHash(missNumber++), blob);
+        else {
+          hitNumber = (hitNumber * 6364136223846793005ULL + 1442695040888963407ULL);
+          lookUpShader(cache, getShaderHash((hitNumber >> 33) % EntryCount), blob);
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return double(threadCount) * LookupCount / elapsed.count();
+}
+
+// =====================================================================================================================
+// Main function of the shader cache microbenchmark. Prints the lookup rate for doubling thread counts, which shows
+// how lookups scale over the striped index map.
+//
+// @param argc : Count of arguments
+// @param argv : List of arguments
+int main(int argc, char **argv) {
+  InitLLVM initLlvm(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv, "LLPC shader cache microbenchmark\n");
+
+  std::vector<char> blob(ShaderSize, 'x');
+  double singleThreadRate = 0.0;
+  outs() << "threads  lookups/s     scaling\n";
+  for (unsigned threadCount = 1; threadCount <= std::max(1U, unsigned(MaxThreads)); threadCount *= 2) {
+    double rate = runLookups(threadCount, blob);
+    if (threadCount == 1)
+      singleThreadRate = rate;
+    outs() << format("%7u  %12.0f  %6.2fx\n", threadCount, rate, rate / singleThreadRate);
+  }
+  return 0;
+}
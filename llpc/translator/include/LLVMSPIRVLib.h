@@ -106,11 +106,30 @@ class raw_pwrite_stream;
 /// \returns true if succeeds.
 bool writeSpirv(llvm::Module *M, llvm::raw_ostream &OS, std::string &ErrMsg);
 
-/// \brief Load SPIRV from istream and translate to LLVM module.
+/// \brief Load SPIRV from its words in memory, which are decoded in place, and
+/// translate to LLVM module.
 /// \returns true if succeeds.
 bool readSpirv(lgc::Builder *Builder,
                const Vkgc::ShaderModuleUsage* ModuleData,
-               std::istream &IS,
+               llvm::ArrayRef<uint32_t> Spirv,
+               spv::ExecutionModel EntryExecModel,
+               const char *EntryName,
+               const SPIRV::SPIRVSpecConstMap &SpecConstMap,
+               llvm::Module *M,
+               std::string &ErrMsg);
+
+/// \brief Parse SPIRV from its words in memory into a module that can be
+/// translated any number of times.
+std::unique_ptr<SPIRV::SPIRVModule> parseSpirv(llvm::ArrayRef<uint32_t> Spirv);
+
+/// \brief Translate an already parsed SPIRV module to LLVM module.
+/// Translation modifies the module: it adds constants for literal operands, and
+/// a module with specialization constants is specialized in place and restored
+/// afterwards. Translations of the same module must be serialized by the caller.
+/// \returns true if succeeds.
+bool readSpirv(lgc::Builder *Builder,
+               const Vkgc::ShaderModuleUsage* ModuleData,
+               SPIRV::SPIRVModule &BM,
                spv::ExecutionModel EntryExecModel,
                const char *EntryName,
                const SPIRV::SPIRVSpecConstMap &SpecConstMap,
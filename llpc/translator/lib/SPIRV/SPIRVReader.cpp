@@ -8133,22 +8133,42 @@ llvm::GlobalValue::LinkageTypes SPIRVToLLVM::transLinkageType(const SPIRVValue *
 
 } // namespace SPIRV
 
-bool llvm::readSpirv(Builder *builder, const ShaderModuleUsage *shaderInfo, std::istream &is,
+std::unique_ptr<SPIRVModule> llvm::parseSpirv(ArrayRef<uint32_t> spirv) {
+  std::unique_ptr<SPIRVModule> bm(SPIRVModule::createSPIRVModule());
+
+  SPIRVInputStream is(spirv.data(), spirv.size());
+  is >> *bm;
+  return bm;
+}
+
+bool llvm::readSpirv(Builder *builder, const ShaderModuleUsage *shaderInfo, ArrayRef<uint32_t> spirv,
                      spv::ExecutionModel entryExecModel, const char *entryName, const SPIRVSpecConstMap &specConstMap,
                      Module *m, std::string &errMsg) {
-  assert(entryExecModel != ExecutionModelKernel && "Not support ExecutionModelKernel");
+  std::unique_ptr<SPIRVModule> bm = parseSpirv(spirv);
+  return readSpirv(builder, shaderInfo, *bm, entryExecModel, entryName, specConstMap, m, errMsg);
+}
 
-  std::unique_ptr<SPIRVModule> bm(SPIRVModule::createSPIRVModule());
+bool llvm::readSpirv(Builder *builder, const ShaderModuleUsage *shaderInfo, SPIRVModule &bm,
+                     spv::ExecutionModel entryExecModel, const char *entryName, const SPIRVSpecConstMap &specConstMap,
+                     Module *m, std::string &errMsg) {
+  assert(entryExecModel != ExecutionModelKernel && "Not support ExecutionModelKernel");
 
-  is >> *bm;
+  // Only a module with specialization constants needs to be restored after the translation. The constants the
+  // translation adds for literal operands are valid for any later translation, so they are kept.
+  const bool specialize = bm.hasSpecConstants();
+  if (specialize)
+    bm.beginSpecialization();
 
-  SPIRVToLLVM btl(m, bm.get(), specConstMap, builder, shaderInfo);
+  SPIRVToLLVM btl(m, &bm, specConstMap, builder, shaderInfo);
   bool succeed = true;
   if (!btl.translate(entryExecModel, entryName)) {
-    bm->getError(errMsg);
+    bm.getError(errMsg);
     succeed = false;
   }
 
+  if (specialize)
+    bm.endSpecialization();
+
   if (DbgSaveTmpLLVM)
     dumpLLVM(m, DbgTmpLLVMFileName);
 
@@ -83,7 +83,7 @@ void SPIRVDecorate::setWordCount(SPIRVWord Count) {
   Literals.resize(WordCount - FixedWC);
 }
 
-void SPIRVDecorate::decode(std::istream &I) {
+void SPIRVDecorate::decode(SPIRVInputStream &I) {
   SPIRVDecoder Decoder = getDecoder(I);
   Decoder >> Target >> Dec;
   if (Dec == DecorationLinkageAttributes)
@@ -98,17 +98,17 @@ void SPIRVMemberDecorate::setWordCount(SPIRVWord Count) {
   Literals.resize(WordCount - FixedWC);
 }
 
-void SPIRVMemberDecorate::decode(std::istream &I) {
+void SPIRVMemberDecorate::decode(SPIRVInputStream &I) {
   getDecoder(I) >> Target >> MemberNumber >> Dec >> Literals;
   getOrCreateTarget()->addMemberDecorate(this);
 }
 
-void SPIRVDecorationGroup::decode(std::istream &I) {
+void SPIRVDecorationGroup::decode(SPIRVInputStream &I) {
   getDecoder(I) >> Id;
   Module->addDecorationGroup(this);
 }
 
-void SPIRVGroupDecorate::decode(std::istream &I) {
+void SPIRVGroupDecorate::decode(SPIRVInputStream &I) {
   getDecoder(I) >> DecorationGroup >> Targets;
   Module->addGroupDecorateGeneric(this);
 }
@@ -123,7 +123,7 @@ void SPIRVGroupDecorate::decorateTargets() {
   }
 }
 
-void SPIRVGroupMemberDecorate::decode(std::istream &I) {
+void SPIRVGroupMemberDecorate::decode(SPIRVInputStream &I) {
   std::vector<SPIRVWord> Pairs(WordCount - FixedWC);
   getDecoder(I) >> DecorationGroup >> Pairs;
   assert(Pairs.size() % 2 == 0);
@@ -59,32 +59,58 @@ namespace SPIRV {
 
 template <typename T> SPIRVEntry *create() { return new T(); }
 
-SPIRVEntry *SPIRVEntry::create(Op OpCode) {
-  typedef SPIRVEntry *(*SPIRVFactoryTy)();
+template <typename T> SPIRVEntry *createIn(llvm::BumpPtrAllocator &Arena) {
+  return new (Arena.Allocate(sizeof(T), alignof(T))) T();
+}
+
+namespace {
+// Factory functions of the class that represents an op code
+struct SPIRVFactory {
+  SPIRVEntry *(*Create)();
+  SPIRVEntry *(*CreateIn)(llvm::BumpPtrAllocator &);
+};
+} // namespace
+
+static const SPIRVFactory *getFactory(Op OpCode) {
   struct TableEntry {
     Op Opn;
-    SPIRVFactoryTy Factory;
-    operator std::pair<const Op, SPIRVFactoryTy>() {
+    SPIRVFactory Factory;
+    operator std::pair<const Op, SPIRVFactory>() {
       return std::make_pair(Opn, Factory);
     }
   };
 
   static TableEntry Table[] = {
-#define _SPIRV_OP(x, ...) {Op##x, &SPIRV::create<SPIRV##x>},
+#define _SPIRV_OP(x, ...)                                                      \
+  {Op##x, {&SPIRV::create<SPIRV##x>, &SPIRV::createIn<SPIRV##x>}},
 #include "SPIRVOpCodeEnum.h"
 #undef _SPIRV_OP
   };
 
-  typedef std::map<Op, SPIRVFactoryTy> OpToFactoryMapTy;
+  typedef std::map<Op, SPIRVFactory> OpToFactoryMapTy;
   static const OpToFactoryMapTy OpToFactoryMap(std::begin(Table),
                                                std::end(Table));
 
   OpToFactoryMapTy::const_iterator Loc = OpToFactoryMap.find(OpCode);
   if (Loc != OpToFactoryMap.end())
-    return Loc->second();
+    return &Loc->second;
 
   assert(0 && "Not implemented");
-  return 0;
+  return nullptr;
+}
+
+SPIRVEntry *SPIRVEntry::create(Op OpCode) {
+  auto Factory = getFactory(OpCode);
+  return Factory ? Factory->Create() : nullptr;
+}
+
+SPIRVEntry *SPIRVEntry::create(Op OpCode, llvm::BumpPtrAllocator &Arena) {
+  auto Factory = getFactory(OpCode);
+  if (!Factory)
+    return nullptr;
+  SPIRVEntry *Entry = Factory->CreateIn(Arena);
+  Entry->Attrib |= SPIRVEA_ARENA;
+  return Entry;
 }
 
 std::unique_ptr<SPIRV::SPIRVEntry> SPIRVEntry::createUnique(Op OC) {
@@ -116,7 +142,7 @@ SPIRVType *SPIRVEntry::getValueType(SPIRVId TheId) const {
   return get<SPIRVValue>(TheId)->getType();
 }
 
-SPIRVDecoder SPIRVEntry::getDecoder(std::istream &I) {
+SPIRVDecoder SPIRVEntry::getDecoder(SPIRVInputStream &I) {
   return SPIRVDecoder(I, *Module);
 }
 
@@ -155,7 +181,7 @@ bool SPIRVEntry::isEndOfBlock() const {
 // The word count and op code has already been read before calling this
 // function for creating the SPIRVEntry. Therefore the input stream only
 // contains the remaining part of the words for the SPIRVEntry.
-void SPIRVEntry::decode(std::istream &I) { assert(0 && "Not implemented"); }
+void SPIRVEntry::decode(SPIRVInputStream &I) { assert(0 && "Not implemented"); }
 
 std::vector<SPIRVValue *>
 SPIRVEntry::getValues(const std::vector<SPIRVId> &IdVec) const {
@@ -327,7 +353,7 @@ void SPIRVEntry::updateModuleVersion() const {
   Module->setMinSPIRVVersion(getRequiredSPIRVVersion());
 }
 
-std::istream &operator>>(std::istream &I, SPIRVEntry &E) {
+SPIRVInputStream &operator>>(SPIRVInputStream &I, SPIRVEntry &E) {
   E.decode(I);
   return I;
 }
@@ -339,7 +365,7 @@ SPIRVEntryPoint::SPIRVEntryPoint(SPIRVModule *TheModule,
                       getSizeInWords(TheName) + 3),
       ExecModel(TheExecModel), Name(TheName) {}
 
-void SPIRVEntryPoint::decode(std::istream &I) {
+void SPIRVEntryPoint::decode(SPIRVInputStream &I) {
   uint32_t Start = I.tellg();
   getDecoder(I) >> ExecModel >> Target >> Name;
   uint32_t Curr = I.tellg();
@@ -350,7 +376,7 @@ void SPIRVEntryPoint::decode(std::istream &I) {
   Module->addEntryPoint(this);
 }
 
-void SPIRVExecutionMode::decode(std::istream &I) {
+void SPIRVExecutionMode::decode(SPIRVInputStream &I) {
   getDecoder(I) >> Target >> ExecMode;
   bool MergeEM = false;
   switch (ExecMode) {
@@ -393,7 +419,7 @@ SPIRVForward *SPIRVAnnotationGeneric::getOrCreateTarget() const {
 SPIRVName::SPIRVName(const SPIRVEntry *TheTarget, const std::string &TheStr)
     : SPIRVAnnotation(TheTarget, getSizeInWords(TheStr) + 2), Str(TheStr) {}
 
-void SPIRVName::decode(std::istream &I) {
+void SPIRVName::decode(SPIRVInputStream &I) {
   getDecoder(I) >> Target >> Str;
   Module->setName(getOrCreateTarget(), Str);
 }
@@ -405,7 +431,7 @@ void SPIRVName::validate() const {
 _SPIRV_IMP_ENCDEC2(SPIRVString, Id, Str)
 _SPIRV_IMP_DECODE3(SPIRVMemberName, Target, MemberNumber, Str)
 
-void SPIRVLine::decode(std::istream &I) {
+void SPIRVLine::decode(SPIRVInputStream &I) {
   getDecoder(I) >> FileName >> Line >> Column;
   std::shared_ptr<const SPIRVLine> L(this);
   Module->setCurrentLine(L);
@@ -434,7 +460,7 @@ SPIRVExtInstImport::SPIRVExtInstImport(SPIRVModule *TheModule, SPIRVId TheId,
   validate();
 }
 
-void SPIRVExtInstImport::decode(std::istream &I) {
+void SPIRVExtInstImport::decode(SPIRVInputStream &I) {
   getDecoder(I) >> Id >> Str;
   Module->importBuiltinSetWithId(Str, Id);
 }
@@ -444,7 +470,7 @@ void SPIRVExtInstImport::validate() const {
   assert(!Str.empty() && "Invalid builtin set");
 }
 
-void SPIRVMemoryModel::decode(std::istream &I) {
+void SPIRVMemoryModel::decode(SPIRVInputStream &I) {
   SPIRVAddressingModelKind AddrModel;
   SPIRVMemoryModelKind MemModel;
   getDecoder(I) >> AddrModel >> MemModel;
@@ -460,7 +486,7 @@ void SPIRVMemoryModel::validate() const {
   SPIRVCK(isValid(MM), InvalidMemoryModel, "Actual is " + std::to_string(MM));
 }
 
-void SPIRVSource::decode(std::istream &I) {
+void SPIRVSource::decode(SPIRVInputStream &I) {
   SourceLanguage Lang = SourceLanguageUnknown;
   SPIRVWord Ver = SPIRVWORD_MAX;
   getDecoder(I) >> Lang >> Ver;
@@ -475,7 +501,7 @@ SPIRVSourceContinued::SPIRVSourceContinued(SPIRVModule *M,
     const std::string &SS)
   :SPIRVEntryNoId(M, 1 + getSizeInWords(SS)), Str(SS){}
 
-void SPIRVSourceContinued::decode(std::istream &I) {
+void SPIRVSourceContinued::decode(SPIRVInputStream &I) {
   getDecoder(I) >> Str;
 }
 
@@ -483,7 +509,7 @@ SPIRVSourceExtension::SPIRVSourceExtension(SPIRVModule *M,
                                            const std::string &SS)
     : SPIRVEntryNoId(M, 1 + getSizeInWords(SS)), S(SS) {}
 
-void SPIRVSourceExtension::decode(std::istream &I) {
+void SPIRVSourceExtension::decode(SPIRVInputStream &I) {
   getDecoder(I) >> S;
   Module->getSourceExtension().insert(S);
 }
@@ -491,7 +517,7 @@ void SPIRVSourceExtension::decode(std::istream &I) {
 SPIRVExtension::SPIRVExtension(SPIRVModule *M, const std::string &SS)
     : SPIRVEntryNoId(M, 1 + getSizeInWords(SS)), S(SS) {}
 
-void SPIRVExtension::decode(std::istream &I) {
+void SPIRVExtension::decode(SPIRVInputStream &I) {
   getDecoder(I) >> S;
   Module->getExtension().insert(S);
 }
@@ -501,7 +527,7 @@ SPIRVCapability::SPIRVCapability(SPIRVModule *M, SPIRVCapabilityKind K)
   updateModuleVersion();
 }
 
-void SPIRVCapability::decode(std::istream &I) {
+void SPIRVCapability::decode(SPIRVInputStream &I) {
   getDecoder(I) >> Kind;
   Module->addCapability(Kind);
 }
@@ -510,7 +536,7 @@ SPIRVModuleProcessed::SPIRVModuleProcessed(SPIRVModule *M,
     const std::string &SS)
   :SPIRVEntryNoId(M, 1 + getSizeInWords(SS)), Str(SS){}
 
-void SPIRVModuleProcessed::decode(std::istream &I) {
+void SPIRVModuleProcessed::decode(SPIRVInputStream &I) {
   getDecoder(I) >> Str;
 }
 
@@ -43,6 +43,7 @@
 #include "SPIRVEnum.h"
 #include "SPIRVError.h"
 #include "SPIRVIsValidEnum.h"
+#include "llvm/Support/Allocator.h"
 #include <cassert>
 #include <iostream>
 #include <map>
@@ -58,6 +59,7 @@ namespace SPIRV {
 class SPIRVModule;
 class SPIRVEncoder;
 class SPIRVDecoder;
+class SPIRVInputStream;
 class SPIRVType;
 class SPIRVValue;
 class SPIRVDecorate;
@@ -70,7 +72,7 @@ class SPIRVExtInst;
 // Add declaration of decode functions to a class.
 // Used inside class definition.
 #define _SPIRV_DCL_DECODE                                                      \
-  void decode(std::istream &I) override;
+  void decode(SPIRVInputStream &I) override;
 
 #define _REQ_SPIRV_VER(Version)                                                \
   SPIRVWord getRequiredSPIRVVersion() const override { return Version; }
@@ -78,35 +80,35 @@ class SPIRVExtInst;
 // Add implementation of decode functions to a class.
 // Used out side of class definition.
 #define _SPIRV_IMP_DECODE0(Ty)                                                 \
-  void Ty::decode(std::istream &I) {}
+  void Ty::decode(SPIRVInputStream &I) {}
 #define _SPIRV_IMP_DECODE1(Ty, x)                                              \
-  void Ty::decode(std::istream &I) { getDecoder(I) >> (x); }
+  void Ty::decode(SPIRVInputStream &I) { getDecoder(I) >> (x); }
 #define _SPIRV_IMP_ENCDEC2(Ty, x, y)                                           \
-  void Ty::decode(std::istream &I) { getDecoder(I) >> (x) >> (y); }
+  void Ty::decode(SPIRVInputStream &I) { getDecoder(I) >> (x) >> (y); }
 #define _SPIRV_IMP_DECODE3(Ty, x, y, z)                                        \
-  void Ty::decode(std::istream &I) { getDecoder(I) >> (x) >> (y) >> (z); }
+  void Ty::decode(SPIRVInputStream &I) { getDecoder(I) >> (x) >> (y) >> (z); }
 #define _SPIRV_IMP_DECODE4(Ty, x, y, z, u)                                     \
-  void Ty::decode(std::istream &I) {                                           \
+  void Ty::decode(SPIRVInputStream &I) {                                           \
     getDecoder(I) >> (x) >> (y) >> (z) >> (u);                                 \
   }
 #define _SPIRV_IMP_DECODE5(Ty, x, y, z, u, v)                                  \
-  void Ty::decode(std::istream &I) {                                           \
+  void Ty::decode(SPIRVInputStream &I) {                                           \
     getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v);                          \
   }
 #define _SPIRV_IMP_DECODE6(Ty, x, y, z, u, v, w)                               \
-  void Ty::decode(std::istream &I) {                                           \
+  void Ty::decode(SPIRVInputStream &I) {                                           \
     getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w);                   \
   }
 #define _SPIRV_IMP_DECODE7(Ty, x, y, z, u, v, w, r)                            \
-  void Ty::decode(std::istream &I) {                                           \
+  void Ty::decode(SPIRVInputStream &I) {                                           \
     getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r);            \
   }
 #define _SPIRV_IMP_DECODE8(Ty, x, y, z, u, v, w, r, s)                         \
-  void Ty::decode(std::istream &I) {                                           \
+  void Ty::decode(SPIRVInputStream &I) {                                           \
     getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r) >> (s);     \
   }
 #define _SPIRV_IMP_DECODE9(Ty, x, y, z, u, v, w, r, s, t)                      \
-  void Ty::decode(std::istream &I) {                                           \
+  void Ty::decode(SPIRVInputStream &I) {                                           \
     getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r) >> (s) >>   \
         (t);                                                                   \
   }
@@ -114,35 +116,35 @@ class SPIRVExtInst;
 // Add definition of encode/decode functions to a class.
 // Used inside class definition.
 #define _SPIRV_DEF_DECODE0                                                     \
-  void decode(std::istream &I) override {}
+  void decode(SPIRVInputStream &I) override {}
 #define _SPIRV_DEF_DECODE1(x)                                                  \
-  void decode(std::istream &I) override { getDecoder(I) >> (x); }
+  void decode(SPIRVInputStream &I) override { getDecoder(I) >> (x); }
 #define _SPIRV_DEF_DECODE2(x, y)                                               \
-  void decode(std::istream &I) override { getDecoder(I) >> (x) >> (y); }
+  void decode(SPIRVInputStream &I) override { getDecoder(I) >> (x) >> (y); }
 #define _SPIRV_DEF_DECODE3(x, y, z)                                            \
-  void decode(std::istream &I) override { getDecoder(I) >> (x) >> (y) >> (z); }
+  void decode(SPIRVInputStream &I) override { getDecoder(I) >> (x) >> (y) >> (z); }
 #define _SPIRV_DEF_DECODE4(x, y, z, u)                                         \
-  void decode(std::istream &I) override {                                      \
+  void decode(SPIRVInputStream &I) override {                                      \
     getDecoder(I) >> (x) >> (y) >> (z) >> (u);                                 \
   }
 #define _SPIRV_DEF_DECODE5(x, y, z, u, v)                                      \
-  void decode(std::istream &I) override {                                      \
+  void decode(SPIRVInputStream &I) override {                                      \
     getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v);                          \
   }
 #define _SPIRV_DEF_DECODE6(x, y, z, u, v, w)                                   \
-  void decode(std::istream &I) override {                                      \
+  void decode(SPIRVInputStream &I) override {                                      \
     getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w);                   \
   }
 #define _SPIRV_DEF_DECODE7(x, y, z, u, v, w, r)                                \
-  void decode(std::istream &I) override {                                      \
+  void decode(SPIRVInputStream &I) override {                                      \
     getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r);            \
   }
 #define _SPIRV_DEF_DECODE8(x, y, z, u, v, w, r, s)                             \
-  void decode(std::istream &I) override {                                      \
+  void decode(SPIRVInputStream &I) override {                                      \
     getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r) >> (s);     \
   }
 #define _SPIRV_DEF_DECODE9(x, y, z, u, v, w, r, s, t)                          \
-  void decode(std::istream &I) override {                                      \
+  void decode(SPIRVInputStream &I) override {                                      \
     getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r) >> (s) >>   \
         (t);                                                                   \
   }
@@ -160,7 +162,7 @@ class SPIRVExtInst;
 ///    It is usually called by SPIRVEntry::make(opcode) to create an incomplete
 ///    object which should not be validated. Then setWordCount(count) is
 ///    called to fix the size of the object if it is variable, and then the
-///    information is filled by the virtual function decode(istream).
+///    information is filled by the virtual function decode(SPIRVInputStream).
 ///    After that the object can be validated.
 ///
 /// To add a new SPIRV class:
@@ -188,6 +190,7 @@ public:
     SPIRVEA_DEFAULT = 0,
     SPIRVEA_NOID = 1,   // Entry has no valid id
     SPIRVEA_NOTYPE = 2, // Value has no type
+    SPIRVEA_ARENA = 4,  // Entry is allocated from its module's arena
   };
 
   // Complete constructor for objects with id
@@ -227,7 +230,7 @@ public:
   SPIRVType *getValueType(SPIRVId TheId) const;
   std::vector<SPIRVType *> getValueTypes(const std::vector<SPIRVId> &) const;
 
-  virtual SPIRVDecoder getDecoder(std::istream &);
+  virtual SPIRVDecoder getDecoder(SPIRVInputStream &);
   SPIRVErrorLog &getErrorLog() const;
   SPIRVId getId() const {
     assert(hasId());
@@ -245,6 +248,7 @@ public:
                          size_t Index = 0, SPIRVWord *Result = 0) const;
   std::set<SPIRVWord> getDecorate(Decoration Kind, size_t Index = 0) const;
   bool hasId() const { return !(Attrib & SPIRVEA_NOID); }
+  bool isArenaAllocated() const { return Attrib & SPIRVEA_ARENA; }
   bool hasLine() const { return Line != nullptr; }
   bool hasLinkageType() const;
   bool isAtomic() const { return isAtomicOpCode(OpCode); }
@@ -295,12 +299,17 @@ public:
   static SPIRVEntry *create(Op);
   static std::unique_ptr<SPIRVEntry> createUnique(Op);
 
+  /// Create an empty SPIRV object by op code in memory from an arena. The
+  /// object is destroyed by calling its destructor, and its memory is released
+  /// with the arena.
+  static SPIRVEntry *create(Op, llvm::BumpPtrAllocator &Arena);
+
   /// Create an empty extended instruction.
   static std::unique_ptr<SPIRVExtInst> createUnique(SPIRVExtInstSetKind Set,
                                                     unsigned ExtOp);
 
-  friend std::istream &operator>>(std::istream &I, SPIRVEntry &E);
-  virtual void decode(std::istream &I);
+  friend SPIRVInputStream &operator>>(SPIRVInputStream &I, SPIRVEntry &E);
+  virtual void decode(SPIRVInputStream &I);
 
   friend class SPIRVDecoder;
 
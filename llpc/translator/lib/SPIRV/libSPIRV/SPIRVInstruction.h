@@ -333,7 +333,7 @@ public:
   void setHasVariableWordCount(bool VariWC) { HasVariWC = VariWC; }
 
 protected:
-  void decode(std::istream &I) override {
+  void decode(SPIRVInputStream &I) override {
     auto D = getDecoder(I);
     if (hasType())
       D >> Type;
@@ -625,7 +625,7 @@ protected:
     MemoryAccess.resize(TheWordCount - FixedWords);
   }
 
-  void decode(std::istream &I) override {
+  void decode(SPIRVInputStream &I) override {
     getDecoder(I) >> PtrId >> ValId >> MemoryAccess;
     memoryAccessUpdate(MemoryAccess);
   }
@@ -678,7 +678,7 @@ protected:
     MemoryAccess.resize(TheWordCount - FixedWords);
   }
 
-  void decode(std::istream &I) override {
+  void decode(SPIRVInputStream &I) override {
     getDecoder(I) >> Type >> Id >> PtrId >> MemoryAccess;
     memoryAccessUpdate(MemoryAccess);
   }
@@ -1693,7 +1693,7 @@ public:
             ExtSetKind == SPIRVEIS_NonSemanticInfo) &&
            "not supported");
   }
-  void decode(std::istream &I) override {
+  void decode(SPIRVInputStream &I) override {
     getDecoder(I) >> Type >> Id >> ExtSetId;
     setExtSetKindById();
     switch (ExtSetKind) {
@@ -2020,7 +2020,7 @@ protected:
     MemoryAccess.resize(TheWordCount - FixedWords);
   }
 
-  void decode(std::istream &I) override {
+  void decode(SPIRVInputStream &I) override {
     getDecoder(I) >> Target >> Source >> MemoryAccess;
     memoryAccessUpdate(MemoryAccess);
   }
@@ -2074,7 +2074,7 @@ protected:
     MemoryAccess.resize(TheWordCount - FixedWords);
   }
 
-  void decode(std::istream &I) override {
+  void decode(SPIRVInputStream &I) override {
     getDecoder(I) >> Target >> Source >> Size >> MemoryAccess;
     memoryAccessUpdate(MemoryAccess);
   }
@@ -2455,6 +2455,7 @@ public:
     assert(MappedConst == nullptr && "OpSpecConstantOp mapped twice");
     MappedConst = Const;
   }
+  void unmapConstant() { MappedConst = nullptr; }
 protected:
   // NOTE: Mapped constant stores the value of OpSpecConstantOp after
   // evaluation by constant folding.
@@ -167,9 +167,15 @@ public:
 
   void setSPIRVVersion(SPIRVWord Ver) override { SPIRVVersion = Ver; }
 
+  // Specialization functions
+  bool hasSpecConstants() const override;
+  void beginSpecialization() override;
+  void endSpecialization() override;
+
   // Object creation functions
   template <class T> void addTo(std::vector<T *> &V, SPIRVEntry *E);
   SPIRVEntry *addEntry(SPIRVEntry *E) override;
+  SPIRVEntry *createEntry(Op OC) override;
   SPIRVBasicBlock *addBasicBlock(SPIRVFunction *, SPIRVId) override;
   SPIRVString *getString(const std::string &Str) override;
   SPIRVMemberName *addMemberName(SPIRVTypeStruct *ST, SPIRVWord MemberNumber,
@@ -337,7 +343,7 @@ public:
                                                SPIRVBasicBlock *) override;
 
   // Input functions
-  friend std::istream &operator>>(std::istream &I, SPIRVModule &M);
+  friend SPIRVInputStream &operator>>(SPIRVInputStream &I, SPIRVModule &M);
 
 private:
   SPIRVErrorLog ErrLog;
@@ -353,9 +359,7 @@ private:
   SPIRVAddressingModelKind AddrModel;
   SPIRVMemoryModelKind MemoryModel;
 
-  typedef std::map<SPIRVId, SPIRVEntry *> SPIRVIdToEntryMap;
   typedef std::vector<SPIRVEntry *> SPIRVEntryVector;
-  typedef std::set<SPIRVId> SPIRVIdSet;
   typedef std::vector<SPIRVId> SPIRVIdVec;
   typedef std::vector<SPIRVFunction *> SPIRVFunctionVector;
   typedef std::vector<SPIRVTypeForwardPointer *> SPIRVForwardPointerVec;
@@ -367,20 +371,19 @@ private:
   typedef std::vector<SPIRVDecorationGroup *> SPIRVDecGroupVec;
   typedef std::vector<SPIRVGroupDecorateGeneric *> SPIRVGroupDecVec;
   typedef std::vector<SPIRVEntryPoint *> SPIRVEnetryPointVec;
-  typedef std::map<SPIRVId, SPIRVExtInstSetKind> SPIRVIdToBuiltinSetMap;
+  typedef std::vector<SPIRVExtInstSetKind> SPIRVBuiltinSetVector;
   typedef std::unordered_map<std::string, SPIRVString *> SPIRVStringMap;
   typedef std::map<SPIRVTypeStruct *, std::vector<std::pair<unsigned, SPIRVId>>>
       SPIRVUnknownStructFieldMap;
 
   SPIRVForwardPointerVec ForwardPointerVec;
   SPIRVTypeVec TypeVec;
-  SPIRVIdToEntryMap IdEntryMap;
+  SPIRVEntryVector IdEntryVec;        // Entries indexed by id
   SPIRVFunctionVector FuncVec;
   SPIRVConstantVector ConstVec;
   SPIRVVariableVec VariableVec;
   SPIRVEntryVector EntryNoId;         // Entries without id
-  SPIRVIdToBuiltinSetMap IdBuiltinMap;
-  SPIRVIdSet NamedId;
+  SPIRVBuiltinSetVector IdBuiltinVec; // Builtin sets indexed by id
   SPIRVStringVec StringVec;
   SPIRVMemberNameVec MemberNameVec;
   std::shared_ptr<const SPIRVLine> CurrentLine;
@@ -391,16 +394,26 @@ private:
   SPIRVStringMap StrMap;
   SPIRVCapMap CapMap;
   SPIRVUnknownStructFieldMap UnknownStructFieldMap;
-  std::map<unsigned, SPIRVTypeInt *> IntTypeMap;
-  std::map<unsigned, SPIRVConstant *> LiteralMap;
+  std::unordered_map<unsigned, SPIRVTypeInt *> IntTypeMap;
+  std::unordered_map<unsigned, SPIRVConstant *> LiteralMap;
+  llvm::BumpPtrAllocator EntryArena; // Memory of the decoded entries
+
+  // State saved by beginSpecialization() and restored by endSpecialization()
+  SPIRVId SpecNextId = SPIRVID_INVALID;
+  unsigned SpecConstCount = 0;
+  unsigned SpecTypeCount = 0;
+  std::vector<std::pair<SPIRVValue *, uint64_t>> SpecDefaults;
 
   void layoutEntry(SPIRVEntry *Entry);
+  void destroyEntry(SPIRVEntry *Entry);
 };
 
 SPIRVModuleImpl::~SPIRVModuleImpl() {
 
-  for (auto I : IdEntryMap)
-    delete I.second;
+  for (auto I : IdEntryVec) {
+    if (I)
+      destroyEntry(I);
+  }
 
   for (auto I : EntryNoId) {
     if (I->getOpCode() == OpLine)
@@ -410,7 +423,7 @@ SPIRVModuleImpl::~SPIRVModuleImpl() {
       // entry (often itself, a cyclic reference).
       I->setLine(nullptr);
     else
-      delete I;
+      destroyEntry(I);
   }
 
   for (auto C : CapMap)
@@ -490,6 +503,101 @@ void SPIRVModuleImpl::addCapabilityInternal(SPIRVCapabilityKind Cap) {
   }
 }
 
+bool SPIRVModuleImpl::hasSpecConstants() const {
+  for (auto C : ConstVec) {
+    switch (C->getOpCode()) {
+    case OpSpecConstantTrue:
+    case OpSpecConstantFalse:
+    case OpSpecConstant:
+    case OpSpecConstantComposite:
+    case OpSpecConstantOp:
+      return true;
+    default:
+      break;
+    }
+  }
+  return false;
+}
+
+// Records the parsed values of the specialization constants and the extent of
+// the module, so that endSpecialization() can undo what a translation changed.
+void SPIRVModuleImpl::beginSpecialization() {
+  SpecNextId = NextId;
+  SpecConstCount = ConstVec.size();
+  SpecTypeCount = TypeVec.size();
+  SpecDefaults.clear();
+  for (auto C : ConstVec) {
+    switch (C->getOpCode()) {
+    case OpSpecConstant:
+      SpecDefaults.push_back(
+          {C, static_cast<SPIRVConstant *>(C)->getZExtIntValue()});
+      break;
+    case OpSpecConstantTrue:
+      SpecDefaults.push_back(
+          {C, static_cast<SPIRVSpecConstantTrue *>(C)->getBoolValue()});
+      break;
+    case OpSpecConstantFalse:
+      SpecDefaults.push_back(
+          {C, static_cast<SPIRVSpecConstantFalse *>(C)->getBoolValue()});
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+// Restores the specialization constants to their parsed values, unmaps the
+// evaluated OpSpecConstantOp and removes the constants (and the integer type
+// they may have needed) that were created by constant folding.
+void SPIRVModuleImpl::endSpecialization() {
+  assert(SpecNextId != SPIRVID_INVALID && "Specialization not begun");
+  for (auto &Default : SpecDefaults) {
+    auto C = Default.first;
+    switch (C->getOpCode()) {
+    case OpSpecConstant:
+      static_cast<SPIRVConstant *>(C)->setZExtIntValue(Default.second);
+      break;
+    case OpSpecConstantTrue:
+      static_cast<SPIRVSpecConstantTrue *>(C)->setBoolValue(Default.second);
+      break;
+    case OpSpecConstantFalse:
+      static_cast<SPIRVSpecConstantFalse *>(C)->setBoolValue(Default.second);
+      break;
+    default:
+      llvm_unreachable("Invalid op code");
+    }
+  }
+  SpecDefaults.clear();
+
+  for (unsigned I = 0; I < SpecConstCount; ++I) {
+    if (ConstVec[I]->getOpCode() == OpSpecConstantOp)
+      static_cast<SPIRVSpecConstantOp *>(ConstVec[I])->unmapConstant();
+  }
+
+  for (auto I = LiteralMap.begin(); I != LiteralMap.end();) {
+    if (I->second->getId() >= SpecNextId)
+      I = LiteralMap.erase(I);
+    else
+      ++I;
+  }
+  for (auto I = IntTypeMap.begin(); I != IntTypeMap.end();) {
+    if (I->second->getId() >= SpecNextId)
+      I = IntTypeMap.erase(I);
+    else
+      ++I;
+  }
+  for (SPIRVId Id = SpecNextId; Id < IdEntryVec.size(); ++Id) {
+    if (IdEntryVec[Id])
+      destroyEntry(IdEntryVec[Id]);
+  }
+  if (IdEntryVec.size() > SpecNextId)
+    IdEntryVec.resize(SpecNextId);
+  ConstVec.resize(SpecConstCount);
+  TypeVec.resize(SpecTypeCount);
+  NextId = SpecNextId;
+  SpecNextId = SPIRVID_INVALID;
+}
+
 SPIRVConstant *SPIRVModuleImpl::getLiteralAsConstant(unsigned Literal) {
   auto Loc = LiteralMap.find(Literal);
   if (Loc != LiteralMap.end())
@@ -524,6 +632,22 @@ void SPIRVModuleImpl::layoutEntry(SPIRVEntry *E) {
   }
 }
 
+// Destroys an entry, which is either allocated from the arena or on the heap.
+void SPIRVModuleImpl::destroyEntry(SPIRVEntry *Entry) {
+  if (Entry->isArenaAllocated())
+    Entry->~SPIRVEntry();
+  else
+    delete Entry;
+}
+
+// Creates an empty entry for decoding. Entries are allocated from the arena,
+// except OpLine, which is owned by the shared pointers that refer to it.
+SPIRVEntry *SPIRVModuleImpl::createEntry(Op OC) {
+  if (OC == OpLine)
+    return SPIRVEntry::create(OC);
+  return SPIRVEntry::create(OC, EntryArena);
+}
+
 // Add an entry to the id to entry map.
 // Assert if the id is mapped to a different entry.
 // Certain entries need to be add to specific collectors to maintain
@@ -543,8 +667,11 @@ SPIRVEntry *SPIRVModuleImpl::addEntry(SPIRVEntry *Entry) {
       } else {
         assert(Mapped == Entry && "Id used twice");
       }
-    } else
-      IdEntryMap[Id] = Entry;
+    } else {
+      if (Id >= IdEntryVec.size())
+        IdEntryVec.resize(Id + 1, nullptr);
+      IdEntryVec[Id] = Entry;
+    }
   } else {
     if (EntryNoId.empty() || Entry !=  EntryNoId.back())
       EntryNoId.push_back(Entry);
@@ -571,11 +698,10 @@ bool SPIRVModuleImpl::exist(SPIRVId Id) const { return exist(Id, nullptr); }
 
 bool SPIRVModuleImpl::exist(SPIRVId Id, SPIRVEntry **Entry) const {
   assert(Id != SPIRVID_INVALID && "Invalid Id");
-  SPIRVIdToEntryMap::const_iterator Loc = IdEntryMap.find(Id);
-  if (Loc == IdEntryMap.end())
+  if (Id >= IdEntryVec.size() || !IdEntryVec[Id])
     return false;
   if (Entry)
-    *Entry = Loc->second;
+    *Entry = IdEntryVec[Id];
   return true;
 }
 
@@ -592,15 +718,14 @@ SPIRVId SPIRVModuleImpl::getId(SPIRVId Id, unsigned Increment) {
 
 SPIRVEntry *SPIRVModuleImpl::getEntry(SPIRVId Id) const {
   assert(Id != SPIRVID_INVALID && "Invalid Id");
-  SPIRVIdToEntryMap::const_iterator Loc = IdEntryMap.find(Id);
-  assert(Loc != IdEntryMap.end() && "Id is not in map");
-  return Loc->second;
+  assert(Id < IdEntryVec.size() && IdEntryVec[Id] && "Id is not in map");
+  return IdEntryVec[Id];
 }
 
 SPIRVExtInstSetKind SPIRVModuleImpl::getBuiltinSet(SPIRVId SetId) const {
-  auto Loc = IdBuiltinMap.find(SetId);
-  assert(Loc != IdBuiltinMap.end() && "Invalid builtin set id");
-  return Loc->second;
+  assert(SetId < IdBuiltinVec.size() && IdBuiltinVec[SetId] != SPIRVEIS_Count &&
+         "Invalid builtin set id");
+  return IdBuiltinVec[SetId];
 }
 
 SPIRVEntryPoint* SPIRVModuleImpl::getEntryPoint(SPIRVId EP) const {
@@ -647,18 +772,14 @@ bool SPIRVModuleImpl::importBuiltinSetWithId(const std::string &BuiltinSetName,
   else
     SPIRVCKRT(SPIRVBuiltinSetNameMap::rfind(BuiltinSetName, &BuiltinSet),
               InvalidBuiltinSetName, "Actual is " + BuiltinSetName);
-  IdBuiltinMap[BuiltinSetId] = BuiltinSet;
+  if (BuiltinSetId >= IdBuiltinVec.size())
+    IdBuiltinVec.resize(BuiltinSetId + 1, SPIRVEIS_Count);
+  IdBuiltinVec[BuiltinSetId] = BuiltinSet;
   return true;
 }
 
 void SPIRVModuleImpl::setName(SPIRVEntry *E, const std::string &Name) {
   E->setName(Name);
-  if (!E->hasId())
-    return;
-  if (!Name.empty())
-    NamedId.insert(E->getId());
-  else
-    NamedId.erase(E->getId());
 }
 
 void SPIRVModuleImpl::resolveUnknownStructFields() {
@@ -815,17 +936,16 @@ SPIRVEntry *SPIRVModuleImpl::replaceForward(SPIRVForward *Forward,
   SPIRVId Id = Entry->getId();
   SPIRVId ForwardId = Forward->getId();
   if (ForwardId == Id)
-    IdEntryMap[Id] = Entry;
+    IdEntryVec[Id] = Entry;
   else {
-    auto Loc = IdEntryMap.find(Id);
-    assert(Loc != IdEntryMap.end());
-    IdEntryMap.erase(Loc);
+    assert(Id < IdEntryVec.size() && IdEntryVec[Id]);
+    IdEntryVec[Id] = nullptr;
     Entry->setId(ForwardId);
-    IdEntryMap[ForwardId] = Entry;
+    IdEntryVec[ForwardId] = Entry;
   }
   // Annotations include name, decorations, execution modes
   Entry->takeAnnotations(Forward);
-  delete Forward;
+  destroyEntry(Forward);
   return Entry;
 }
 
@@ -840,10 +960,9 @@ void SPIRVModuleImpl::eraseInstruction(SPIRVInstruction *I,
                                        SPIRVBasicBlock *BB) {
   SPIRVId Id = I->getId();
   BB->eraseInstruction(I);
-  auto Loc = IdEntryMap.find(Id);
-  assert(Loc != IdEntryMap.end());
-  IdEntryMap.erase(Loc);
-  delete I;
+  assert(Id < IdEntryVec.size() && IdEntryVec[Id]);
+  IdEntryVec[Id] = nullptr;
+  destroyEntry(I);
 }
 
 SPIRVValue *SPIRVModuleImpl::addConstant(SPIRVValue *C) { return add(C); }
@@ -1234,7 +1353,7 @@ void SPIRVModuleImpl::addUnknownStructField(SPIRVTypeStruct *Struct, unsigned I,
   UnknownStructFieldMap[Struct].push_back(std::make_pair(I, ID));
 }
 
-std::istream &operator>>(std::istream &I, SPIRVModule &M) {
+SPIRVInputStream &operator>>(SPIRVInputStream &I, SPIRVModule &M) {
   SPIRVDecoder Decoder(I, M);
   SPIRVModuleImpl &MI = *static_cast<SPIRVModuleImpl *>(&M);
   // Disable automatic capability filling.
@@ -1254,6 +1373,10 @@ std::istream &operator>>(std::istream &I, SPIRVModule &M) {
 
   // Bound for Id
   Decoder >> MI.NextId;
+  // Ids are dense, so the id-indexed tables are sized from the bound up front.
+  // A bound beyond the size of the binary is not trusted for that; the tables
+  // still grow as ids are added.
+  MI.IdEntryVec.resize(std::min<size_t>(MI.NextId, I.getWordCount()), nullptr);
 
   Decoder >> MI.InstSchema;
   assert(MI.InstSchema == SPIRVISCH_Default &&
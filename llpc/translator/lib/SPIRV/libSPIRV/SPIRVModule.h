@@ -155,6 +155,16 @@ public:
   virtual void resolveUnknownStructFields() = 0;
   virtual void setSPIRVVersion(SPIRVWord) = 0;
 
+  // Specialization functions
+  // Translation writes specialization constant values into the module and
+  // folds OpSpecConstantOp into newly added constants. A module that is
+  // translated more than once brackets each translation with these calls so
+  // that it is returned to its parsed state afterwards. Translation still adds
+  // constants for literal operands to any module (see getLiteralAsConstant).
+  virtual bool hasSpecConstants() const = 0;
+  virtual void beginSpecialization() = 0;
+  virtual void endSpecialization() = 0;
+
   void setMinSPIRVVersion(SPIRVWord Ver) {
     setSPIRVVersion(std::max(Ver, getSPIRVVersion()));
   }
@@ -165,6 +175,7 @@ public:
     return Entry;
   }
   virtual SPIRVEntry *addEntry(SPIRVEntry *) = 0;
+  virtual SPIRVEntry *createEntry(Op) = 0;
   virtual SPIRVBasicBlock *addBasicBlock(SPIRVFunction *,
                                          SPIRVId Id = SPIRVID_INVALID) = 0;
   virtual SPIRVString *getString(const std::string &Str) = 0;
@@ -340,7 +351,7 @@ public:
                                                        SPIRVValue *,
                                                        SPIRVBasicBlock *) = 0;
   // Input functions
-  friend std::istream &operator>>(std::istream &I, SPIRVModule &M);
+  friend SPIRVInputStream &operator>>(SPIRVInputStream &I, SPIRVModule &M);
 
 protected:
   bool AutoAddCapability;
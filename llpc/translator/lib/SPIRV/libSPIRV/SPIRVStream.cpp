@@ -41,14 +41,15 @@
 #include "SPIRVFunction.h"
 #include "SPIRVNameMapEnum.h"
 #include "SPIRVOpCode.h"
+#include <cstring>
 
 namespace SPIRV {
 
-SPIRVDecoder::SPIRVDecoder(std::istream &InputStream, SPIRVFunction &F)
+SPIRVDecoder::SPIRVDecoder(SPIRVInputStream &InputStream, SPIRVFunction &F)
     : IS(InputStream), M(*F.getModule()), WordCount(0), OpCode(OpNop),
       Scope(&F) {}
 
-SPIRVDecoder::SPIRVDecoder(std::istream &InputStream, SPIRVBasicBlock &BB)
+SPIRVDecoder::SPIRVDecoder(SPIRVInputStream &InputStream, SPIRVBasicBlock &BB)
     : IS(InputStream), M(*BB.getModule()), WordCount(0), OpCode(OpNop),
       Scope(&BB) {}
 
@@ -73,21 +74,28 @@ SPIRV_DEF_ENCDEC(Decoration)
 SPIRV_DEF_ENCDEC(GLSLExtOpKind)
 SPIRV_DEF_ENCDEC(LinkageType)
 
+void SPIRVInputStream::readString(std::string &Str) {
+  const char *StrBegin = reinterpret_cast<const char *>(Cur);
+  const char *Limit = reinterpret_cast<const char *>(End);
+  auto StrEnd = static_cast<const char *>(memchr(StrBegin, '\0', Limit - StrBegin));
+  if (!StrEnd) {
+    Str.append(StrBegin, Limit);
+    Cur = End;
+    Failed = true;
+    return;
+  }
+  Str.append(StrBegin, StrEnd);
+  // Skip the nul and the padding up to the next word.
+  Cur += (StrEnd - StrBegin) / sizeof(SPIRVWord) + 1;
+  assert(std::all_of(StrEnd, reinterpret_cast<const char *>(Cur),
+                     [](char Ch) { return Ch == '\0'; }) &&
+         "Invalid string in SPIRV");
+}
+
 // Read a string with padded 0's at the end so that they form a stream of
 // words.
 const SPIRVDecoder &operator>>(const SPIRVDecoder &I, std::string &Str) {
-  uint64_t Count = 0;
-  char Ch;
-  while (I.IS.get(Ch) && Ch != '\0') {
-    Str += Ch;
-    ++Count;
-  }
-  Count = (Count + 1) % 4;
-  Count = Count ? 4 - Count : 0;
-  for (; Count; --Count) {
-    I.IS >> Ch;
-    assert(Ch == '\0' && "Invalid string in SPIRV");
-  }
+  I.IS.readString(Str);
   return I;
 }
 
@@ -101,7 +109,6 @@ bool SPIRVDecoder::getWordCountAndOpCode() {
   *this >> WordCountAndOpCode;
   WordCount = WordCountAndOpCode >> 16;
   OpCode = static_cast<Op>(WordCountAndOpCode & 0xFFFF);
-  assert(!IS.bad() && "SPIRV stream is bad");
   if (IS.fail()) {
     WordCount = 0;
     OpCode = OpNop;
@@ -113,7 +120,7 @@ bool SPIRVDecoder::getWordCountAndOpCode() {
 SPIRVEntry *SPIRVDecoder::getEntry() {
   if (WordCount == 0 || OpCode == OpNop)
     return nullptr;
-  SPIRVEntry *Entry = SPIRVEntry::create(OpCode);
+  SPIRVEntry *Entry = M.createEntry(OpCode);
   assert(Entry);
   Entry->setModule(&M);
   if (!Scope && (isModuleScopeAllowedOpCode(OpCode) || OpCode == OpExtInst)) {
@@ -124,7 +131,7 @@ SPIRVEntry *SPIRVDecoder::getEntry() {
   IS >> *Entry;
   if(Entry->isEndOfBlock() || OpCode == OpNoLine)
     M.setCurrentLine(nullptr);
-  assert(!IS.bad() && !IS.fail() && "SPIRV stream fails");
+  assert(!IS.fail() && "SPIRV stream fails");
   M.add(Entry);
   return Entry;
 }
@@ -132,7 +139,7 @@ SPIRVEntry *SPIRVDecoder::getEntry() {
 void SPIRVDecoder::validate() const {
   assert(OpCode != OpNop && "Invalid op code");
   assert(WordCount && "Invalid word count");
-  assert(!IS.bad() && "Bad iInput stream");
+  assert(!IS.fail() && "Bad input stream");
 }
 
 } // namespace SPIRV
@@ -55,19 +55,54 @@ namespace SPIRV {
 class SPIRVFunction;
 class SPIRVBasicBlock;
 
+/// Read-only stream over the words of a SPIR-V binary in memory. The binary is
+/// decoded in place, without being copied.
+class SPIRVInputStream {
+public:
+  SPIRVInputStream(const SPIRVWord *Words, size_t WordCount)
+      : Begin(Words), Cur(Words), End(Words + WordCount), Failed(false) {}
+
+  /// Reads the next word. Reading past the end sets the fail state and yields 0.
+  SPIRVWord readWord() {
+    if (Cur == End) {
+      Failed = true;
+      return 0;
+    }
+    return *Cur++;
+  }
+
+  /// Reads a nul-terminated string, padded with nuls to a word boundary.
+  void readString(std::string &Str);
+
+  /// Gets the offset of the next word from the start of the binary, in bytes.
+  size_t tellg() const { return (Cur - Begin) * sizeof(SPIRVWord); }
+
+  bool eof() const { return Cur == End; }
+  bool fail() const { return Failed; }
+
+  /// Gets the size of the whole binary, in words.
+  size_t getWordCount() const { return End - Begin; }
+
+private:
+  const SPIRVWord *Begin;
+  const SPIRVWord *Cur;
+  const SPIRVWord *End;
+  bool Failed;
+};
+
 class SPIRVDecoder {
 public:
-  SPIRVDecoder(std::istream &InputStream, SPIRVModule &Module)
+  SPIRVDecoder(SPIRVInputStream &InputStream, SPIRVModule &Module)
       : IS(InputStream), M(Module), WordCount(0), OpCode(OpNop), Scope(NULL) {}
-  SPIRVDecoder(std::istream &InputStream, SPIRVFunction &F);
-  SPIRVDecoder(std::istream &InputStream, SPIRVBasicBlock &BB);
+  SPIRVDecoder(SPIRVInputStream &InputStream, SPIRVFunction &F);
+  SPIRVDecoder(SPIRVInputStream &InputStream, SPIRVBasicBlock &BB);
 
   void setScope(SPIRVEntry *);
   bool getWordCountAndOpCode();
   SPIRVEntry *getEntry();
   void validate() const;
 
-  std::istream &IS;
+  SPIRVInputStream &IS;
   SPIRVModule &M;
   SPIRVWord WordCount;
   Op OpCode;
@@ -76,9 +111,7 @@ public:
 
 template <typename T>
 const SPIRVDecoder &decodeBinary(const SPIRVDecoder &I, T &V) {
-  uint32_t W;
-  I.IS.read(reinterpret_cast<char *>(&W), sizeof(W));
-  V = static_cast<T>(W);
+  V = static_cast<T>(I.IS.readWord());
   return I;
 }
 
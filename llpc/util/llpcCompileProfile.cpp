@@ -0,0 +1,223 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcCompileProfile.cpp
+ * @brief LLPC source file: contains implementation of class Llpc::CompileProfile.
+ ***********************************************************************************************************************
+ */
+#include "llpcCompileProfile.h"
+#include "llpcDebug.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cinttypes>
+
+using namespace llvm;
+
+namespace llvm {
+
+namespace cl {
+
+// -compile-profile-file: file to append the compile-time profile of each build to, as JSON lines
+static opt<std::string> CompileProfileFile("compile-profile-file",
+                                           desc("Append the compile-time profile of each pipeline and shader module "
+                                                "build to the file, one JSON object per line (\"-\" for stdout)"),
+                                           value_desc("filename"), init(""));
+
+} // namespace cl
+
+} // namespace llvm
+
+namespace Llpc {
+
+// Mutex to serialize writing out profiles
+static ManagedStatic<sys::Mutex> SProfileMutex;
+
+// =====================================================================================================================
+// Gets the stream to write profiles to, opening the file on first use. Returns nullptr if it cannot be opened. The
+// caller must hold SProfileMutex.
+static raw_ostream *getProfileStream() {
+  static raw_ostream *ProfileStream = nullptr;
+  static bool OpenFailed = false;
+  if (!ProfileStream && !OpenFailed) {
+    if (cl::CompileProfileFile == "-")
+      ProfileStream = &outs();
+    else {
+      std::error_code errCode;
+      static raw_fd_ostream ProfileFile(cl::CompileProfileFile.c_str(), errCode, sys::fs::F_Append | sys::fs::F_Text);
+      if (errCode) {
+        LLPC_ERRS("Failed to open compile profile file: " << cl::CompileProfileFile << "\n");
+        OpenFailed = true;
+      } else
+        ProfileStream = &ProfileFile;
+    }
+  }
+  return ProfileStream;
+}
+
+// =====================================================================================================================
+// Formats a 64-bit hash the way LLPC prints pipeline hashes elsewhere.
+//
+// @param hash : Hash to format
+static std::string formatHash(uint64_t hash) {
+  std::string hashString;
+  raw_string_ostream(hashString) << format("0x%016" PRIX64, hash);
+  return hashString;
+}
+
+// =====================================================================================================================
+// Creates a profile for a build, if -compile-profile-file is set. Returns nullptr otherwise.
+//
+// @param buildKind : Kind of build ("graphics", "compute", "shader-module")
+// @param hash : Pipeline or shader module hash to key the profile by
+std::unique_ptr<CompileProfile> CompileProfile::create(const char *buildKind, uint64_t hash) {
+  if (cl::CompileProfileFile.empty())
+    return nullptr;
+  return std::make_unique<CompileProfile>(buildKind, hash);
+}
+
+// =====================================================================================================================
+//
+// @param buildKind : Kind of build ("graphics", "compute", "shader-module")
+// @param hash : Pipeline or shader module hash to key the profile by
+CompileProfile::CompileProfile(const char *buildKind, uint64_t hash)
+    : m_buildKind(buildKind), m_hash(hash), m_cacheResult(CompileProfileCacheResult::None),
+      m_startTime(TimeRecord::getCurrentTime(true)) {
+  sampleMemory();
+}
+
+// =====================================================================================================================
+// Adds the time accumulated by a phase timer to the named phase. A phase that is timed more than once in a build
+// (such as once per shader stage) accumulates.
+//
+// @param phaseName : Name of the phase
+// @param time : Time accumulated by the phase timer
+void CompileProfile::addPhaseTime(StringRef phaseName, const TimeRecord &time) {
+  auto phase = std::find_if(m_phases.begin(), m_phases.end(),
+                            [phaseName](const TimeEntry &entry) { return entry.name == phaseName; });
+  if (phase == m_phases.end())
+    phase = m_phases.insert(m_phases.end(), {phaseName.str(), 0.0, 0.0});
+  phase->wallTime += time.getWallTime();
+  phase->cpuTime += time.getUserTime() + time.getSystemTime();
+}
+
+// =====================================================================================================================
+// Adds the IR instruction count of a module to the count at the named phase boundary.
+//
+// @param boundaryName : Name of the phase boundary, such as "translate" for the end of SPIR-V translation
+// @param module : Module to count the instructions of
+void CompileProfile::addIrInstCount(StringRef boundaryName, const Module &module) {
+  auto boundary = std::find_if(m_irInstCounts.begin(), m_irInstCounts.end(),
+                               [boundaryName](const IrInstCount &entry) { return entry.boundaryName == boundaryName; });
+  if (boundary == m_irInstCounts.end())
+    boundary = m_irInstCounts.insert(m_irInstCounts.end(), {boundaryName.str(), 0});
+  boundary->instCount += module.getInstructionCount();
+  sampleMemory();
+}
+
+// =====================================================================================================================
+// Samples the malloc usage of the process, to keep track of the peak during the build. With several builds running
+// at once, the usage is that of all of them.
+void CompileProfile::sampleMemory() {
+  m_peakMallocUsage = std::max(m_peakMallocUsage, sys::Process::GetMallocUsage());
+}
+
+// =====================================================================================================================
+// Records a run of a pass (lgc::PassProfiler).
+//
+// @param passName : Name of the pass
+// @param stats : Statistics of the run
+void CompileProfile::passRun(StringRef passName, const lgc::PassRunStats &stats) {
+  m_passes.push_back({passName.str(), stats});
+  sampleMemory();
+}
+
+// =====================================================================================================================
+// Finishes the profile, and appends it to the profile file as one line of JSON.
+CompileProfile::~CompileProfile() {
+  TimeRecord endTime = TimeRecord::getCurrentTime(false);
+  sampleMemory();
+
+  static const char *const CacheResultNames[] = {"none", "hit", "miss"};
+  std::string line;
+  raw_string_ostream lineStream(line);
+  {
+    json::OStream json(lineStream);
+    auto writeTime = [&json](const TimeEntry &entry) {
+      json.attribute("wallTime", entry.wallTime);
+      json.attribute("cpuTime", entry.cpuTime);
+    };
+
+    json.object([&] {
+      json.attribute("kind", m_buildKind);
+      json.attribute("hash", formatHash(m_hash));
+      json.attribute("cacheHash", formatHash(m_cacheHash));
+      json.attribute("cache", CacheResultNames[static_cast<unsigned>(m_cacheResult)]);
+      json.attribute("result", static_cast<int>(m_result));
+      writeTime({"", endTime.getWallTime() - m_startTime.getWallTime(),
+                 (endTime.getUserTime() - m_startTime.getUserTime()) +
+                     (endTime.getSystemTime() - m_startTime.getSystemTime())});
+      json.attribute("peakMallocUsage", static_cast<int64_t>(m_peakMallocUsage));
+      json.attribute("elfSize", static_cast<int64_t>(m_elfSize));
+      json.attributeObject("phases", [&] {
+        for (const TimeEntry &phase : m_phases)
+          json.attributeObject(phase.name, [&] { writeTime(phase); });
+      });
+      json.attributeObject("irInstCounts", [&] {
+        for (const IrInstCount &boundary : m_irInstCounts)
+          json.attribute(boundary.boundaryName, static_cast<int64_t>(boundary.instCount));
+      });
+      json.attributeArray("passes", [&] {
+        for (const PassEntry &pass : m_passes) {
+          json.object([&] {
+            json.attribute("name", pass.name);
+            json.attribute("wallTime", pass.stats.wallTime);
+            json.attribute("cpuTime", pass.stats.cpuTime);
+            json.attribute("instCountDelta", pass.stats.instCountDelta);
+            json.attribute("blockCountDelta", pass.stats.blockCountDelta);
+          });
+        }
+      });
+    });
+  }
+  lineStream << "\n";
+  lineStream.flush();
+
+  sys::ScopedLock lock(*SProfileMutex);
+  if (raw_ostream *profileStream = getProfileStream()) {
+    *profileStream << line;
+    profileStream->flush();
+  }
+}
+
+} // namespace Llpc
@@ -0,0 +1,131 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcCompileProfile.h
+ * @brief LLPC header file: contains declaration of class Llpc::CompileProfile.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include "llpc.h"
+#include "lgc/PassManager.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Timer.h"
+#include <memory>
+#include <string>
+
+namespace llvm {
+
+class Module;
+
+} // namespace llvm
+
+namespace Llpc {
+
+// Enumerates the outcomes of the shader cache lookup for a build.
+enum class CompileProfileCacheResult : unsigned {
+  None, // The build did not look in the shader cache
+  Hit,  // The result came from the shader cache
+  Miss, // The result was compiled (and, if possible, added to the shader cache)
+};
+
+// =====================================================================================================================
+// Represents the compile-time profile of one pipeline or shader module build. It collects the time taken by each
+// compilation phase and each profiled pass, the change in IR size made by each pass, the IR instruction count at phase
+// boundaries, the peak malloc usage seen and the shader cache outcome. When it is destroyed at the end of the build, it
+// is written as one JSON object per line to the file named by -compile-profile-file, keyed by the pipeline (or shader
+// module) hash. It should be created before any TimerProfiler that adds to it, so that the phase times are in by then.
+//
+// A profile is only used by the thread doing the build. Writing it out is thread-safe.
+class CompileProfile : public lgc::PassProfiler {
+public:
+  // Creates a profile for a build, if -compile-profile-file is set. Returns nullptr otherwise.
+  static std::unique_ptr<CompileProfile> create(const char *buildKind, uint64_t hash);
+
+  CompileProfile(const char *buildKind, uint64_t hash);
+  ~CompileProfile() override;
+
+  // Sets the cache hash and the outcome of the shader cache lookup
+  void setCacheResult(uint64_t cacheHash, CompileProfileCacheResult cacheResult) {
+    m_cacheHash = cacheHash;
+    m_cacheResult = cacheResult;
+  }
+
+  // Adds the time accumulated by a phase timer to the named phase
+  void addPhaseTime(llvm::StringRef phaseName, const llvm::TimeRecord &time);
+
+  // Adds the IR instruction count of a module to the count at the named phase boundary
+  void addIrInstCount(llvm::StringRef boundaryName, const llvm::Module &module);
+
+  // Sets the size of the output ELF
+  void setElfSize(size_t elfSize) { m_elfSize = elfSize; }
+
+  // Samples the malloc usage, to keep track of the peak
+  void sampleMemory();
+
+  // lgc::PassProfiler
+  void passRun(llvm::StringRef passName, const lgc::PassRunStats &stats) override;
+
+  // Sets the result of the build
+  void setResult(Result result) { m_result = result; }
+
+private:
+  CompileProfile(const CompileProfile &) = delete;
+  CompileProfile &operator=(const CompileProfile &) = delete;
+
+  // Represents the time taken by a phase
+  struct TimeEntry {
+    std::string name; // Name of the phase
+    double wallTime;  // Wall-clock time, in seconds
+    double cpuTime;   // User plus system CPU time, in seconds
+  };
+
+  // Represents one run of a profiled pass
+  struct PassEntry {
+    std::string name;        // Name of the pass
+    lgc::PassRunStats stats; // Statistics of the run
+  };
+
+  // Represents the IR instruction count at a phase boundary
+  struct IrInstCount {
+    std::string boundaryName; // Name of the phase boundary
+    uint64_t instCount;       // Count of IR instructions, summed over modules
+  };
+
+  const char *m_buildKind;                          // Kind of build ("graphics", "compute", ...)
+  uint64_t m_hash;                                  // Pipeline or shader module hash
+  uint64_t m_cacheHash = 0;                         // Cache hash
+  CompileProfileCacheResult m_cacheResult;          // Outcome of the shader cache lookup
+  llvm::TimeRecord m_startTime;                     // Time the build started
+  llvm::SmallVector<TimeEntry, 8> m_phases;         // Time taken by each phase, in the order first seen
+  std::vector<PassEntry> m_passes;                  // Each run of a profiled pass, in run order
+  llvm::SmallVector<IrInstCount, 4> m_irInstCounts; // IR instruction count at each phase boundary
+  size_t m_elfSize = 0;                             // Size of the output ELF, 0 if none
+  size_t m_peakMallocUsage = 0;                     // Peak malloc usage of the process seen
+  Result m_result = Result::Success;                // Result of the build
+};
+
+} // namespace Llpc
@@ -0,0 +1,266 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcCompression.cpp
+ * @brief LLPC source file: contains implementation of the data compression utility functions.
+ ***********************************************************************************************************************
+ */
+#include "llpcCompression.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#define DEBUG_TYPE "llpc-compression"
+
+namespace Llpc {
+
+// The LZ4 block format encodes the data as a sequence of literal runs, each followed by a match that copies earlier
+// output. Its end-of-block rules: the last five bytes are always literals, and the last match starts at least twelve
+// bytes before the end of the block.
+static constexpr size_t Lz4MinMatch = 4;
+static constexpr size_t Lz4LastLiterals = 5;
+static constexpr size_t Lz4MatchFindLimit = 12;
+static constexpr size_t Lz4MaxOffset = 65535;
+
+// Number of bits of the hash of a four byte sequence, used to index the table of previous positions
+static constexpr unsigned Lz4HashBits = 12;
+
+// =====================================================================================================================
+// Reads four unaligned bytes
+//
+// @param p : Pointer to the bytes
+static uint32_t read32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+// =====================================================================================================================
+// Hashes a four byte sequence into an index of the table of previous positions
+//
+// @param sequence : Four byte sequence
+static unsigned hashSequence(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - Lz4HashBits);
+}
+
+// =====================================================================================================================
+// Writes a length that does not fit in its token nibble as a run of 255s ended by a smaller byte. Returns the new
+// output position, or nullptr if the output is full.
+//
+// @param op : Output position
+// @param oend : End of the output
+// @param length : Length minus the 15 stored in the token
+static uint8_t *writeLength(uint8_t *op, uint8_t *oend, size_t length) {
+  for (; length >= 255; length -= 255) {
+    if (op == oend)
+      return nullptr;
+    *op++ = 255;
+  }
+  if (op == oend)
+    return nullptr;
+  *op++ = static_cast<uint8_t>(length);
+  return op;
+}
+
+// =====================================================================================================================
+// Writes one sequence: a run of literals, followed by a match unless this is the last sequence. Returns the new
+// output position, or nullptr if the output is full.
+//
+// @param op : Output position
+// @param oend : End of the output
+// @param literals : Start of the literals
+// @param literalLength : Number of literals
+// @param offset : Distance back to the start of the match, or 0 for the last sequence
+// @param matchLength : Length of the match
+static uint8_t *writeSequence(uint8_t *op, uint8_t *oend, const uint8_t *literals, size_t literalLength,
+                              size_t offset, size_t matchLength) {
+  if (op == oend)
+    return nullptr;
+  uint8_t *token = op++;
+  *token = static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4);
+  if (literalLength >= 15 && !(op = writeLength(op, oend, literalLength - 15)))
+    return nullptr;
+  if (static_cast<size_t>(oend - op) < literalLength)
+    return nullptr;
+  memcpy(op, literals, literalLength);
+  op += literalLength;
+
+  if (offset == 0)
+    return op;
+
+  if (oend - op < 2)
+    return nullptr;
+  *op++ = static_cast<uint8_t>(offset);
+  *op++ = static_cast<uint8_t>(offset >> 8);
+  matchLength -= Lz4MinMatch;
+  *token |= static_cast<uint8_t>(std::min<size_t>(matchLength, 15));
+  if (matchLength >= 15 && !(op = writeLength(op, oend, matchLength - 15)))
+    return nullptr;
+  return op;
+}
+
+// =====================================================================================================================
+// Reads a length continued after its token nibble. Returns false if the input ends first.
+//
+// @param [in,out] ip : Input position
+// @param iend : End of the input
+// @param [in,out] length : Length, to which the continuation bytes are added
+static bool readLength(const uint8_t *&ip, const uint8_t *iend, size_t &length) {
+  uint8_t byte = 0;
+  do {
+    if (ip == iend)
+      return false;
+    byte = *ip++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// =====================================================================================================================
+// Gets the worst case size of the LZ4 compressed form of the specified number of bytes, which is when the data is
+// stored as literals only.
+//
+// @param srcSize : Size of the data to compress
+size_t lz4CompressBound(size_t srcSize) {
+  return srcSize + srcSize / 255 + 16;
+}
+
+// =====================================================================================================================
+// Compresses data into the LZ4 block format, with a single-probe hash table of previous positions. This favors speed
+// over ratio, and is meant for data that has many repeats, like ELF metadata and symbol tables. Returns the compressed
+// size, or 0 if it does not fit in the destination; a capacity of lz4CompressBound(srcSize) always suffices.
+//
+// @param src : Data to compress
+// @param srcSize : Size of the data to compress
+// @param [out] dst : Buffer for the compressed data
+// @param dstCapacity : Size of the buffer
+size_t lz4Compress(const void *src, size_t srcSize, void *dst, size_t dstCapacity) {
+  const uint8_t *const base = static_cast<const uint8_t *>(src);
+  const uint8_t *const iend = base + srcSize;
+  uint8_t *op = static_cast<uint8_t *>(dst);
+  uint8_t *const oend = op + dstCapacity;
+
+  const uint8_t *ip = base;
+  const uint8_t *anchor = base;
+  if (srcSize > Lz4MatchFindLimit) {
+    const uint8_t *const matchFindLimit = iend - Lz4MatchFindLimit;
+    const uint8_t *const matchLimit = iend - Lz4LastLiterals;
+    uint32_t previous[1 << Lz4HashBits] = {};
+
+    while (ip < matchFindLimit) {
+      const uint32_t sequence = read32(ip);
+      const unsigned hash = hashSequence(sequence);
+      const uint8_t *ref = base + previous[hash];
+      previous[hash] = static_cast<uint32_t>(ip - base);
+
+      if (ref >= ip || static_cast<size_t>(ip - ref) > Lz4MaxOffset || read32(ref) != sequence) {
+        ++ip;
+        continue;
+      }
+
+      // Extend the match forwards, but never into the trailing literals.
+      const size_t offset = ip - ref;
+      const uint8_t *matchEnd = ip + Lz4MinMatch;
+      ref += Lz4MinMatch;
+      while (matchEnd < matchLimit && *matchEnd == *ref) {
+        ++matchEnd;
+        ++ref;
+      }
+
+      op = writeSequence(op, oend, anchor, ip - anchor, offset, matchEnd - ip);
+      if (!op)
+        return 0;
+      ip = matchEnd;
+      anchor = ip;
+    }
+  }
+
+  op = writeSequence(op, oend, anchor, iend - anchor, 0, 0);
+  if (!op)
+    return 0;
+  return op - static_cast<uint8_t *>(dst);
+}
+
+// =====================================================================================================================
+// Decompresses an LZ4 block, checking every length and offset against the bounds of the input and output. Returns false
+// if the block is malformed or does not decompress to exactly dstSize bytes.
+//
+// @param src : Compressed data
+// @param srcSize : Size of the compressed data
+// @param [out] dst : Buffer for the decompressed data
+// @param dstSize : Size of the decompressed data
+bool lz4Decompress(const void *src, size_t srcSize, void *dst, size_t dstSize) {
+  const uint8_t *ip = static_cast<const uint8_t *>(src);
+  const uint8_t *const iend = ip + srcSize;
+  uint8_t *const base = static_cast<uint8_t *>(dst);
+  uint8_t *op = base;
+  uint8_t *const oend = op + dstSize;
+
+  while (ip < iend) {
+    const uint8_t token = *ip++;
+
+    size_t literalLength = token >> 4;
+    if (literalLength == 15 && !readLength(ip, iend, literalLength))
+      return false;
+    if (literalLength > static_cast<size_t>(iend - ip) || literalLength > static_cast<size_t>(oend - op))
+      return false;
+    memcpy(op, ip, literalLength);
+    op += literalLength;
+    ip += literalLength;
+
+    // The last sequence has no match.
+    if (ip == iend)
+      break;
+
+    if (iend - ip < 2)
+      return false;
+    const size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<size_t>(op - base))
+      return false;
+
+    size_t matchLength = token & 15;
+    if (matchLength == 15 && !readLength(ip, iend, matchLength))
+      return false;
+    matchLength += Lz4MinMatch;
+    if (matchLength > static_cast<size_t>(oend - op))
+      return false;
+
+    // A match that overlaps the bytes it produces repeats them, so it has to be copied byte by byte.
+    const uint8_t *match = op - offset;
+    if (offset >= matchLength)
+      memcpy(op, match, matchLength);
+    else {
+      for (size_t i = 0; i < matchLength; ++i)
+        op[i] = match[i];
+    }
+    op += matchLength;
+  }
+
+  return op == oend;
+}
+
+} // namespace Llpc
@@ -0,0 +1,52 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcCompression.h
+ * @brief LLPC header file: contains declarations of the data compression utility functions.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include <cstddef>
+
+namespace Llpc {
+
+// Enumerates the codecs data can be compressed with.
+enum class CompressionCodec : unsigned {
+  None = 0, // Not compressed
+  Lz4 = 1,  // LZ4 block format
+};
+
+// Gets the worst case size of the LZ4 compressed form of the specified number of bytes
+size_t lz4CompressBound(size_t srcSize);
+
+// Compresses data into the LZ4 block format. Returns the compressed size, or 0 if it does not fit in the destination.
+size_t lz4Compress(const void *src, size_t srcSize, void *dst, size_t dstCapacity);
+
+// Decompresses an LZ4 block. Returns false if the block is malformed or does not decompress to exactly dstSize bytes.
+bool lz4Decompress(const void *src, size_t srcSize, void *dst, size_t dstSize);
+
+} // namespace Llpc
@@ -40,23 +40,6 @@
 using namespace llvm;
 using namespace Vkgc;
 
-namespace {
-
-// R_AMDGPU_ABS32 is only used in asserts, so it is unused in release builds, which does not work well with -Werror.
-// Therefore, this is a define instead of a constexpr.
-#define R_AMDGPU_ABS32 6
-// Descriptor size
-static constexpr unsigned DescriptorSizeResource = 8 * sizeof(unsigned);
-static constexpr unsigned DescriptorSizeSampler = 4 * sizeof(unsigned);
-
-// Represent a relocation entry. Used internally for pipeline linking.
-struct RelocationEntry {
-  Vkgc::ElfReloc reloc; // The relocation entry from the ELF
-  const char *name;     // Name of the symbol associated with the relocation
-};
-
-} // namespace
-
 namespace Llpc {
 // The names of API shader stages used in PAL metadata, in ShaderStage order.
 static const char *const ApiStageNames[] = {".vertex", ".hull", ".domain", ".geometry", ".pixel", ".compute"};
@@ -1053,405 +1036,6 @@ template <class Elf> void ElfWriter<Elf>::reinitialize() {
   m_map[NoteName] = m_noteSecIdx;
 }
 
-// =====================================================================================================================
-// Retrieves the actual descriptor offset at the specified binding from UserDataNode.
-//
-// @param descSet : DescriptorSet index of the resource
-// @param binding : Binding slot of the resource
-// @param nodeType : Type of resource requested by the shader
-// @param nodes: The UserDataNode provided at runtime
-// @param nodeCount : Number of resource nodes in UserDataNode
-static unsigned getDescriptorResourceOffset(unsigned descSet, unsigned binding, ResourceMappingNodeType nodeType,
-                                            const ResourceMappingNode *nodes, unsigned nodeCount) {
-  for (unsigned i = 0; i < nodeCount; ++i) {
-    const ResourceMappingNode *resource = nodes + i;
-
-    if (resource->type == ResourceMappingNodeType::DescriptorTableVaPtr) {
-      unsigned offset = getDescriptorResourceOffset(descSet, binding, nodeType, resource->tablePtr.pNext,
-                                                    resource->tablePtr.nodeCount);
-      if (offset != InvalidValue) {
-        return offset;
-      }
-      continue;
-    }
-    if (resource->type > ResourceMappingNodeType::DescriptorBuffer) {
-      continue;
-    }
-    if (resource->srdRange.set != descSet || resource->srdRange.binding != binding) {
-      continue;
-    }
-
-    if (nodeType == ResourceMappingNodeType::DescriptorSampler &&
-        resource->type == ResourceMappingNodeType::DescriptorCombinedTexture) {
-      return (resource->offsetInDwords + 8) * sizeof(unsigned); // Offset by DescriptorSizeResource.
-    } else {
-      return (resource->offsetInDwords) * sizeof(unsigned);
-    }
-  }
-  return InvalidValue;
-}
-
-// =====================================================================================================================
-// Retrieves the actual descriptor stride at the specified binding from UserDataNode.
-//
-// @param descSet : DescriptorSet index of the resource
-// @param binding : Binding slot of the resource
-// @param nodes : The UserDataNode provided at runtime
-// @param nodeCount : Number of resource nodes in UserDataNode
-static unsigned getDescriptorResourceStride(unsigned descSet, unsigned binding, const ResourceMappingNode *nodes,
-                                            unsigned nodeCount) {
-  for (unsigned i = 0; i < nodeCount; ++i) {
-    const ResourceMappingNode *resource = nodes + i;
-
-    if (resource->type == ResourceMappingNodeType::DescriptorTableVaPtr) {
-      unsigned offset =
-          getDescriptorResourceStride(descSet, binding, resource->tablePtr.pNext, resource->tablePtr.nodeCount);
-      if (offset != InvalidValue) {
-        return offset;
-      }
-      continue;
-    }
-    if (resource->type > ResourceMappingNodeType::DescriptorBuffer) {
-      continue;
-    }
-    if (resource->srdRange.set != descSet || resource->srdRange.binding != binding) {
-      continue;
-    }
-
-    switch (resource->type) {
-    case ResourceMappingNodeType::DescriptorSampler:
-      return DescriptorSizeSampler;
-      break;
-    case ResourceMappingNodeType::DescriptorResource:
-    case ResourceMappingNodeType::DescriptorFmask:
-      return DescriptorSizeResource;
-    case ResourceMappingNodeType::DescriptorCombinedTexture:
-      return (DescriptorSizeResource + DescriptorSizeSampler);
-    default:
-      llvm_unreachable("Unexpected resource node type");
-      break;
-    }
-  }
-  return InvalidValue;
-}
-
-// =====================================================================================================================
-// Get value for a descriptor offset relocation (doff_x_y_t symbol).
-//
-// @param context : [in] Pipeline compilation context
-// @param relocEntry : The relocation entry to fixup
-// @param isGraphicsPipeline : Whether we are processing a compute or graphics pipeline
-// @param value : [out] The value of the relocation
-bool getDescriptorOffsetRelocationValue(Context *context, RelocationEntry relocEntry, bool isGraphicsPipeline,
-                                        unsigned *value) {
-  size_t idx = 0;
-  const char *relocName = relocEntry.name + 5;
-  unsigned descSet = std::stoi(relocName, &idx);
-  relocName += idx + 1;
-  idx = 0;
-  unsigned binding = std::stoi(relocName, &idx);
-  relocName += idx + 1;
-  ResourceMappingNodeType type = ResourceMappingNodeType::Unknown;
-  switch (*relocName) {
-  case 's':
-    type = ResourceMappingNodeType::DescriptorSampler;
-    break;
-  case 'r':
-    type = ResourceMappingNodeType::DescriptorResource;
-    break;
-  case 'b':
-    type = ResourceMappingNodeType::DescriptorBuffer;
-    break;
-  }
-
-  if (isGraphicsPipeline) {
-    auto pipelineInfo = reinterpret_cast<const GraphicsPipelineBuildInfo *>(context->getPipelineBuildInfo());
-    *value = getDescriptorResourceOffset(descSet, binding, type, pipelineInfo->vs.pUserDataNodes,
-                                         pipelineInfo->vs.userDataNodeCount);
-    if (*value == InvalidValue) {
-      *value = getDescriptorResourceOffset(descSet, binding, type, pipelineInfo->fs.pUserDataNodes,
-                                           pipelineInfo->fs.userDataNodeCount);
-    }
-  } else {
-    auto pipelineInfo = reinterpret_cast<const ComputePipelineBuildInfo *>(context->getPipelineBuildInfo());
-    *value = getDescriptorResourceOffset(descSet, binding, type, pipelineInfo->cs.pUserDataNodes,
-                                         pipelineInfo->cs.userDataNodeCount);
-  }
-
-  return *value != InvalidValue;
-}
-
-// =====================================================================================================================
-// Get value for a descriptor stride relocation (dstride_x_y symbol).
-//
-// @param context : [in] Pipeline compilation context
-// @param relocEntry : The relocation entry to fixup
-// @param isGraphicsPipeline : Whether we are processing a compute or graphics pipeline
-// @param value : [out] The value of the relocation
-bool getDescriptorStrideRelocationValue(Context *context, RelocationEntry relocEntry, bool isGraphicsPipeline,
-                                        unsigned *value) {
-  size_t idx = 0;
-  const char *relocName = relocEntry.name + 8;
-  unsigned descSet = std::stoi(relocName, &idx);
-  relocName += idx + 1;
-  idx = 0;
-  unsigned binding = std::stoi(relocName, &idx);
-  relocName += idx + 1;
-
-  if (isGraphicsPipeline) {
-    auto pipelineInfo = reinterpret_cast<const GraphicsPipelineBuildInfo *>(context->getPipelineBuildInfo());
-    *value = getDescriptorResourceStride(descSet, binding, pipelineInfo->vs.pUserDataNodes,
-                                         pipelineInfo->vs.userDataNodeCount);
-    if (*value == InvalidValue) {
-      *value = getDescriptorResourceStride(descSet, binding, pipelineInfo->fs.pUserDataNodes,
-                                           pipelineInfo->fs.userDataNodeCount);
-    }
-  } else {
-    auto pipelineInfo = reinterpret_cast<const ComputePipelineBuildInfo *>(context->getPipelineBuildInfo());
-    *value = getDescriptorResourceStride(descSet, binding, pipelineInfo->cs.pUserDataNodes,
-                                         pipelineInfo->cs.userDataNodeCount);
-  }
-
-  return *value != InvalidValue;
-}
-
-// =====================================================================================================================
-// Get value a device index relocation ($deviceIdx symbol).
-//
-// @param context : [in] Pipeline compilation context
-// @param relocEntry : The relocation entry to fixup
-// @param isGraphicsPipeline : Whether we are processing a compute or graphics pipeline
-// @param value : [out] The value of the relocation
-bool getDeviceIndexRelocationValue(Context *context, RelocationEntry relocEntry, bool isGraphicsPipeline,
-                                   unsigned *value) {
-  auto pipelineBuildInfo = context->getPipelineContext()->getPipelineBuildInfo();
-  if (isGraphicsPipeline) {
-    *value = static_cast<const GraphicsPipelineBuildInfo *>(pipelineBuildInfo)->iaState.deviceIndex;
-  } else {
-    *value = static_cast<const ComputePipelineBuildInfo *>(pipelineBuildInfo)->deviceIndex;
-  }
-  return true;
-}
-
-// =====================================================================================================================
-// Get value of a numSamples relocation ($numSamples symbol).
-//
-// @param context : [in] Pipeline compilation context
-// @param relocEntry : The relocation entry to fixup
-// @param isGraphicsPipeline : Whether we are processing a compute or graphics pipeline
-// @param value : [out] The value of the relocation
-bool getNumSamplesRelocationValue(Context *context, RelocationEntry relocEntry, bool isGraphicsPipeline,
-                                  unsigned *value) {
-  auto pipelineBuildInfo = context->getPipelineContext()->getPipelineBuildInfo();
-  assert(isGraphicsPipeline && "numSamples relocation is for graphics pipeline only.");
-  *value = static_cast<const GraphicsPipelineBuildInfo *>(pipelineBuildInfo)->rsState.numSamples;
-  return true;
-}
-
-// =====================================================================================================================
-// Get value of a numSamples relocation ($samplePatternIdx symbol).
-//
-// @param context : [in] Pipeline compilation context
-// @param relocEntry : The relocation entry to fixup
-// @param isGraphicsPipeline : Whether we are processing a compute or graphics pipeline
-// @param value : [out] The value of the relocation
-bool getSamplePatternIdxRelocationValue(Context *context, RelocationEntry relocEntry, bool isGraphicsPipeline,
-                                        unsigned *value) {
-  auto pipelineBuildInfo = context->getPipelineContext()->getPipelineBuildInfo();
-  assert(isGraphicsPipeline && "samplePatternIdx relocation is for graphics pipeline only.");
-  *value = static_cast<const GraphicsPipelineBuildInfo *>(pipelineBuildInfo)->rsState.samplePatternIdx;
-  return true;
-}
-
-// =====================================================================================================================
-// Get the value of a relocation symbol. Returns true if success, and false if the symbol is unknown.
-//
-// @param context : [in] Pipeline compilation context
-// @param relocEntry : The relocation entry to fixup
-// @param isGraphicsPipeline : Whether we are processing a compute or graphics pipeline
-// @param value : [out] The value of the relocation
-bool getRelocationSymbolValue(Context *context, RelocationEntry relocEntry, bool isGraphicsPipeline, unsigned *value) {
-  if (strncmp(relocEntry.name, "doff_", 5) == 0) {
-    return getDescriptorOffsetRelocationValue(context, relocEntry, isGraphicsPipeline, value);
-  } else if (strncmp(relocEntry.name, "dstride_", 8) == 0) {
-    return getDescriptorStrideRelocationValue(context, relocEntry, isGraphicsPipeline, value);
-  } else if (strcmp(relocEntry.name, "$deviceIdx") == 0) {
-    return getDeviceIndexRelocationValue(context, relocEntry, isGraphicsPipeline, value);
-  } else if (strcmp(relocEntry.name, "$numSamples") == 0) {
-    return getNumSamplesRelocationValue(context, relocEntry, isGraphicsPipeline, value);
-  } else if (strcmp(relocEntry.name, "$samplePatternIdx") == 0) {
-    return getSamplePatternIdxRelocationValue(context, relocEntry, isGraphicsPipeline, value);
-  }
-  return false;
-}
-
-// =====================================================================================================================
-// Fixup relocations in the ELF with actual values.
-//
-// @param writer : [in,out] Writer to target ELF
-// @param relocations : [in] Relocation entries
-// @param context : [in] Pipeline compilation context
-// @param isGraphicsPipeline : Whether we are processing a compute or graphics pipeline
-template <class Elf>
-void fixUpRelocations(ElfWriter<Elf> *writer, const std::vector<RelocationEntry> &relocations, Context *context,
-                      bool isGraphicsPipeline) {
-  char *data = nullptr;
-  size_t dataLength = 0;
-  writer->getSectionData(TextName, const_cast<const void **>(reinterpret_cast<void **>(&data)), &dataLength);
-
-  for (unsigned i = 0; i < relocations.size(); ++i) {
-    auto &reloc = relocations[i];
-    unsigned relocationValue = 0;
-    if (getRelocationSymbolValue(context, reloc, isGraphicsPipeline, &relocationValue)) {
-      assert(data != nullptr && dataLength >= reloc.reloc.offset);
-      assert(reloc.reloc.type == R_AMDGPU_ABS32 && "can only handle R_AMDGPU_ABS32 typed relocations.");
-      unsigned *targetDword = reinterpret_cast<unsigned *>(data + reloc.reloc.offset);
-      if (reloc.reloc.useExplicitAddend) {
-        *targetDword = relocationValue + reloc.reloc.addend;
-      } else {
-        *targetDword += relocationValue;
-      }
-    } else {
-      llvm_unreachable("Unknown relocation entry.");
-    }
-  }
-}
-
-// =====================================================================================================================
-// Link the relocatable ELF readers into a pipeline ELF.
-//
-// @param relocatableElfs : An array of relocatable ELF objects
-// @param context : Acquired context
-template <class Elf>
-Result ElfWriter<Elf>::linkGraphicsRelocatableElf(const ArrayRef<ElfReader<Elf> *> &relocatableElfs, Context *context) {
-  reinitialize();
-  assert(relocatableElfs.size() == 2 && "Can only handle VsPs Shaders for now.");
-
-  // Get the main data for the header, the parts that change will be updated when writing to buffer.
-  m_header = relocatableElfs[0]->getHeader();
-
-  // Copy the contents of the string table
-  ElfSectionBuffer<typename Elf::SectionHeader> *stringTable1 = nullptr;
-  relocatableElfs[0]->getSectionDataBySectionIndex(relocatableElfs[0]->getStrtabSecIdx(), &stringTable1);
-
-  ElfSectionBuffer<typename Elf::SectionHeader> *stringTable2 = nullptr;
-  relocatableElfs[1]->getSectionDataBySectionIndex(relocatableElfs[1]->getStrtabSecIdx(), &stringTable2);
-
-  mergeSection(stringTable1, stringTable1->secHead.sh_size, nullptr, stringTable2, 0, nullptr,
-               &m_sections[m_strtabSecIdx]);
-
-  // Merge text sections
-  ElfSectionBuffer<typename Elf::SectionHeader> *textSection1 = nullptr;
-  relocatableElfs[0]->getTextSectionData(&textSection1);
-  ElfSectionBuffer<typename Elf::SectionHeader> *textSection2 = nullptr;
-  relocatableElfs[1]->getTextSectionData(&textSection2);
-
-  mergeSection(textSection1, alignTo(textSection1->secHead.sh_size, 0x100), nullptr, textSection2, 0, nullptr,
-               &m_sections[m_textSecIdx]);
-
-  // Build the symbol table.  First set the symbol table section header.
-  ElfSectionBuffer<typename Elf::SectionHeader> *symbolTableSection = nullptr;
-  relocatableElfs[0]->getSectionDataBySectionIndex(relocatableElfs[0]->getSymSecIdx(), &symbolTableSection);
-  m_sections[m_symSecIdx].secHead = symbolTableSection->secHead;
-
-  // Now get the symbols that belong in the symbol table.
-  unsigned offset = 0;
-  std::vector<RelocationEntry> relocations;
-
-  // Insert a dummy symbol. The ELF spec requires the symbol table to begin with a dummy symbol.
-  getSymbol("")->secIdx = 0;
-
-  for (const ElfReader<Elf> *elf : relocatableElfs) {
-    unsigned relocElfTextSectionId = elf->GetSectionIndex(TextName);
-    std::vector<ElfSymbol> symbols;
-    elf->GetSymbolsBySectionIndex(relocElfTextSectionId, symbols);
-    for (auto sym : symbols) {
-      if (strncmp(sym.pSymName, "BB", 2) == 0) {
-        continue;
-      }
-      // When relocations start being used, we will have to filter out symbols related to relocations.
-      // We should be able to filter the BB* symbols as well.
-      ElfSymbol *newSym = getSymbol(sym.pSymName);
-      newSym->secIdx = m_textSecIdx;
-      newSym->secName = nullptr;
-      newSym->value = sym.value + offset;
-      newSym->size = sym.size;
-      newSym->info = sym.info;
-    }
-
-    // Copy and adjust all relocations.
-    auto relocationCount = elf->getRelocationCount();
-    for (unsigned i = 0; i < relocationCount; ++i) {
-      ElfReloc relocation = {};
-      RelocationEntry relocEntry = {};
-      elf->getRelocation(i, &relocation);
-      relocEntry.reloc = relocation;
-      relocEntry.reloc.offset += offset;
-      ElfSymbol symbol = {};
-      elf->getSymbol(relocation.symIdx, &symbol);
-      relocEntry.name = symbol.pSymName;
-      relocations.push_back(relocEntry);
-    }
-
-    // Update the offset for the next elf file.
-    ElfSectionBuffer<typename Elf::SectionHeader> *textSection = nullptr;
-    elf->getSectionDataBySectionIndex(relocElfTextSectionId, &textSection);
-    offset += alignTo(textSection->secHead.sh_size, 0x100);
-  }
-
-  // Apply relocations
-  fixUpRelocations(this, relocations, context, true);
-
-  // Set the .note section header
-  ElfSectionBuffer<typename Elf::SectionHeader> *noteSection = nullptr;
-  relocatableElfs[0]->getSectionDataBySectionIndex(relocatableElfs[0]->GetSectionIndex(NoteName), &noteSection);
-  m_sections[m_noteSecIdx].secHead = noteSection->secHead;
-
-  // Merge and update the .note data
-  // The merged note info will be updated using data in the pipeline create info, but nothing needs to be done yet.
-  ElfNote noteInfo1 = relocatableElfs[0]->getNote(Util::Abi::PipelineAbiNoteType::PalMetadata);
-  ElfNote noteInfo2 = relocatableElfs[1]->getNote(Util::Abi::PipelineAbiNoteType::PalMetadata);
-  m_notes.push_back({});
-  mergeMetaNote(context, &noteInfo1, &noteInfo2, &m_notes.back());
-
-  // Merge other sections.  For now, none of the other sections are important, so we will not do anything.
-
-  return Result::Success;
-}
-
-// =====================================================================================================================
-// Link the compute shader relocatable ELF reader into a pipeline ELF.
-//
-// @param relocatableElf : Relocatable compute shader elf
-// @param context : Acquired context
-template <class Elf>
-Result ElfWriter<Elf>::linkComputeRelocatableElf(const ElfReader<Elf> &relocatableElf, Context *context) {
-  // Currently nothing to do, just copy the elf.
-  copyFromReader(relocatableElf);
-
-  // Apply relocations
-  std::vector<RelocationEntry> relocations;
-  for (unsigned i = 0; i < relocatableElf.getRelocationCount(); ++i) {
-    ElfReloc relocation = {};
-    relocatableElf.getRelocation(i, &relocation);
-    RelocationEntry relocEntry = {};
-    ElfSymbol symbol = {};
-    relocatableElf.getSymbol(relocation.symIdx, &symbol);
-    relocEntry.name = symbol.pSymName;
-    relocEntry.reloc = relocation;
-    relocations.push_back(relocEntry);
-  }
-  fixUpRelocations(this, relocations, context, false);
-
-  // Update root descriptor register value in metadata note
-  ElfNote metadataNote = getNote(Util::Abi::PipelineAbiNoteType::PalMetadata);
-  ElfNote updatedNote;
-  updateMetaNote(context, &metadataNote, &updatedNote);
-  setNote(&updatedNote);
-
-  return Result::Success;
-}
-
 template class ElfWriter<Elf64>;
 
 } // namespace Llpc
@@ -111,10 +111,6 @@ public:
 
   void getRelocation(unsigned idx, Vkgc::ElfReloc *reloc);
 
-  Result linkGraphicsRelocatableElf(const llvm::ArrayRef<ElfReader<Elf> *> &relocatableElfs, Context *context);
-
-  Result linkComputeRelocatableElf(const ElfReader<Elf> &relocatableElf, Context *context);
-
 private:
   ElfWriter(const ElfWriter &) = delete;
   ElfWriter &operator=(const ElfWriter &) = delete;
@@ -0,0 +1,272 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcThreadPool.cpp
+ * @brief LLPC source file: contains implementation of class Llpc::ThreadPool and Llpc::TaskGroup.
+ ***********************************************************************************************************************
+ */
+#include "llpcThreadPool.h"
+#include <algorithm>
+#include <cassert>
+
+#define DEBUG_TYPE "llpc-thread-pool"
+
+namespace Llpc {
+
+// The pool and worker index of the worker running on this thread, if any
+static thread_local ThreadPool *CurrentPool = nullptr;
+static thread_local unsigned CurrentWorkerIndex = 0;
+
+// Priority of the task running on this thread, inherited by tasks it queues
+static thread_local TaskPriority CurrentPriority = TaskPriority::Normal;
+
+// =====================================================================================================================
+// Creates the pool with at least two workers, so that one of them is always left for tasks that are not background
+// tasks.
+//
+// @param threadCount : Count of worker threads (0 means one per hardware thread)
+ThreadPool::ThreadPool(unsigned threadCount) {
+  if (threadCount == 0)
+    threadCount = std::thread::hardware_concurrency();
+  threadCount = std::max(threadCount, 2u);
+  m_backgroundLimit = threadCount - 1;
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  for (unsigned workerIndex = 0; workerIndex < threadCount; ++workerIndex) {
+    m_workers.push_back(std::make_unique<Worker>());
+    m_workers.back()->thread = std::thread(&ThreadPool::workerMain, this, workerIndex);
+  }
+}
+
+// =====================================================================================================================
+// Finishes the queued tasks and stops the worker threads.
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_shutdown = true;
+  }
+  m_wakeUp.notify_all();
+  for (auto &worker : m_workers)
+    worker->thread.join();
+}
+
+// =====================================================================================================================
+// Queues a task that is not part of a group. It is run at the given priority, or at the priority of the task queueing
+// it if that is higher.
+//
+// @param func : Function to run
+// @param priority : Priority of the task
+void ThreadPool::async(std::function<void()> func, TaskPriority priority) {
+  auto task = std::make_shared<Task>();
+  task->func = std::move(func);
+  task->priority = std::max(priority, getCurrentPriority());
+  task->group = nullptr;
+  enqueue(std::move(task));
+}
+
+// =====================================================================================================================
+// Gets the priority of the task running on the calling thread, or normal priority outside of any task.
+TaskPriority ThreadPool::getCurrentPriority() {
+  return CurrentPriority;
+}
+
+// =====================================================================================================================
+// Queues a task on the calling worker's own queue, or on the shared queue when called from outside the pool.
+//
+// @param task : Task to queue
+void ThreadPool::enqueue(std::shared_ptr<Task> task) {
+  unsigned priority = static_cast<unsigned>(task->priority);
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (CurrentPool == this)
+      m_workers[CurrentWorkerIndex]->queues[priority].push_back(std::move(task));
+    else
+      m_queues[priority].push_back(std::move(task));
+    ++m_queuedCount[priority];
+  }
+  m_wakeUp.notify_one();
+}
+
+// =====================================================================================================================
+// Checks whether a worker can start a queued task. The caller must hold m_lock.
+bool ThreadPool::hasRunnableTask() const {
+  if (m_queuedCount[static_cast<unsigned>(TaskPriority::Foreground)] != 0 ||
+      m_queuedCount[static_cast<unsigned>(TaskPriority::Normal)] != 0)
+    return true;
+  return m_queuedCount[static_cast<unsigned>(TaskPriority::Background)] != 0 &&
+         (m_runningBackgroundCount < m_backgroundLimit || m_shutdown);
+}
+
+// =====================================================================================================================
+// Takes the queued task of highest priority for a worker: from its own queues newest first, then from the shared
+// queues, then stolen oldest first from another worker. The caller must hold m_lock.
+//
+// @param workerIndex : Index of the worker
+std::shared_ptr<ThreadPool::Task> ThreadPool::takeTask(unsigned workerIndex) {
+  for (unsigned priority = TaskPriorityCount; priority-- != 0;) {
+    if (m_queuedCount[priority] == 0)
+      continue;
+    if (priority == static_cast<unsigned>(TaskPriority::Background) &&
+        m_runningBackgroundCount >= m_backgroundLimit && !m_shutdown)
+      break;
+
+    std::shared_ptr<Task> task;
+    auto &ownQueue = m_workers[workerIndex]->queues[priority];
+    if (!ownQueue.empty()) {
+      task = std::move(ownQueue.back());
+      ownQueue.pop_back();
+    } else if (!m_queues[priority].empty()) {
+      task = std::move(m_queues[priority].front());
+      m_queues[priority].pop_front();
+    } else {
+      for (unsigned i = 1; i < m_workers.size(); ++i) {
+        auto &otherQueue = m_workers[(workerIndex + i) % m_workers.size()]->queues[priority];
+        if (!otherQueue.empty()) {
+          task = std::move(otherQueue.front());
+          otherQueue.pop_front();
+          break;
+        }
+      }
+    }
+    assert(task);
+    --m_queuedCount[priority];
+    return task;
+  }
+  return nullptr;
+}
+
+// =====================================================================================================================
+// The main function of a worker thread.
+//
+// @param workerIndex : Index of the worker
+void ThreadPool::workerMain(unsigned workerIndex) {
+  CurrentPool = this;
+  CurrentWorkerIndex = workerIndex;
+
+  std::unique_lock<std::mutex> lock(m_lock);
+  for (;;) {
+    m_wakeUp.wait(lock, [this] { return m_shutdown || hasRunnableTask(); });
+    std::shared_ptr<Task> task = takeTask(workerIndex);
+    if (!task) {
+      if (m_shutdown)
+        break;
+      continue;
+    }
+
+    bool background = task->priority == TaskPriority::Background;
+    if (background)
+      ++m_runningBackgroundCount;
+    lock.unlock();
+    runTask(*task);
+    task.reset();
+    lock.lock();
+    if (background) {
+      // Another background task may have been held back by the limit.
+      --m_runningBackgroundCount;
+      if (m_queuedCount[static_cast<unsigned>(TaskPriority::Background)] != 0)
+        m_wakeUp.notify_one();
+    }
+  }
+}
+
+// =====================================================================================================================
+// Runs a task, unless another thread has already claimed it.
+//
+// @param task : Task to run
+void ThreadPool::runTask(Task &task) {
+  if (task.claimed.exchange(true))
+    return;
+
+  TaskPriority savedPriority = CurrentPriority;
+  CurrentPriority = task.priority;
+  task.func();
+  task.func = nullptr;
+  CurrentPriority = savedPriority;
+
+  if (task.group)
+    task.group->taskDone();
+}
+
+// =====================================================================================================================
+// Creates a group whose tasks run at the priority of the task running on the calling thread, or at normal priority
+// outside of any task.
+//
+// @param threadPool : Thread pool to run the tasks
+TaskGroup::TaskGroup(ThreadPool *threadPool) : TaskGroup(threadPool, ThreadPool::getCurrentPriority()) {
+}
+
+// =====================================================================================================================
+//
+// @param threadPool : Thread pool to run the tasks
+// @param priority : Priority of the tasks
+TaskGroup::TaskGroup(ThreadPool *threadPool, TaskPriority priority) : m_threadPool(threadPool), m_priority(priority) {
+}
+
+// =====================================================================================================================
+// Queues a task in the group.
+//
+// @param func : Function to run
+void TaskGroup::async(std::function<void()> func) {
+  auto task = std::make_shared<ThreadPool::Task>();
+  task->func = std::move(func);
+  task->priority = m_priority;
+  task->group = this;
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_tasks.push_back(task);
+    ++m_pendingCount;
+  }
+  m_threadPool->enqueue(std::move(task));
+}
+
+// =====================================================================================================================
+// Waits for all tasks of the group to finish, running those that have not been started yet on the calling thread.
+void TaskGroup::wait() {
+  for (size_t taskIndex = 0;; ++taskIndex) {
+    std::shared_ptr<ThreadPool::Task> task;
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      if (taskIndex == m_tasks.size())
+        break;
+      task = m_tasks[taskIndex];
+    }
+    ThreadPool::runTask(*task);
+  }
+
+  std::unique_lock<std::mutex> lock(m_lock);
+  m_allDone.wait(lock, [this] { return m_pendingCount == 0; });
+  m_tasks.clear();
+}
+
+// =====================================================================================================================
+// Notes that a task of the group has finished.
+void TaskGroup::taskDone() {
+  std::lock_guard<std::mutex> lock(m_lock);
+  if (--m_pendingCount == 0)
+    m_allDone.notify_all();
+}
+
+} // namespace Llpc
@@ -0,0 +1,140 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcThreadPool.h
+ * @brief LLPC header file: contains declaration of class Llpc::ThreadPool and Llpc::TaskGroup.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Llpc {
+
+// Enumerates the priorities of tasks run by the thread pool. A queued task is only started when no task of higher
+// priority is queued.
+enum class TaskPriority : unsigned {
+  Background = 0, // Work that nothing is waiting for yet, such as pipeline precompiles
+  Normal = 1,     // Default priority
+  Foreground = 2, // Latency-critical work
+};
+
+static const unsigned TaskPriorityCount = 3;
+
+class TaskGroup;
+
+// =====================================================================================================================
+// Represents a pool of worker threads. Each worker has its own task queues: tasks queued from a worker go to the
+// worker's own queues and are taken newest first, while tasks queued from outside the pool go to shared queues, and
+// an idle worker steals the oldest task of another worker. There are always at least two workers, and background
+// tasks are never given all of them, so a foreground task queued behind them is started without waiting for one of
+// them to finish.
+class ThreadPool {
+public:
+  ThreadPool(unsigned threadCount);
+  ~ThreadPool();
+
+  // Gets the count of worker threads
+  unsigned getThreadCount() const { return m_workers.size(); }
+
+  void async(std::function<void()> func, TaskPriority priority);
+
+  static TaskPriority getCurrentPriority();
+
+private:
+  ThreadPool() = delete;
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  friend class TaskGroup;
+
+  // A queued task. It is run by whichever thread claims it first: a worker, or a thread waiting on its group.
+  struct Task {
+    std::function<void()> func;       // Function to run
+    TaskPriority priority;            // Priority of the task
+    TaskGroup *group;                 // Group the task belongs to, or null
+    std::atomic<bool> claimed{false}; // Whether a thread has claimed the task
+  };
+
+  // Per-worker state
+  struct Worker {
+    std::deque<std::shared_ptr<Task>> queues[TaskPriorityCount]; // Tasks queued from this worker, per priority
+    std::thread thread;                                          // The worker thread
+  };
+
+  void enqueue(std::shared_ptr<Task> task);
+  void workerMain(unsigned workerIndex);
+  bool hasRunnableTask() const;
+  std::shared_ptr<Task> takeTask(unsigned workerIndex);
+  static void runTask(Task &task);
+
+  std::vector<std::unique_ptr<Worker>> m_workers;                 // Worker threads
+  std::deque<std::shared_ptr<Task>> m_queues[TaskPriorityCount]; // Tasks queued from outside the pool, per priority
+  unsigned m_queuedCount[TaskPriorityCount] = {};                 // Count of queued tasks, per priority
+  unsigned m_runningBackgroundCount = 0;                          // Count of background tasks being run by workers
+  unsigned m_backgroundLimit;                                     // Max count of workers running background tasks
+  bool m_shutdown = false;                                        // Whether the workers should exit
+  std::mutex m_lock;                                              // Lock for the queues and counts
+  std::condition_variable m_wakeUp;                               // Signaled when a task may have become runnable
+};
+
+// =====================================================================================================================
+// Represents a group of tasks run by a thread pool that can be waited on together. Waiting runs the tasks of the group
+// that no worker has started yet on the waiting thread, so waiting from inside a task never depends on a free worker.
+class TaskGroup {
+public:
+  TaskGroup(ThreadPool *threadPool);
+  TaskGroup(ThreadPool *threadPool, TaskPriority priority);
+  ~TaskGroup() { wait(); }
+
+  void async(std::function<void()> func);
+  void wait();
+
+private:
+  TaskGroup() = delete;
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  friend class ThreadPool;
+
+  void taskDone();
+
+  ThreadPool *m_threadPool;                               // Thread pool to run the tasks
+  TaskPriority m_priority;                                // Priority of the tasks
+  std::vector<std::shared_ptr<ThreadPool::Task>> m_tasks; // Tasks of the group queued since the last wait
+  unsigned m_pendingCount = 0;                            // Count of tasks not finished yet
+  std::mutex m_lock;                                      // Lock for the task list and count
+  std::condition_variable m_allDone;                      // Signaled when the last pending task has finished
+};
+
+} // namespace Llpc
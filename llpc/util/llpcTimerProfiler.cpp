@@ -31,6 +31,7 @@
 
 #include "llpcTimerProfiler.h"
 #include "llpc.h"
+#include "llpcCompileProfile.h"
 #include "lgc/LgcContext.h"
 #include "lgc/PassManager.h"
 #include "llvm/ADT/Twine.h"
@@ -59,9 +60,12 @@ namespace Llpc {
 // @param hash64 : Hash code
 // @param descriptionPrefix : Profiler description prefix string
 // @param enableMask : Mask of enabled phase timers
-TimerProfiler::TimerProfiler(uint64_t hash64, const char *descriptionPrefix, unsigned enableMask)
-    : m_total("", "", getDummyTimeRecords()), m_phases("", "", getDummyTimeRecords()) {
-  if (TimePassesIsEnabled || cl::EnableTimerProfile) {
+// @param compileProfile : Compile profile to add the phase times to (optional)
+TimerProfiler::TimerProfiler(uint64_t hash64, const char *descriptionPrefix, unsigned enableMask,
+                             CompileProfile *compileProfile)
+    : m_textReport(TimePassesIsEnabled || cl::EnableTimerProfile), m_compileProfile(compileProfile),
+      m_total("", "", getDummyTimeRecords()), m_phases("", "", getDummyTimeRecords()) {
+  if (isEnabled()) {
     std::string hashString;
     raw_string_ostream ostream(hashString);
     ostream << format("0x%016" PRIX64, hash64);
@@ -107,9 +111,25 @@ TimerProfiler::TimerProfiler(uint64_t hash64, const char *descriptionPrefix, uns
 
 // =====================================================================================================================
 TimerProfiler::~TimerProfiler() {
-  if (TimePassesIsEnabled || cl::EnableTimerProfile) {
+  if (isEnabled()) {
     // Stop whole timer
     m_wholeTimer.stopTimer();
+
+    if (m_compileProfile) {
+      static const char *const PhaseNames[TimerCount] = {"translate", "lower", "loadBc", "patch", "opt", "codegen"};
+      for (unsigned timerKind = 0; timerKind < TimerCount; ++timerKind) {
+        if (m_phaseTimers[timerKind].hasTriggered())
+          m_compileProfile->addPhaseTime(PhaseNames[timerKind], m_phaseTimers[timerKind].getTotalTime());
+      }
+    }
+
+    if (!m_textReport) {
+      // NOTE: Timers that have run are printed when their group is destroyed. Clear them if they were only run for
+      // the compile profile.
+      m_wholeTimer.clear();
+      for (Timer &phaseTimer : m_phaseTimers)
+        phaseTimer.clear();
+    }
   }
 }
 
@@ -120,7 +140,7 @@ TimerProfiler::~TimerProfiler() {
 // @param timerKind : Kind of phase timer
 // @param start : Start or  stop timer
 void TimerProfiler::addTimerStartStopPass(lgc::PassManager *passMgr, TimerKind timerKind, bool start) {
-  if (TimePassesIsEnabled || cl::EnableTimerProfile)
+  if (isEnabled())
     passMgr->add(lgc::LgcContext::createStartStopTimer(&m_phaseTimers[timerKind], start));
 }
 
@@ -130,7 +150,7 @@ void TimerProfiler::addTimerStartStopPass(lgc::PassManager *passMgr, TimerKind t
 // @param timerKind : Kind of phase timer
 // @param start : Start or  stop timer
 void TimerProfiler::startStopTimer(TimerKind timerKind, bool start) {
-  if (TimePassesIsEnabled || cl::EnableTimerProfile) {
+  if (isEnabled()) {
     if (start)
       m_phaseTimers[timerKind].startTimer();
     else
@@ -139,11 +159,11 @@ void TimerProfiler::startStopTimer(TimerKind timerKind, bool start) {
 }
 
 // =====================================================================================================================
-// Gets a specific timer. Returns nullptr if TimePassesIsEnabled isn't enabled.
+// Gets a specific timer. Returns nullptr if timing is not enabled.
 //
 // @param timerKind : Kind of phase timer
 Timer *TimerProfiler::getTimer(TimerKind timerKind) {
-  return TimePassesIsEnabled || cl::EnableTimerProfile ? &m_phaseTimers[timerKind] : nullptr;
+  return isEnabled() ? &m_phaseTimers[timerKind] : nullptr;
 }
 
 // =====================================================================================================================
@@ -43,6 +43,8 @@ class PassManager;
 
 namespace Llpc {
 
+class CompileProfile;
+
 // =====================================================================================================================
 // Enumerates the kinds of timer used to do profiling for LLPC compilation phases.
 enum TimerKind : unsigned {
@@ -57,10 +59,12 @@ enum TimerKind : unsigned {
 };
 
 // =====================================================================================================================
-// Represents a utility class for time profile, it wraps LLVM Timer and TimerGroup in internal.
+// Represents a utility class for time profile, it wraps LLVM Timer and TimerGroup in internal. The phase times are
+// reported as LLVM timer text reports (-time-passes or -enable-timer-profile), and/or added to a compile profile.
 class TimerProfiler {
 public:
-  TimerProfiler(uint64_t hash64, const char *descriptionPrefix, unsigned enableMask);
+  TimerProfiler(uint64_t hash64, const char *descriptionPrefix, unsigned enableMask,
+                CompileProfile *compileProfile = nullptr);
 
   ~TimerProfiler();
 
@@ -70,6 +74,9 @@ public:
 
   llvm::Timer *getTimer(TimerKind timerKind);
 
+  // Checks whether timing is enabled, for a text report or for a compile profile
+  bool isEnabled() const { return m_textReport || m_compileProfile; }
+
   static const llvm::StringMap<llvm::TimeRecord> &getDummyTimeRecords();
 
   static const unsigned PipelineTimerEnableMask = ((1 << TimerCount) - 1);
@@ -79,6 +86,8 @@ private:
   TimerProfiler(const TimerProfiler &) = delete;
   TimerProfiler &operator=(const TimerProfiler &) = delete;
 
+  bool m_textReport;                     // Whether to report the timers as text
+  CompileProfile *m_compileProfile;      // Compile profile to add the phase times to (optional)
   llvm::TimerGroup m_total;              // TimeGroup for total time
   llvm::TimerGroup m_phases;             // TimeGroup for each phase
   llvm::Timer m_wholeTimer;              // Whole timer
@@ -62,6 +62,7 @@ std::ostream &operator<<(std::ostream &out, NggSubgroupSizingType subgroupSizing
 std::ostream &operator<<(std::ostream &out, NggCompactMode compactMode);
 std::ostream &operator<<(std::ostream &out, WaveBreakSize waveBreakSize);
 std::ostream &operator<<(std::ostream &out, ShadowDescriptorTableUsage shadowDescriptorTableUsage);
+std::ostream &operator<<(std::ostream &out, OptimizationTier optimizationTier);
 
 template std::ostream &operator<<(std::ostream &out, ElfReader<Elf64> &reader);
 template raw_ostream &operator<<(raw_ostream &out, ElfReader<Elf64> &reader);
@@ -620,6 +621,7 @@ void PipelineDumper::dumpPipelineOptions(const PipelineOptions *options, std::os
   dumpFile << "options.reconfigWorkgroupLayout = " << options->reconfigWorkgroupLayout << "\n";
   dumpFile << "options.shadowDescriptorTableUsage = " << options->shadowDescriptorTableUsage << "\n";
   dumpFile << "options.shadowDescriptorTablePtrHigh = " << options->shadowDescriptorTablePtrHigh << "\n";
+  dumpFile << "options.optimizationTier = " << options->optimizationTier << "\n";
 }
 
 // =====================================================================================================================
@@ -801,6 +803,7 @@ MetroHash::Hash PipelineDumper::generateHashForGraphicsPipeline(const GraphicsPi
   }
 
   hasher.Update(pipeline->iaState.deviceIndex);
+  hasher.Update(pipeline->options.optimizationTier);
 
   if (stage != ShaderStageFragment) {
     updateHashForVertexInputState(pipeline->pVertexInput, &hasher);
@@ -833,6 +836,7 @@ MetroHash::Hash PipelineDumper::generateHashForComputePipeline(const ComputePipe
   hasher.Update(pipeline->options.robustBufferAccess);
   hasher.Update(pipeline->options.shadowDescriptorTableUsage);
   hasher.Update(pipeline->options.shadowDescriptorTablePtrHigh);
+  hasher.Update(pipeline->options.optimizationTier);
 
   MetroHash::Hash hash = {};
   hasher.Finalize(hash.bytes);
@@ -1586,6 +1590,26 @@ std::ostream &operator<<(std::ostream &out, ShadowDescriptorTableUsage shadowDes
   return out << string;
 }
 
+// =====================================================================================================================
+// Translates enum "OptimizationTier" to string and output to ostream.
+//
+// @param [out] out : Output stream
+// @param optimizationTier : Optimization tier
+std::ostream &operator<<(std::ostream &out, OptimizationTier optimizationTier) {
+  const char *string = nullptr;
+  switch (optimizationTier) {
+    CASE_CLASSENUM_TO_STRING(OptimizationTier, Full)
+    CASE_CLASSENUM_TO_STRING(OptimizationTier, Fast)
+    CASE_CLASSENUM_TO_STRING(OptimizationTier, Minimal)
+    break;
+  default:
+    llvm_unreachable("Should never be called!");
+    break;
+  }
+
+  return out << string;
+}
+
 // =====================================================================================================================
 // Translates enum "VkPrimitiveTopology" to string and output to ostream.
 //
@@ -1006,6 +1006,10 @@ void initEnumMap() {
   ADD_CLASS_ENUM_MAP(WaveBreakSize, _16x16)
   ADD_CLASS_ENUM_MAP(WaveBreakSize, _32x32)
   ADD_CLASS_ENUM_MAP(WaveBreakSize, DrawTime)
+
+  ADD_CLASS_ENUM_MAP(OptimizationTier, Full)
+  ADD_CLASS_ENUM_MAP(OptimizationTier, Fast)
+  ADD_CLASS_ENUM_MAP(OptimizationTier, Minimal)
 };
 
 } // namespace Vfx